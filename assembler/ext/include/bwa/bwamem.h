@@ -131,6 +131,24 @@ extern "C" {
 	 */
 	void mem_process_seqs(const mem_opt_t *opt, const bwt_t *bwt, const bntseq_t *bns, const uint8_t *pac, int64_t n_processed, int n, bseq1_t *seqs, const mem_pestat_t *pes0);
 
+	/**
+	 * Find the aligned regions for a batch of single-end query sequences
+	 *
+	 * The batch is processed by opt->n_threads workers, each reusing its own
+	 * seeding buffers. Primary alignments are marked as in mem_align1().
+	 * MEM_F_PE must not be set.
+	 *
+	 * @param opt          alignment parameters
+	 * @param bwt          FM-index of the reference sequence
+	 * @param bns          Information of the reference
+	 * @param pac          2-bit encoded reference
+	 * @param n_processed  number of sequences processed in previous batches
+	 * @param n            number of query sequences
+	 * @param seqs         query sequences; $seqs[i].seq is converted to 2-bit encoding in place
+	 * @param regs         output array of $n lists of aligned regions
+	 */
+	void mem_align_seqs(const mem_opt_t *opt, const bwt_t *bwt, const bntseq_t *bns, const uint8_t *pac, int64_t n_processed, int n, bseq1_t *seqs, mem_alnreg_v *regs);
+
 	/**
 	 * Find the aligned regions for one query sequence
 	 *
@@ -1169,6 +1169,28 @@ static void worker2(void *data, int i, int tid)
 	}
 }
 
+void mem_align_seqs(const mem_opt_t *opt, const bwt_t *bwt, const bntseq_t *bns, const uint8_t *pac, int64_t n_processed, int n, bseq1_t *seqs, mem_alnreg_v *regs)
+{
+	extern void kt_for(int n_threads, void (*func)(void*,int,int), void *data, int n);
+	worker_t w;
+	int i;
+
+	assert(!(opt->flag&MEM_F_PE));
+	w.regs = regs;
+	w.opt = opt; w.bwt = bwt; w.bns = bns; w.pac = pac;
+	w.seqs = seqs; w.n_processed = n_processed;
+	w.pes = 0;
+	w.aux = malloc(opt->n_threads * sizeof(smem_aux_t*));
+	for (i = 0; i < opt->n_threads; ++i)
+		w.aux[i] = smem_aux_init();
+	kt_for(opt->n_threads, worker1, &w, n); // find mapping positions
+	for (i = 0; i < opt->n_threads; ++i)
+		smem_aux_destroy(w.aux[i]);
+	free(w.aux);
+	for (i = 0; i < n; ++i)
+		mem_mark_primary_se(opt, regs[i].n, regs[i].a, n_processed + i);
+}
+
 void mem_process_seqs(const mem_opt_t *opt, const bwt_t *bwt, const bntseq_t *bns, const uint8_t *pac, int64_t n_processed, int n, bseq1_t *seqs, const mem_pestat_t *pes0)
 {
 	extern void kt_for(int n_threads, void (*func)(void*,int,int), void *data, int n);
@@ -221,6 +221,7 @@ void hattrie_clear(hattrie_t* T)
     node.b->c0 = 0x00;
     node.b->c1 = 0xff;
     T->root.t = alloc_trie_node(T, node);
+    T->m = 0;
 }
 
 
@@ -3,6 +3,8 @@
 #include <functional>
 #include <vector>
 #include <atomic>
+#include <memory>
+#include <algorithm>
 
 #include <cassert>
 
@@ -170,5 +172,99 @@ class bitcounting_bloom_filter : public counting_bloom_filter<T, width_> {
   }
 };
 
+/// The self-sizing counting Bloom filter.
+/// Consists of a chain of counting Bloom filters of growing size. Elements are
+/// always added to the last filter of the chain; once it holds its capacity of
+/// distinct elements, a new filter of four times the capacity is appended. The
+/// count of an element is the sum of its counts over the chain, so, as for a
+/// single filter, it is never underestimated. False positives accumulate over the
+/// chain, so every next filter gets more cells per element to keep the total
+/// rate bounded. Safe for concurrent add & lookup.
+template<class T, unsigned width_ = 4>
+class scalable_counting_bloom_filter {
+  scalable_counting_bloom_filter(const scalable_counting_bloom_filter&) = delete;
+  scalable_counting_bloom_filter& operator=(const scalable_counting_bloom_filter&) = delete;
+
+  typedef counting_bloom_filter<T, width_> filter_type;
+  static constexpr size_t max_levels_ = 32;
+  static constexpr size_t max_count_ = (1ull << width_) - 1;
+
+  struct level {
+    level(const typename filter_type::hasher &h, size_t capacity,
+          size_t cells_per_element, size_t num_hashes)
+        : filter(h, capacity * cells_per_element, num_hashes),
+          capacity(capacity), cells_per_element(cells_per_element), elements(0) {}
+
+    filter_type filter;
+    size_t capacity;
+    size_t cells_per_element;
+    std::atomic<size_t> elements;
+  };
+
+public:
+  /// The hash function type.
+  typedef typename filter_type::hasher hasher;
+
+  /// Constructs a self-sizing counting Bloom filter.
+  /// @param h The hasher.
+  /// @param capacity The number of distinct elements the first filter is sized for.
+  /// @param cells_per_element The number of cells per distinct element in the first filter.
+  /// @param num_hashes The number of hash functions to use
+  scalable_counting_bloom_filter(hasher h, size_t capacity,
+                                 size_t cells_per_element = 12, size_t num_hashes = 3)
+    : hasher_(std::move(h)),
+      cells_per_element_(cells_per_element),
+      num_hashes_(num_hashes),
+      num_levels_(0) {
+    add_level(capacity ? capacity : 1, cells_per_element_);
+  }
+
+  /// Adds an element to the Bloom filter.
+  /// @param x An instance of type `T`.
+  void add(const T &o) {
+    size_t n = num_levels_.load();
+    level &last = *levels_[n - 1];
+    if (last.filter.lookup(o) == 0 &&
+        last.elements.fetch_add(1) + 1 == last.capacity)
+      add_level(4 * last.capacity, last.cells_per_element + 4);
+
+    last.filter.add(o);
+  }
+
+  /// Retrieves the count of an element.
+  /// @param x An instance of type `T`.
+  /// @return A frequency estimate for *x*.
+  size_t lookup(const T &o) const {
+    size_t val = 0;
+    for (size_t i = 0, n = num_levels_.load(); i < n && val < max_count_; ++i)
+      val += levels_[i]->filter.lookup(o);
+
+    return std::min(val, size_t(max_count_));
+  }
+
+  /// Returns the (approximate) number of distinct elements added.
+  size_t size() const {
+    size_t res = 0;
+    for (size_t i = 0, n = num_levels_.load(); i < n; ++i)
+      res += levels_[i]->elements.load();
+
+    return res;
+  }
+
+private:
+  // Only the thread that filled up the last filter gets here, no need to lock
+  void add_level(size_t capacity, size_t cells_per_element) {
+    size_t n = num_levels_.load();
+    assert(n < max_levels_);
+    levels_[n].reset(new level(hasher_, capacity, cells_per_element, num_hashes_));
+    num_levels_.store(n + 1);
+  }
+
+  hasher hasher_;
+  size_t cells_per_element_;
+  size_t num_hashes_;
+  std::unique_ptr<level> levels_[max_levels_];
+  std::atomic<size_t> num_levels_;
+};
 
 } // namespace bf
@@ -3,73 +3,87 @@
 //
 
 #include "connected_component.hpp"
-#include <stack>
+#include "adt/concurrent_dsu.hpp"
 
 
 namespace debruijn_graph {
 
 
 void ConnectedComponentCounter::CalculateComponents() const {
-    map <EdgeId, size_t> component_ids;
-    vector <pair<size_t, size_t>> to_sort;
-    map<size_t, size_t> comp_size;
-    size_t cur_id = 0;
-    for (auto e = g_.ConstEdgeBegin(); !e.IsEnd(); ++e) {
-        if (component_ids.find(*e) == component_ids.end()) {
-            std::stack <EdgeId> next;
-            next.push(*e);
-            set <EdgeId> used;
-            size_t ans = 0;
-            while (!next.empty()) {
-                auto cur = next.top();
-                next.pop();
-                if (used.find(cur) != used.end()) {
-                    continue;
-                }
-                ans += g_.length(cur);
-                used.insert(cur);
-                vector <EdgeId> neighbours;
-                neighbours.push_back(g_.conjugate(cur));
-                auto start = g_.EdgeStart(cur);
-                auto tmp = g_.IncidentEdges(start);
+    // Edges in the iteration order, component discovery order follows it
+    vector<EdgeId> edges;
+    for (auto e = g_.ConstEdgeBegin(); !e.IsEnd(); ++e)
+        edges.push_back(*e);
 
-                neighbours.insert(neighbours.end(), tmp.begin(), tmp.end());
-                auto end = g_.EdgeEnd(cur);
-                tmp = g_.IncidentEdges(end);
-                neighbours.insert(neighbours.end(), tmp.begin(), tmp.end());
-                for (auto ee:neighbours) {
-                    if (used.find(ee) == used.end()) {
-                        next.push(ee);
-                    }
-                }
-            }
-            for (auto edge: used) {
-                component_ids[edge] = cur_id;
-            }
-            to_sort.push_back(std::make_pair(ans, cur_id));
-            comp_size[cur_id] = ans;
-            cur_id ++;
+    vector<pair<EdgeId, size_t>> positions(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i)
+        positions[i] = std::make_pair(edges[i], i);
+    std::sort(positions.begin(), positions.end());
+
+    auto position = [&](EdgeId e) {
+        auto it = std::lower_bound(positions.begin(), positions.end(), std::make_pair(e, size_t(0)));
+        VERIFY(it != positions.end() && it->first == e);
+        return it->second;
+    };
+
+    // Edge is connected with its conjugate and all the edges incident to its end
+    ConcurrentDSU dsu(edges.size());
+#   pragma omp parallel for schedule(guided)
+    for (size_t i = 0; i < edges.size(); ++i) {
+        EdgeId e = edges[i];
+        dsu.unite(i, position(g_.conjugate(e)));
+        for (EdgeId ee : g_.IncidentEdges(g_.EdgeEnd(e)))
+            dsu.unite(i, position(ee));
+    }
+
+    vector<size_t> roots(edges.size());
+#   pragma omp parallel for schedule(guided)
+    for (size_t i = 0; i < edges.size(); ++i)
+        roots[i] = dsu.find_set(i);
+
+    const size_t NO_COMPONENT = -1ull;
+    vector<size_t> root_ids(edges.size(), NO_COMPONENT);
+    vector<size_t> comp_size;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        size_t &cur_id = root_ids[roots[i]];
+        if (cur_id == NO_COMPONENT) {
+            cur_id = comp_size.size();
+            comp_size.push_back(0);
         }
+        comp_size[cur_id] += g_.length(edges[i]);
     }
+
+    vector<pair<size_t, size_t>> to_sort;
+    for (size_t i = 0; i < comp_size.size(); ++i)
+        to_sort.push_back(std::make_pair(comp_size[i], i));
     std::sort(to_sort.begin(), to_sort.end());
     std::reverse(to_sort.begin(), to_sort.end());
-    vector <size_t> perm(to_sort.size());
+    vector<size_t> perm(to_sort.size());
+    component_total_len_.assign(to_sort.size(), 0);
     for (size_t i = 0; i < to_sort.size(); i++) {
         perm[to_sort[i].second] = i;
-        component_total_len_[i] = comp_size[to_sort[i].second];
+        component_total_len_[i] = to_sort[i].first;
     }
-    for (auto pair:component_ids) {
-        component_ids_[pair.first] = perm[pair.second];
-        component_edges_quantity_[perm[pair.second]]++;
+
+    edges_.resize(positions.size());
+    component_ids_.resize(positions.size());
+    component_edges_quantity_.assign(to_sort.size(), 0);
+    for (size_t i = 0; i < positions.size(); ++i) {
+        size_t comp = perm[root_ids[roots[positions[i].second]]];
+        edges_[i] = positions[i].first;
+        component_ids_[i] = comp;
+        component_edges_quantity_[comp]++;
     }
-    return;
 }
 
 size_t ConnectedComponentCounter::GetComponent(EdgeId & e) const {
     if (component_ids_.size() == 0) {
         CalculateComponents();
     }
-    return component_ids_[e];
+    auto it = std::lower_bound(edges_.begin(), edges_.end(), e);
+    if (it == edges_.end() || *it != e)
+        return 0;
+    return component_ids_[it - edges_.begin()];
 }
 
 
@@ -2,17 +2,20 @@
 // Created by lab42 on 8/24/15.
 //
 #pragma once
-#include <map>
+#include <vector>
 //#include "path_extend/bidirectional_path.hpp"
 #include "assembly_graph/core/graph.hpp"
 
 namespace debruijn_graph{
 
+// Components are numbered by decreasing total length.
+// Edges are kept sorted, component ids, sizes and lengths are stored in flat arrays.
 class ConnectedComponentCounter {
 public:
-    mutable std::map<EdgeId, size_t> component_ids_;
-    mutable std::map<size_t, size_t> component_edges_quantity_;
-    mutable std::map<size_t, size_t> component_total_len_;
+    mutable std::vector<EdgeId> edges_;
+    mutable std::vector<size_t> component_ids_;
+    mutable std::vector<size_t> component_edges_quantity_;
+    mutable std::vector<size_t> component_total_len_;
     const Graph &g_;
     ConnectedComponentCounter(const Graph &g):g_(g) {}
     void CalculateComponents() const;
@@ -19,6 +19,9 @@ namespace omnigraph {
 
 using std::vector;
 
+template<typename VertexId, typename EdgeId>
+class HandlerEventLog;
+
 /**
 * ActionHandler is base listening class for graph events. All structures and information storages
 * which are meant to synchronize with graph should use this structure. In order to make handler listen
@@ -111,6 +114,14 @@ public:
     virtual void HandleSplit(EdgeId /*old_edge*/, EdgeId /*new_edge_1*/,
                              EdgeId /*new_edge_2*/) { }
 
+    /**
+     * Events of the batch (see EventBatch) delivered in a single call after the batch is finished.
+     * Only deferrable handlers receive their events this way. Default implementation just replays
+     * them one by one.
+     * @param events events of the batch in the order they have happened
+     */
+    virtual void HandleBatch(const HandlerEventLog<VertexId, EdgeId> &events);
+
     /**
      * Every thread safe descendant should override this method for correct concurrent graph processing.
      */
@@ -118,6 +129,16 @@ public:
         return false;
     }
 
+    /**
+     * Deferrable handler allows graph to postpone its events till the end of the current event batch.
+     * It should not be queried while graph is being modified and its handling methods should not rely
+     * on graph structure, only on the data of the elements involved (which are kept alive till the end
+     * of the batch). Different deferrable handlers are notified in parallel.
+     */
+    virtual bool IsDeferrable() const {
+        return false;
+    }
+
     bool IsAttached() const {
         return attached_;
     }
@@ -133,6 +154,121 @@ public:
     }
 };
 
+/**
+* HandlerEventLog is a handler which stores all the events it receives into compact vectors, so that
+* they could be replayed to other handlers later. Graph fills it via HandlerApplier, so all the events
+* for the conjugate elements are already there.
+*/
+template<typename VertexId, typename EdgeId>
+class HandlerEventLog : public ActionHandler<VertexId, EdgeId> {
+    typedef ActionHandler<VertexId, EdgeId> base;
+
+    enum EventType {
+        ADD_VERTEX, ADD_EDGE, DELETE_VERTEX, DELETE_EDGE, MERGE, GLUE, SPLIT
+    };
+
+    struct Event {
+        EventType type;
+        VertexId v;
+        EdgeId e[3];
+        // Range of the old edges of MERGE event in merged_
+        size_t from, to;
+
+        Event(EventType t, VertexId vertex = VertexId(), EdgeId e0 = EdgeId(),
+              EdgeId e1 = EdgeId(), EdgeId e2 = EdgeId())
+                : type(t), v(vertex), e{e0, e1, e2}, from(0), to(0) {}
+    };
+
+    std::vector<Event> events_;
+    std::vector<EdgeId> merged_;
+
+public:
+    HandlerEventLog()
+            : base("HandlerEventLog") {}
+
+    void HandleAdd(VertexId v) override {
+        events_.emplace_back(ADD_VERTEX, v);
+    }
+
+    void HandleAdd(EdgeId e) override {
+        events_.emplace_back(ADD_EDGE, VertexId(), e);
+    }
+
+    void HandleDelete(VertexId v) override {
+        events_.emplace_back(DELETE_VERTEX, v);
+    }
+
+    void HandleDelete(EdgeId e) override {
+        events_.emplace_back(DELETE_EDGE, VertexId(), e);
+    }
+
+    void HandleMerge(const vector<EdgeId> &old_edges, EdgeId new_edge) override {
+        events_.emplace_back(MERGE, VertexId(), new_edge);
+        events_.back().from = merged_.size();
+        merged_.insert(merged_.end(), old_edges.begin(), old_edges.end());
+        events_.back().to = merged_.size();
+    }
+
+    void HandleGlue(EdgeId new_edge, EdgeId edge1, EdgeId edge2) override {
+        events_.emplace_back(GLUE, VertexId(), new_edge, edge1, edge2);
+    }
+
+    void HandleSplit(EdgeId old_edge, EdgeId new_edge_1, EdgeId new_edge_2) override {
+        events_.emplace_back(SPLIT, VertexId(), old_edge, new_edge_1, new_edge_2);
+    }
+
+    /**
+     * Passes all the recorded events to the handler in the original order.
+     */
+    void Replay(base &handler) const {
+        for (const Event &event : events_) {
+            switch (event.type) {
+                case ADD_VERTEX:
+                    handler.HandleAdd(event.v);
+                    break;
+                case ADD_EDGE:
+                    handler.HandleAdd(event.e[0]);
+                    break;
+                case DELETE_VERTEX:
+                    handler.HandleDelete(event.v);
+                    break;
+                case DELETE_EDGE:
+                    handler.HandleDelete(event.e[0]);
+                    break;
+                case MERGE:
+                    handler.HandleMerge(vector<EdgeId>(merged_.begin() + event.from,
+                                                       merged_.begin() + event.to),
+                                        event.e[0]);
+                    break;
+                case GLUE:
+                    handler.HandleGlue(event.e[0], event.e[1], event.e[2]);
+                    break;
+                case SPLIT:
+                    handler.HandleSplit(event.e[0], event.e[1], event.e[2]);
+                    break;
+            }
+        }
+    }
+
+    size_t size() const {
+        return events_.size();
+    }
+
+    bool empty() const {
+        return events_.empty();
+    }
+
+    void clear() {
+        events_.clear();
+        merged_.clear();
+    }
+};
+
+template<typename VertexId, typename EdgeId>
+void ActionHandler<VertexId, EdgeId>::HandleBatch(const HandlerEventLog<VertexId, EdgeId> &events) {
+    events.Replay(*this);
+}
+
 template<class Graph>
 class GraphActionHandler : public ActionHandler<typename Graph::VertexId,
         typename Graph::EdgeId> {
@@ -100,6 +100,13 @@ class CoverageIndex : public GraphActionHandler<Graph> {
         g_.data(e).inc_raw_coverage((int)count);
     }
 
+    /**
+     * Can be called concurrently, including for the same edge
+     */
+    void IncRawCoverageAtomic(EdgeId e, unsigned count) {
+        g_.data(e).inc_raw_coverage_atomic(count);
+    }
+
     void SetAvgCoverage(EdgeId e, double cov) {
         g_.data(e).set_raw_coverage((int) math::round(cov * (double) this->g().length(e)));
     }
@@ -39,6 +39,11 @@ class CoverageData {
         coverage_ += value;
     }
 
+    void inc_coverage_atomic(unsigned value) {
+#       pragma omp atomic
+        coverage_ += value;
+    }
+
     void set_coverage(unsigned coverage) {
         coverage_ = coverage;
     }
@@ -68,6 +73,10 @@ public:
         coverage_.inc_coverage(value);
     }
 
+    void inc_raw_coverage_atomic(unsigned value) {
+        coverage_.inc_coverage_atomic(value);
+    }
+
     void set_raw_coverage(unsigned coverage) {
         coverage_.set_coverage(coverage);
     }
@@ -80,6 +89,10 @@ public:
         flanking_cov_.inc_coverage(value);
     }
 
+    void inc_flanking_coverage_atomic(unsigned value) {
+        flanking_cov_.inc_coverage_atomic(value);
+    }
+
     void set_flanking_coverage(unsigned flanking_coverage) {
         flanking_cov_.set_coverage(flanking_coverage);
     }
@@ -275,6 +275,11 @@ public:
    }
 
 private:
+   bool AdditionalCompressCondition(VertexId v) const {
+       return !(EdgeEnd(GetUniqueOutgoingEdge(v)) == conjugate(v) && EdgeStart(GetUniqueIncomingEdge(v)) == conjugate(v));
+   }
+
+protected:
    void DeleteVertexFromGraph(VertexId vertex) {
        this->vertices_.erase(vertex);
        this->vertices_.erase(conjugate(vertex));
@@ -286,12 +291,6 @@ private:
        delete conjugate.get();
    }
 
-   bool AdditionalCompressCondition(VertexId v) const {
-       return !(EdgeEnd(GetUniqueOutgoingEdge(v)) == conjugate(v) && EdgeStart(GetUniqueIncomingEdge(v)) == conjugate(v));
-   }
-
-protected:
-
    VertexId CreateVertex(const VertexData& data1, const VertexData& data2, restricted::IdDistributor& id_distributor) {
        VertexId vertex1(new PairedVertex<DataMaster>(data1), id_distributor);
        VertexId vertex2(new PairedVertex<DataMaster>(data2), id_distributor);
@@ -377,19 +376,29 @@ protected:
         return HiddenAddEdge(v1, v2, data, id_distributor_);
     }
 
-    void HiddenDeleteEdge(EdgeId edge) {
-        TRACE("Hidden delete edge " << edge.int_id());
+    //Detaches the edge and its conjugate from their start vertices, edge data stays valid
+    void UnlinkEdge(EdgeId edge) {
         EdgeId rcEdge = conjugate(edge);
         VertexId rcStart = conjugate(edge->end());
         VertexId start = conjugate(rcEdge->end());
         start->RemoveOutgoingEdge(edge);
         rcStart->RemoveOutgoingEdge(rcEdge);
+    }
+
+    void DestroyEdge(EdgeId edge) {
+        EdgeId rcEdge = conjugate(edge);
         if (edge != rcEdge) {
             delete rcEdge.get();
         }
         delete edge.get();
     }
 
+    void HiddenDeleteEdge(EdgeId edge) {
+        TRACE("Hidden delete edge " << edge.int_id());
+        UnlinkEdge(edge);
+        DestroyEdge(edge);
+    }
+
     void HiddenDeletePath(const std::vector<EdgeId>& edgesToDelete, const std::vector<VertexId>& verticesToDelete) {
         for (auto it = edgesToDelete.begin(); it != edgesToDelete.end(); ++it)
             HiddenDeleteEdge(*it);
@@ -41,6 +41,30 @@ private:
    mutable std::vector<Handler*> action_handler_list_;
    const HandlerApplier<VertexId, EdgeId> *applier_;
 
+   //event batch state, see BeginBatch/EndBatch
+   size_t batch_depth_;
+   mutable std::vector<Handler*> immediate_handlers_;
+   mutable std::vector<Handler*> deferred_handlers_;
+   mutable HandlerEventLog<VertexId, EdgeId> batch_log_;
+   std::vector<EdgeId> dead_edges_;
+   std::vector<VertexId> dead_vertices_;
+
+   //handlers to be notified right away
+   const std::vector<Handler*> &immediate_handlers() const {
+       return deferred_handlers_.empty() ? action_handler_list_ : immediate_handlers_;
+   }
+
+   void PartitionHandlers() const;
+
+   void FlushBatch();
+
+   //unlink element from the graph, freeing it is postponed till the end of the batch if needed
+   void ReleaseEdge(EdgeId e);
+
+   void ReleaseVertex(VertexId v);
+
+   void ReleasePath(const std::vector<EdgeId>& edges_to_delete, const std::vector<VertexId>& vertices_to_delete);
+
 public:
 //todo move to graph core
     typedef ConstructionHelper<DataMaster> HelperT;
@@ -81,6 +105,19 @@ public:
 
     bool VerifyAllDetached();
 
+    /**
+     * Opens (possibly nested) event batch. Till the outermost batch is closed events for deferrable
+     * handlers (see ActionHandler::IsDeferrable) are only recorded and deleted elements are only
+     * unlinked from the graph. Other handlers are notified as usual.
+     */
+    void BeginBatch();
+
+    /**
+     * Closes event batch. When the outermost batch is closed, recorded events are delivered to
+     * deferrable handlers (in parallel for different handlers) and deleted elements are freed.
+     */
+    void EndBatch();
+
     //smart iterators
     template<typename Comparator>
     SmartVertexIterator<ObservableGraph, Comparator> SmartVertexBegin(
@@ -110,7 +147,7 @@ public:
     void FireDeletePath(const std::vector<EdgeId>& edges_to_delete, const std::vector<VertexId>& vertices_to_delete) const;
 
     ObservableGraph(const DataMaster& master) :
-            base(master), applier_(new PairedHandlerApplier<ObservableGraph>(*this)) {
+            base(master), applier_(new PairedHandlerApplier<ObservableGraph>(*this)), batch_depth_(0) {
     }
 
     virtual ~ObservableGraph();
@@ -180,7 +217,7 @@ void ObservableGraph<DataMaster>::DeleteVertex(VertexId v) {
     VERIFY(base::IsDeadEnd(v) && base::IsDeadStart(v));
     VERIFY(v != VertexId(NULL));
     FireDeleteVertex(v);
-    base::HiddenDeleteVertex(v);
+    ReleaseVertex(v);
 }
 
 template<class DataMaster>
@@ -207,7 +244,7 @@ typename ObservableGraph<DataMaster>::EdgeId ObservableGraph<DataMaster>::AddEdg
 template<class DataMaster>
 void ObservableGraph<DataMaster>::DeleteEdge(EdgeId e) {
     FireDeleteEdge(e);
-    base::HiddenDeleteEdge(e);
+    ReleaseEdge(e);
 }
 
 template<class DataMaster>
@@ -278,6 +315,8 @@ void ObservableGraph<DataMaster>::AddActionHandler(Handler* action_handler) cons
             VERIFY_MSG(false, "Action handler " << action_handler->name() << " has already been added");
         } else {
             action_handler_list_.push_back(action_handler);
+            if (batch_depth_ > 0)
+                PartitionHandlers();
         }
     }
 }
@@ -290,6 +329,8 @@ bool ObservableGraph<DataMaster>::RemoveActionHandler(const Handler* action_hand
         auto it = std::find(action_handler_list_.begin(), action_handler_list_.end(), action_handler);
         if (it != action_handler_list_.end()) {
             action_handler_list_.erase(it);
+            if (batch_depth_ > 0)
+                PartitionHandlers();
             TRACE("Action handler " << action_handler->name() << " removed");
             result = true;
         } else {
@@ -318,67 +359,176 @@ void ObservableGraph<DataMaster>::PrintHandlersNames() const {
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireAddVertex(VertexId v) const {
-    for (Handler* handler_ptr : action_handler_list_) {
+    for (Handler* handler_ptr : immediate_handlers()) {
         if (handler_ptr->IsAttached()) {
             TRACE("FireAddVertex to handler " << handler_ptr->name());
             applier_->ApplyAdd(*handler_ptr, v);
         }
     }
+    if (!deferred_handlers_.empty()) {
+#       pragma omp critical(graph_event_batch)
+        applier_->ApplyAdd(batch_log_, v);
+    }
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireAddEdge(EdgeId e) const {
-    for (Handler* handler_ptr : action_handler_list_) {
+    for (Handler* handler_ptr : immediate_handlers()) {
         if (handler_ptr->IsAttached()) {
             TRACE("FireAddEdge to handler " << handler_ptr->name());
             applier_->ApplyAdd(*handler_ptr, e);
         }
     }
+    if (!deferred_handlers_.empty()) {
+#       pragma omp critical(graph_event_batch)
+        applier_->ApplyAdd(batch_log_, e);
+    }
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireDeleteVertex(VertexId v) const {
-    for (auto it = action_handler_list_.rbegin(); it != action_handler_list_.rend(); ++it) {
+    const std::vector<Handler*> &handlers = immediate_handlers();
+    for (auto it = handlers.rbegin(); it != handlers.rend(); ++it) {
         if ((*it)->IsAttached()) {
             applier_->ApplyDelete(**it, v);
         }
     }
+    if (!deferred_handlers_.empty()) {
+#       pragma omp critical(graph_event_batch)
+        applier_->ApplyDelete(batch_log_, v);
+    }
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireDeleteEdge(EdgeId e) const {
-    for (auto it = action_handler_list_.rbegin(); it != action_handler_list_.rend(); ++it) {
+    const std::vector<Handler*> &handlers = immediate_handlers();
+    for (auto it = handlers.rbegin(); it != handlers.rend(); ++it) {
         if ((*it)->IsAttached()) {
             applier_->ApplyDelete(**it, e);
         }
-    };
+    }
+    if (!deferred_handlers_.empty()) {
+#       pragma omp critical(graph_event_batch)
+        applier_->ApplyDelete(batch_log_, e);
+    }
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireMerge(vector<EdgeId> old_edges, EdgeId new_edge) const {
-    for (Handler* handler_ptr : action_handler_list_) {
+    for (Handler* handler_ptr : immediate_handlers()) {
         if (handler_ptr->IsAttached()) {
             applier_->ApplyMerge(*handler_ptr, old_edges, new_edge);
         }
     }
+    if (!deferred_handlers_.empty()) {
+#       pragma omp critical(graph_event_batch)
+        applier_->ApplyMerge(batch_log_, old_edges, new_edge);
+    }
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireGlue(EdgeId new_edge, EdgeId edge1, EdgeId edge2) const {
-    for (Handler* handler_ptr : action_handler_list_) {
+    for (Handler* handler_ptr : immediate_handlers()) {
         if (handler_ptr->IsAttached()) {
             applier_->ApplyGlue(*handler_ptr, new_edge, edge1, edge2);
         }
-    };
+    }
+    if (!deferred_handlers_.empty()) {
+#       pragma omp critical(graph_event_batch)
+        applier_->ApplyGlue(batch_log_, new_edge, edge1, edge2);
+    }
 }
 
 template<class DataMaster>
 void ObservableGraph<DataMaster>::FireSplit(EdgeId edge, EdgeId new_edge1, EdgeId new_edge2) const {
-    for (Handler* handler_ptr : action_handler_list_) {
+    for (Handler* handler_ptr : immediate_handlers()) {
         if (handler_ptr->IsAttached()) {
             applier_->ApplySplit(*handler_ptr, edge, new_edge1, new_edge2);
         }
     }
+    if (!deferred_handlers_.empty()) {
+#       pragma omp critical(graph_event_batch)
+        applier_->ApplySplit(batch_log_, edge, new_edge1, new_edge2);
+    }
+}
+
+template<class DataMaster>
+void ObservableGraph<DataMaster>::PartitionHandlers() const {
+    immediate_handlers_.clear();
+    deferred_handlers_.clear();
+    for (Handler* handler_ptr : action_handler_list_) {
+        if (handler_ptr->IsAttached() && handler_ptr->IsDeferrable())
+            deferred_handlers_.push_back(handler_ptr);
+        else
+            immediate_handlers_.push_back(handler_ptr);
+    }
+}
+
+template<class DataMaster>
+void ObservableGraph<DataMaster>::BeginBatch() {
+    if (batch_depth_++ > 0)
+        return;
+    VERIFY(batch_log_.empty() && dead_edges_.empty() && dead_vertices_.empty());
+    PartitionHandlers();
+}
+
+template<class DataMaster>
+void ObservableGraph<DataMaster>::EndBatch() {
+    VERIFY(batch_depth_ > 0);
+    if (--batch_depth_ > 0)
+        return;
+    FlushBatch();
+    immediate_handlers_.clear();
+    deferred_handlers_.clear();
+}
+
+template<class DataMaster>
+void ObservableGraph<DataMaster>::FlushBatch() {
+    if (!batch_log_.empty()) {
+        DEBUG("Delivering " << batch_log_.size() << " batched events to " << deferred_handlers_.size() << " handlers");
+        //handlers do not share state, so each of them could process its events independently
+#       pragma omp parallel for schedule(dynamic)
+        for (size_t i = 0; i < deferred_handlers_.size(); ++i)
+            deferred_handlers_[i]->HandleBatch(batch_log_);
+        batch_log_.clear();
+    }
+
+    for (EdgeId e : dead_edges_)
+        base::DestroyEdge(e);
+    for (VertexId v : dead_vertices_)
+        base::DestroyVertex(v);
+    dead_edges_.clear();
+    dead_vertices_.clear();
+}
+
+template<class DataMaster>
+void ObservableGraph<DataMaster>::ReleaseEdge(EdgeId e) {
+    if (deferred_handlers_.empty()) {
+        base::HiddenDeleteEdge(e);
+        return;
+    }
+    base::UnlinkEdge(e);
+#   pragma omp critical(graph_event_batch)
+    dead_edges_.push_back(e);
+}
+
+template<class DataMaster>
+void ObservableGraph<DataMaster>::ReleaseVertex(VertexId v) {
+    if (deferred_handlers_.empty()) {
+        base::HiddenDeleteVertex(v);
+        return;
+    }
+    base::DeleteVertexFromGraph(v);
+#   pragma omp critical(graph_event_batch)
+    dead_vertices_.push_back(v);
+}
+
+template<class DataMaster>
+void ObservableGraph<DataMaster>::ReleasePath(const vector<EdgeId>& edges_to_delete, const vector<VertexId>& vertices_to_delete) {
+    for (EdgeId e : edges_to_delete)
+        ReleaseEdge(e);
+    for (VertexId v : vertices_to_delete)
+        ReleaseVertex(v);
 }
 
 template<class DataMaster>
@@ -401,6 +551,7 @@ void ObservableGraph<DataMaster>::FireDeletePath(const vector<EdgeId>& edgesToDe
 
 template<class DataMaster>
 ObservableGraph<DataMaster>::~ObservableGraph<DataMaster>() {
+    VERIFY(batch_depth_ == 0);
     while (base::size() > 0) {
         ForceDeleteVertex(*base::begin());
     }
@@ -454,7 +605,7 @@ typename ObservableGraph<DataMaster>::EdgeId ObservableGraph<DataMaster>::MergeP
     vector<VertexId> vertices_to_delete = VerticesToDelete(corrected_path);
     FireDeletePath(edges_to_delete, vertices_to_delete);
     FireAddEdge(new_edge);
-    base::HiddenDeletePath(edges_to_delete, vertices_to_delete);
+    ReleasePath(edges_to_delete, vertices_to_delete);
     return new_edge;
 }
 
@@ -473,7 +624,7 @@ std::pair<typename ObservableGraph<DataMaster>::EdgeId, typename ObservableGraph
     FireAddVertex(splitVertex);
     FireAddEdge(new_edge1);
     FireAddEdge(new_edge2);
-    base::HiddenDeleteEdge(edge);
+    ReleaseEdge(edge);
     return make_pair(new_edge1, new_edge2);
 }
 
@@ -486,8 +637,8 @@ typename ObservableGraph<DataMaster>::EdgeId ObservableGraph<DataMaster>::GlueEd
     FireAddEdge(new_edge);
     VertexId start = base::EdgeStart(edge1);
     VertexId end = base::EdgeEnd(edge1);
-    base::HiddenDeleteEdge(edge1);
-    base::HiddenDeleteEdge(edge2);
+    ReleaseEdge(edge1);
+    ReleaseEdge(edge2);
     if (base::IsDeadStart(start) && base::IsDeadEnd(start)) {
         DeleteVertex(start);
     }
@@ -496,4 +647,26 @@ typename ObservableGraph<DataMaster>::EdgeId ObservableGraph<DataMaster>::GlueEd
     }
     return new_edge;
 }
+
+/**
+* Scoped event batch of the graph, see ObservableGraph::BeginBatch
+*/
+template<class Graph>
+class EventBatch {
+    Graph &g_;
+
+public:
+    EventBatch(Graph &g)
+            : g_(g) {
+        g_.BeginBatch();
+    }
+
+    ~EventBatch() {
+        g_.EndBatch();
+    }
+
+    EventBatch(const EventBatch &) = delete;
+    void operator=(const EventBatch &) = delete;
+};
+
 }
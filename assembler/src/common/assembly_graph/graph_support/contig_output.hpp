@@ -51,38 +51,84 @@ public:
 };
 
 
+/**
+ * Formats records [0, count) in parallel and writes them to the stream in their order.
+ * format(i, buffer) should append the text of the i-th record to the buffer.
+ * Records are formatted chunk by chunk into per-chunk buffers, so the stream
+ * receives only a few large writes and is never flushed.
+ */
+template<class Formatter>
+void WriteRecordsInParallel(std::ostream &os, size_t count, const Formatter &format,
+                            size_t chunk_size = 1024) {
+    std::vector<std::string> buffers(4 * omp_get_max_threads());
+    size_t round_size = buffers.size() * chunk_size;
+    for (size_t round_start = 0; round_start < count; round_start += round_size) {
+        size_t round_end = std::min(count, round_start + round_size);
+        size_t chunks = (round_end - round_start + chunk_size - 1) / chunk_size;
+#       pragma omp parallel for schedule(dynamic)
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            std::string &buffer = buffers[chunk];
+            buffer.clear();
+            size_t chunk_end = std::min(round_end, round_start + (chunk + 1) * chunk_size);
+            for (size_t i = round_start + chunk * chunk_size; i < chunk_end; ++i)
+                format(i, buffer);
+        }
+
+        for (size_t chunk = 0; chunk < chunks; ++chunk)
+            os.write(buffers[chunk].data(), buffers[chunk].size());
+    }
+}
+
+inline void AppendNucls(std::string &buffer, const Sequence &seq) {
+    size_t start = buffer.size();
+    buffer.resize(start + seq.size());
+    for (size_t i = 0; i < seq.size(); ++i)
+        buffer[start + i] = nucl(seq[i]);
+}
+
 class GFASegmentWriter {
 private:
-    std::ostream &ostream_;
-
+    std::string &buffer_;
 
 public:
 
-    GFASegmentWriter(std::ostream &stream) : ostream_(stream)  {
+    GFASegmentWriter(std::string &buffer) : buffer_(buffer)  {
     }
 
     void Write(size_t edge_id, const Sequence &seq, double cov) {
-        ostream_ << "S\t" << edge_id << "\t";
-        ostream_ << seq.str() << "\t";
-        ostream_ << "KC:i:" << int(cov) << std::endl;
+        buffer_ += "S\t";
+        buffer_ += std::to_string(edge_id);
+        buffer_ += '\t';
+        AppendNucls(buffer_, seq);
+        buffer_ += "\tKC:i:";
+        buffer_ += std::to_string(int(cov));
+        buffer_ += '\n';
     }
 };
 
 class GFALinkWriter {
 private:
-    std::ostream &ostream_;
+    std::string &buffer_;
     size_t overlap_size_;
 
 public:
 
-    GFALinkWriter(std::ostream &stream, size_t overlap_size) : ostream_(stream), overlap_size_(overlap_size)  {
+    GFALinkWriter(std::string &buffer, size_t overlap_size) : buffer_(buffer), overlap_size_(overlap_size)  {
     }
 
-    void Write(size_t first_segment, std::string &first_orientation, size_t second_segment, std::string &second_orientation) {
-        ostream_ << "L\t" << first_segment << "\t" << first_orientation << "\t" ;
-        ostream_ << second_segment << "\t" << second_orientation << "\t" << overlap_size_ << "M";
-        ostream_ << std::endl;
-
+    void Write(size_t first_segment, const std::string &first_orientation,
+               size_t second_segment, const std::string &second_orientation) {
+        buffer_ += "L\t";
+        buffer_ += std::to_string(first_segment);
+        buffer_ += '\t';
+        buffer_ += first_orientation;
+        buffer_ += '\t';
+        buffer_ += std::to_string(second_segment);
+        buffer_ += '\t';
+        buffer_ += second_orientation;
+        buffer_ += '\t';
+        buffer_ += std::to_string(overlap_size_);
+        buffer_ += "M\n";
     }
 };
 
@@ -105,29 +151,32 @@ struct PathSegmentSequence {
 
 class GFAPathWriter {
 private:
-    std::ostream &ostream_;
+    std::string &buffer_;
 
 public:
 
-    GFAPathWriter(std::ostream &stream)
-    : ostream_(stream)  {
+    GFAPathWriter(std::string &buffer)
+    : buffer_(buffer)  {
     }
 
     void Write(const PathSegmentSequence &path_segment_sequence) {
-        ostream_ << "P" << "\t" ;
-        ostream_ << path_segment_sequence.path_id_ << "_" << path_segment_sequence.segment_number_ << "\t";
-        std::string delimeter = "";
-        for (size_t i = 0; i < path_segment_sequence.segment_sequence_.size() - 1; ++i) {
-            ostream_ << delimeter << path_segment_sequence.segment_sequence_[i];
-            delimeter = ",";
+        buffer_ += "P\t";
+        buffer_ += std::to_string(path_segment_sequence.path_id_);
+        buffer_ += '_';
+        buffer_ += std::to_string(path_segment_sequence.segment_number_);
+        buffer_ += '\t';
+        for (size_t i = 0; i + 1 < path_segment_sequence.segment_sequence_.size(); ++i) {
+            if (i > 0)
+                buffer_ += ',';
+            buffer_ += path_segment_sequence.segment_sequence_[i];
         }
-        ostream_ << "\t";
-        std::string delimeter2 = "";
-        for (size_t i = 0; i < path_segment_sequence.segment_sequence_.size() - 1; ++i) {
-                ostream_ << delimeter2 << "*";
-                delimeter2 = ",";
+        buffer_ += '\t';
+        for (size_t i = 0; i + 1 < path_segment_sequence.segment_sequence_.size(); ++i) {
+            if (i > 0)
+                buffer_ += ',';
+            buffer_ += '*';
         }
-        ostream_ << std::endl;
+        buffer_ += '\n';
     }
 
 };
@@ -136,6 +185,7 @@ template<class Graph>
 class GFAWriter {
 private:
     typedef typename Graph::EdgeId EdgeId;
+    typedef typename Graph::VertexId VertexId;
     const Graph &graph_;
     const path_extend::PathContainer &paths_;
     const string filename_;
@@ -154,40 +204,53 @@ private:
     }
 
     void WriteSegments(std::ofstream &stream) {
-        GFASegmentWriter segment_writer(stream);
-        for (auto it = graph_.ConstEdgeBegin(true); !it.IsEnd(); ++it) {
-            segment_writer.Write((*it).int_id(), graph_.EdgeNucls(*it), graph_.coverage(*it) * double(graph_.length(*it)));
-        }
+        std::vector<EdgeId> edges;
+        for (auto it = graph_.ConstEdgeBegin(true); !it.IsEnd(); ++it)
+            edges.push_back(*it);
+
+        WriteRecordsInParallel(stream, edges.size(), [&](size_t i, std::string &buffer) {
+            EdgeId e = edges[i];
+            GFASegmentWriter(buffer).Write(e.int_id(), graph_.EdgeNucls(e),
+                                           graph_.coverage(e) * double(graph_.length(e)));
+        });
     }
 
     void WriteLinks(std::ofstream &stream) {
-        GFALinkWriter link_writer(stream, graph_.k());
-        for (auto it = graph_.SmartVertexBegin(); !it.IsEnd(); ++it) {
-            for (auto inc_edge : graph_.IncomingEdges(*it)) {
+        std::vector<VertexId> vertices;
+        for (auto it = graph_.SmartVertexBegin(); !it.IsEnd(); ++it)
+            vertices.push_back(*it);
+
+        WriteRecordsInParallel(stream, vertices.size(), [&](size_t i, std::string &buffer) {
+            GFALinkWriter link_writer(buffer, graph_.k());
+            VertexId v = vertices[i];
+            for (auto inc_edge : graph_.IncomingEdges(v)) {
                 std::string orientation_first = GetOrientation(inc_edge);
                 size_t segment_first = IsCanonical(inc_edge) ? inc_edge.int_id() : graph_.conjugate(inc_edge).int_id();
-                for (auto out_edge : graph_.OutgoingEdges(*it)) {
+                for (auto out_edge : graph_.OutgoingEdges(v)) {
                     size_t segment_second = IsCanonical(out_edge) ? out_edge.int_id() : graph_.conjugate(out_edge).int_id();
                     std::string orientation_second = GetOrientation(out_edge);
                     link_writer.Write(segment_first, orientation_first, segment_second, orientation_second);
                 }
             }
-        }
+        });
     }
 
-    void UpdateSegmentedPath(PathSegmentSequence &segmented_path, EdgeId e) {
-        std::string segment_id = IsCanonical(e) ? ToString(e.int_id()) : ToString(graph_.conjugate(e).int_id());
+    void UpdateSegmentedPath(PathSegmentSequence &segmented_path, EdgeId e) const {
+        std::string segment_id = std::to_string(IsCanonical(e) ? e.int_id() : graph_.conjugate(e).int_id());
         std::string orientation = GetOrientation(e);
         segmented_path.segment_sequence_.push_back(segment_id + orientation);
     }
 
     void WritePaths(std::ofstream &stream) {
-        GFAPathWriter path_writer(stream);
+        std::vector<const path_extend::BidirectionalPath *> paths;
         for (const auto &path_pair : paths_) {
-            const path_extend::BidirectionalPath &p = (*path_pair.first);
-            if (p.Size() == 0) {
-                continue;
-            }
+            if (path_pair.first->Size() != 0)
+                paths.push_back(path_pair.first);
+        }
+
+        WriteRecordsInParallel(stream, paths.size(), [&](size_t idx, std::string &buffer) {
+            GFAPathWriter path_writer(buffer);
+            const path_extend::BidirectionalPath &p = *paths[idx];
             PathSegmentSequence segmented_path;
             segmented_path.path_id_ = p.GetId();
             for (size_t i = 0; i < p.Size() - 1; ++i) {
@@ -201,8 +264,7 @@ private:
             }
             UpdateSegmentedPath(segmented_path, p.Back());
             path_writer.Write(segmented_path);
-
-        }
+        }, /*chunk_size*/ 64);
     }
 
 public:
@@ -220,6 +282,7 @@ public:
 };
 
 //This class uses corrected sequences to construct contig (just return as is, find unipath, trim contig)
+//construct() may be called concurrently for different edges
 template<class Graph>
 class ContigConstructor {
 private:
@@ -414,10 +477,24 @@ public:
     ContigPrinter(const Graph &graph, ContigConstructor<Graph> &constructor) : graph_(graph), constructor_(constructor) {
     }
 
+    // Contigs are constructed in parallel batch by batch and reported in the edge order
     template<class sequence_stream>
     void PrintContigs(sequence_stream &os) {
-        for (auto it = graph_.ConstEdgeBegin(true); !it.IsEnd(); ++it) {
-            ReportEdge<sequence_stream>(os, constructor_.construct(*it));
+        std::vector<EdgeId> edges;
+        for (auto it = graph_.ConstEdgeBegin(true); !it.IsEnd(); ++it)
+            edges.push_back(*it);
+
+        const size_t batch_size = 1024 * omp_get_max_threads();
+        std::vector<pair<string, double>> contigs;
+        for (size_t start = 0; start < edges.size(); start += batch_size) {
+            size_t end = std::min(edges.size(), start + batch_size);
+            contigs.resize(end - start);
+#           pragma omp parallel for schedule(dynamic, 64)
+            for (size_t i = start; i < end; ++i)
+                contigs[i - start] = constructor_.construct(edges[i]);
+
+            for (const auto &contig : contigs)
+                ReportEdge<sequence_stream>(os, contig);
         }
     }
 
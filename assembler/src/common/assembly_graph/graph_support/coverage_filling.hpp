@@ -47,26 +47,32 @@ public:
         return count_index_.k();
     }
 
+    /*
+     * Can be called concurrently
+     */
     void inc_coverage(const Value &edge_info) {
-        coverage_index_.IncRawCoverage(edge_info.edge_id, edge_info.count);
+        coverage_index_.IncRawCoverageAtomic(edge_info.edge_id, edge_info.count);
         if (edge_info.offset < flanking_coverage_.averaging_range()) {
-            flanking_coverage_.IncRawCoverage(edge_info.edge_id, edge_info.count);
+            flanking_coverage_.IncRawCoverageAtomic(edge_info.edge_id, edge_info.count);
         }
     }
 
     void Fill() {
-        for (auto I = count_index_.value_cbegin(), E = count_index_.value_cend();
-             I != E; ++I) {
-            const auto& edge_info = *I;
+        size_t removed = 0;
+        ParallelForEachValue(count_index_, [&](const Value &edge_info) {
             //VERIFY(edge_info.valid());
             if (edge_info.valid()) {
                 VERIFY(edge_info.edge_id.get() != NULL);
                 SimultaneousCoverageCollector<typename CountIndex::storing_type>::CollectCoverage(*this, edge_info);
             } else {
                 VERIFY(edge_info.removed());
-                WARN("Duplicating k+1-mers in graph (known bug in construction)");
+#               pragma omp atomic
+                removed += 1;
             }
-        }
+        });
+
+        if (removed)
+            WARN("Duplicating k+1-mers in graph (known bug in construction): " << removed);
     }
 };
 
@@ -77,24 +77,27 @@ public:
     void Fill(const CoverageIndex& count_index) {
         TRACE("Filling flanking coverage from index");
 
-        for (auto I = count_index.value_cbegin(), E = count_index.value_cend();
-                I != E; ++I) {
-            const auto& edge_info = *I;
+        debruijn_graph::ParallelForEachValue(count_index, [&](const typename CoverageIndex::ValueType &edge_info) {
             EdgeId e = edge_info.edge_id;
-            unsigned offset = edge_info.offset;
-            unsigned count = edge_info.count;
             VERIFY(edge_info.valid());
             VERIFY(e.get() != NULL);
-            if (offset < averaging_range_) {
-                IncRawCoverage(e, count);
+            if (edge_info.offset < averaging_range_) {
+                IncRawCoverageAtomic(e, edge_info.count);
             }
-        }
+        });
     }
 
     void IncRawCoverage(EdgeId e, unsigned count) {
         g_.data(e).inc_flanking_coverage(count);
     }
 
+    /**
+     * Can be called concurrently, including for the same edge
+     */
+    void IncRawCoverageAtomic(EdgeId e, unsigned count) {
+        g_.data(e).inc_flanking_coverage_atomic(count);
+    }
+
     double CoverageOfStart(EdgeId e) const {
         return AverageFlankingCoverage(e);
     }
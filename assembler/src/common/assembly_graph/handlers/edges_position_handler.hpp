@@ -20,6 +20,8 @@
 #include "assembly_graph/paths/mapping_path.hpp"
 #include "assembly_graph/core/action_handlers.hpp"
 
+#include <unordered_map>
+
 namespace omnigraph {
 
 struct EdgePosition {
@@ -41,61 +43,118 @@ class EdgesPositionHandler: public GraphActionHandler<Graph> {
     typedef typename Graph::VertexId VertexId;
     typedef typename Graph::EdgeId EdgeId;
 
+    struct ContigRange {
+        unsigned contig;
+        MappingRange mr;
+
+        ContigRange(unsigned contig_, const MappingRange &mr_) : contig(contig_), mr(mr_) {
+        }
+
+        bool operator<(const ContigRange &other) const {
+            if (contig != other.contig)
+                return contig < other.contig;
+            return mr < other.mr;
+        }
+    };
+
+    //sorted by contig, then by range, ranges of a contig are disjoint after merging
+    typedef vector<ContigRange> PositionList;
+    typedef typename PositionList::iterator PositionIt;
+
     size_t max_mapping_gap_;
     size_t max_gap_diff_;
-    map<EdgeId, map<string, std::set<MappingRange>>> edges_positions_;
-    //TODO extract set<MappingRange> as a storage class
+    //positions refer to the interned contig names
+    vector<string> contig_names_;
+    std::unordered_map<string, unsigned> contig_ids_;
+    std::unordered_map<EdgeId, PositionList> edges_positions_;
+
+    unsigned InternContig(const string &contig_id) {
+        auto it = contig_ids_.find(contig_id);
+        if (it != contig_ids_.end())
+            return it->second;
+        unsigned id = unsigned(contig_names_.size());
+        contig_names_.push_back(contig_id);
+        contig_ids_[contig_id] = id;
+        return id;
+    }
+
+    const PositionList *Positions(EdgeId edge) const {
+        auto it = edges_positions_.find(edge);
+        return it == edges_positions_.end() ? nullptr : &it->second;
+    }
 
-    MappingRange EraseAndExtract(set<MappingRange> &ranges, set<MappingRange>::iterator &position, const MappingRange &new_pos) {
-        auto &old_pos = *position;
+    MappingRange EraseAndExtract(PositionList &positions, PositionIt position, const MappingRange &new_pos) {
+        MappingRange old_pos = position->mr;
         if(old_pos.IntersectLeftOf(new_pos) || old_pos.StrictlyContinuesWith(new_pos, max_mapping_gap_, max_gap_diff_)) {
-            ranges.erase(position);
+            positions.erase(position);
             return old_pos.Merge(new_pos);
         } else if(new_pos.IntersectLeftOf(old_pos) || new_pos.StrictlyContinuesWith(old_pos, max_mapping_gap_, max_gap_diff_)) {
-            ranges.erase(position);
+            positions.erase(position);
             return new_pos.Merge(old_pos);
         } else {
             return new_pos;
         }
     }
 
-public:
-    MappingRange EraseAndExtract(set<MappingRange> &ranges, MappingRange new_pos) {
-        auto it = ranges.lower_bound(new_pos);
-        if(it != ranges.end()) {
-            new_pos = EraseAndExtract(ranges, it, new_pos);
-            it = ranges.lower_bound(new_pos);
+    //same as inserting into a set of ranges after merging with the neighbours
+    void AddPosition(PositionList &positions, unsigned contig, MappingRange new_pos) {
+        ContigRange key(contig, new_pos);
+        auto it = std::lower_bound(positions.begin(), positions.end(), key);
+        if (it != positions.end() && it->contig == contig) {
+            new_pos = EraseAndExtract(positions, it, new_pos);
+            key.mr = new_pos;
+            it = std::lower_bound(positions.begin(), positions.end(), key);
+        }
+        if (it != positions.begin() && std::prev(it)->contig == contig) {
+            new_pos = EraseAndExtract(positions, std::prev(it), new_pos);
+            key.mr = new_pos;
         }
-        if(it != ranges.begin()) {
-            new_pos = EraseAndExtract(ranges, --it, new_pos);
+        it = std::lower_bound(positions.begin(), positions.end(), key);
+        if (it == positions.end() || key < *it)
+            positions.insert(it, key);
+    }
+
+    void AddAndShiftEdgePositions(EdgeId edge, const PositionList &old_positions, int shift = 0) {
+        if (old_positions.empty())
+            return;
+        PositionList &positions = edges_positions_[edge];
+        positions.reserve(positions.size() + old_positions.size());
+        for (const ContigRange &pos : old_positions) {
+            MappingRange new_pos = pos.mr.Shift(shift).Fit(this->g().length(edge));
+            if (!new_pos.empty())
+                AddPosition(positions, pos.contig, new_pos);
         }
-        return new_pos;
     }
 
+public:
     set<MappingRange> GetEdgePositions(EdgeId edge, string contig_id) const {
         VERIFY(this->IsAttached());
-        auto edge_it = edges_positions_.find(edge);
-        if(edge_it == edges_positions_.end())
+        const PositionList *positions = Positions(edge);
+        auto contig_it = contig_ids_.find(contig_id);
+        if (!positions || contig_it == contig_ids_.end())
             return set<MappingRange>();
-        const auto& positions = edge_it->second;
-        auto it = positions.find(contig_id);
-        if(it == positions.end())
-            return set<MappingRange>();
-        else
-            return it->second;
+        set<MappingRange> result;
+        for (const ContigRange &pos : *positions) {
+            if (pos.contig == contig_it->second)
+                result.insert(pos.mr);
+        }
+        return result;
     }
 
     vector<EdgePosition> GetEdgePositions(EdgeId edge) const {
         VERIFY(this->IsAttached());
-        auto edge_it = edges_positions_.find(edge);
-        if(edge_it == edges_positions_.end())
+        const PositionList *positions = Positions(edge);
+        if (!positions)
             return vector<EdgePosition>();
         vector<EdgePosition> result;
-        for(auto it = edge_it->second.begin(); it != edge_it->second.end(); ++it) {
-            for(auto pos_it = it->second.begin(); pos_it != it->second.end(); ++pos_it) {
-                result.push_back(EdgePosition(it->first, *pos_it));
-            }
+        result.reserve(positions->size());
+        for (const ContigRange &pos : *positions) {
+            result.push_back(EdgePosition(contig_names_[pos.contig], pos.mr));
         }
+        //contigs are reported in the order of their names
+        std::stable_sort(result.begin(), result.end(), [](const EdgePosition &a, const EdgePosition &b) {
+            return a.contigId < b.contigId;
+        });
         return result;
     }
 
@@ -108,18 +167,7 @@ public:
         VERIFY(this->IsAttached());
         if(new_pos.empty())
             return;
-        set<MappingRange> &new_set = edges_positions_[edge][contig_id];
-        new_pos = EraseAndExtract(new_set, new_pos);
-        new_set.insert(new_pos);
-    }
-
-    void AddAndShiftEdgePositions(EdgeId edge, const map<string, set<MappingRange>> &contig_map, int shift = 0) {
-        VERIFY(this->IsAttached());
-        for(auto contig_it = contig_map.begin(); contig_it != contig_map.end(); ++contig_it) {
-            for(auto it = contig_it->second.begin(); it != contig_it->second.end(); ++it) {
-                AddEdgePosition(edge, contig_it->first, it->Shift(shift).Fit(this->g().length(edge)));
-            }
-        }
+        AddPosition(edges_positions_[edge], InternContig(contig_id), new_pos);
     }
 
     template<typename Iter>
@@ -164,10 +212,20 @@ public:
 
     virtual void HandleGlue(EdgeId new_edge, EdgeId edge1, EdgeId edge2) {
 //        TRACE("Handle glue ");
-        auto positions1 = GetEdgePositions(edge1);
-        auto positions2 = GetEdgePositions(edge2);
-        AddEdgePositions(new_edge, positions1.begin(), positions1.end());
-        AddEdgePositions(new_edge, positions2.begin(), positions2.end());
+        const PositionList *positions1 = Positions(edge1);
+        const PositionList *positions2 = Positions(edge2);
+        PositionList old_positions;
+        if (positions1)
+            old_positions.insert(old_positions.end(), positions1->begin(), positions1->end());
+        if (positions2)
+            old_positions.insert(old_positions.end(), positions2->begin(), positions2->end());
+        if (old_positions.empty())
+            return;
+        PositionList &positions = edges_positions_[new_edge];
+        positions.reserve(positions.size() + old_positions.size());
+        for (const ContigRange &pos : old_positions) {
+            AddPosition(positions, pos.contig, pos.mr);
+        }
     }
 
     virtual void HandleSplit(EdgeId oldEdge, EdgeId newEdge1, EdgeId newEdge2) {
@@ -175,18 +233,18 @@ public:
             WARN("EdgesPositionHandler does not support self-conjugate splits");
             return;
         }
-        if (edges_positions_.count(oldEdge) != 0) {
-            auto contig_map = edges_positions_[oldEdge];
-            AddAndShiftEdgePositions(newEdge1, contig_map, 0);
-            AddAndShiftEdgePositions(newEdge2, contig_map, -int(this->g().length(newEdge1)));
+        if (const PositionList *positions = Positions(oldEdge)) {
+            PositionList old_positions = *positions;
+            AddAndShiftEdgePositions(newEdge1, old_positions, 0);
+            AddAndShiftEdgePositions(newEdge2, old_positions, -int(this->g().length(newEdge1)));
         }
     }
 
     virtual void HandleMerge(const vector<EdgeId>& oldEdges, EdgeId newEdge) {
         int shift = 0;
         for(auto it = oldEdges.begin(); it != oldEdges.end(); ++it) {
-            if (edges_positions_.count(*it) != 0) {
-                AddAndShiftEdgePositions(newEdge, edges_positions_[*it], shift);
+            if (const PositionList *positions = Positions(*it)) {
+                AddAndShiftEdgePositions(newEdge, *positions, shift);
             }
             shift += int(this->g().length(*it));
         }
@@ -199,8 +257,15 @@ public:
         edges_positions_.erase(e);
     }
 
+    //positions are only needed for the output, so could be updated after the simplification pass
+    bool IsDeferrable() const override {
+        return true;
+    }
+
     void clear() {
         edges_positions_.clear();
+        contig_ids_.clear();
+        contig_names_.clear();
     }
 
 private:
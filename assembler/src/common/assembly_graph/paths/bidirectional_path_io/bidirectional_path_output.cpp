@@ -30,27 +30,29 @@ void path_extend::ContigWriter::OutputPaths(const PathContainer &paths,
 
     INFO("Writing contigs to " << filename_base);
     io::osequencestream_simple oss(filename_base + ".fasta");
-    std::ofstream os_fastg;
-    if (write_fastg)
-        os_fastg.open((filename_base + ".paths").c_str());
-
-    size_t i = 0;
-    for (const auto& precontig : storage.Storage()) {
-        ++i;
-        std::string contig_id = name_generator_->MakeContigName(i, precontig);
-        oss.set_header(contig_id);
-        oss << precontig.sequence_;
+    const auto &contigs = storage.Storage();
+    std::vector<std::string> contig_ids;
+    contig_ids.reserve(contigs.size());
+    for (size_t i = 0; i < contigs.size(); ++i) {
+        contig_ids.push_back(name_generator_->MakeContigName(i + 1, contigs[i]));
+        oss.set_header(contig_ids.back());
+        oss << contigs[i].sequence_;
+    }
 
-        if (write_fastg) {
-            os_fastg << contig_id << endl;
-            os_fastg << ToFASTGPathFormat(*precontig.path_) << endl;
-            os_fastg << contig_id << "'" << endl;
-            os_fastg << ToFASTGPathFormat(*precontig.path_->GetConjPath()) << endl;
-        }
+    if (write_fastg) {
+        std::ofstream os_fastg((filename_base + ".paths").c_str());
+        WriteRecordsInParallel(os_fastg, contigs.size(), [&](size_t i, std::string &buffer) {
+            buffer += contig_ids[i];
+            buffer += '\n';
+            buffer += ToFASTGPathFormat(*contigs[i].path_);
+            buffer += '\n';
+            buffer += contig_ids[i];
+            buffer += "'\n";
+            buffer += ToFASTGPathFormat(*contigs[i].path_->GetConjPath());
+            buffer += '\n';
+        });
     }
 
-    if (write_fastg)
-        os_fastg.close();
     DEBUG("Contigs written");
 }
 
@@ -15,17 +15,24 @@
 
 namespace io {
 
+// All the files of the multifile stream are opened at once, so they share the thread budget
+inline unsigned threads_per_file(unsigned nthreads, size_t nfiles) {
+    return std::max(1u, nthreads / (unsigned) std::max(nfiles, size_t(1)));
+}
+
 inline
 PairedStreamPtr paired_easy_reader(const SequencingLibrary<debruijn_graph::config::DataSetData> &lib,
                                    bool followed_by_rc,
                                    size_t insert_size,
                                    bool change_read_order = false,
                                    bool use_orientation = true,
-                                   OffsetType offset_type = PhredOffset) {
+                                   OffsetType offset_type = PhredOffset,
+                                   unsigned nthreads = 1) {
+    unsigned file_threads = threads_per_file(nthreads, 2 * std::distance(lib.paired_begin(), lib.paired_end()));
     ReadStreamList<PairedRead> streams;
     for (auto read_pair : lib.paired_reads()) {
         streams.push_back(PairedEasyStream(read_pair.first, read_pair.second, followed_by_rc, insert_size, change_read_order,
-                                           use_orientation, lib.orientation(), offset_type));
+                                           use_orientation, lib.orientation(), offset_type, file_threads));
     }
     return MultifileWrap<PairedRead>(streams);
 }
@@ -35,16 +42,17 @@ ReadStreamList<SingleRead> single_easy_readers(const SequencingLibrary<debruijn_
                                                bool followed_by_rc,
                                                bool including_paired_reads,
                                                bool handle_Ns = true,
-                                               OffsetType offset_type = PhredOffset) {
+                                               OffsetType offset_type = PhredOffset,
+                                               unsigned file_threads = 1) {
     ReadStreamList<SingleRead> streams;
     if (including_paired_reads) {
       for (const auto& read : lib.reads()) {
         //do we need input_file function here?
-        streams.push_back(EasyStream(read, followed_by_rc, handle_Ns, offset_type));
+        streams.push_back(EasyStream(read, followed_by_rc, handle_Ns, offset_type, file_threads));
       }
     } else {
       for (const auto& read : lib.single_reads()) {
-        streams.push_back(EasyStream(read, followed_by_rc, handle_Ns, offset_type));
+        streams.push_back(EasyStream(read, followed_by_rc, handle_Ns, offset_type, file_threads));
       }
     }
     return streams;
@@ -55,9 +63,13 @@ SingleStreamPtr single_easy_reader(const SequencingLibrary<debruijn_graph::confi
                                    bool followed_by_rc,
                                    bool including_paired_reads,
                                    bool handle_Ns = true,
-                                   OffsetType offset_type = PhredOffset) {
+                                   OffsetType offset_type = PhredOffset,
+                                   unsigned nthreads = 1) {
+    size_t nfiles = including_paired_reads ? std::distance(lib.reads_begin(), lib.reads_end())
+                                           : std::distance(lib.single_begin(), lib.single_end());
     return MultifileWrap<io::SingleRead>(
-           single_easy_readers(lib, followed_by_rc, including_paired_reads, handle_Ns, offset_type));
+           single_easy_readers(lib, followed_by_rc, including_paired_reads, handle_Ns, offset_type,
+                               threads_per_file(nthreads, nfiles)));
 }
 
 inline
@@ -83,7 +83,8 @@ private:
 
         INFO("Converting reads to binary format for library #" << data.lib_index << " (takes a while)");
         INFO("Converting paired reads");
-        PairedStreamPtr paired_reader = paired_easy_reader(lib, false, 0, false, false);
+        unsigned nthreads = (unsigned) cfg::get().max_threads;
+        PairedStreamPtr paired_reader = paired_easy_reader(lib, false, 0, false, false, PhredOffset, nthreads);
         BinaryWriter paired_converter(data.binary_reads_info.paired_read_prefix,
                                           data.binary_reads_info.chunk_num,
                                           data.binary_reads_info.buffer_size);
@@ -93,7 +94,7 @@ private:
 
         INFO("Converting single reads");
 
-        SingleStreamPtr single_reader = single_easy_reader(lib, false, false);
+        SingleStreamPtr single_reader = single_easy_reader(lib, false, false, true, PhredOffset, nthreads);
         BinaryWriter single_converter(data.binary_reads_info.single_read_prefix,
                                           data.binary_reads_info.chunk_num,
                                           data.binary_reads_info.buffer_size);
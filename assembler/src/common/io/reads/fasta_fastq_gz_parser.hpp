@@ -26,33 +26,55 @@
 #ifndef COMMON_IO_FASTAFASTQGZPARSER_HPP
 #define COMMON_IO_FASTAFASTQGZPARSER_HPP
 
-#include <zlib.h>
 #include <string>
+#include <thread>
+#include <memory>
+#include <vector>
 #include "kseq/kseq.h"
 #include "utils/verify.hpp"
 #include "single_read.hpp"
 #include "io/reads/parser.hpp"
+#include "io/reads/parallel_gz_reader.hpp"
 #include "sequence/quality.hpp"
 #include "sequence/nucl.hpp"
 
 namespace io {
 
 namespace fastafastqgz {
+// Same signature as gzread has
+inline int ParallelGzRead(ParallelGzReader *reader, void *buf, unsigned len) {
+    return reader->read(buf, len);
+}
+
+// kseq itself narrows the lengths and the characters all over the place
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
 // STEP 1: declare the type of file handler and the read() function
-KSEQ_INIT(gzFile, gzread)
+KSEQ_INIT(ParallelGzReader*, ParallelGzRead)
+#pragma GCC diagnostic pop
 }
 
+/*
+ * Decompression (see ParallelGzReader) and parsing both run in the background,
+ * the parsed reads are handed over to the consumer by batches.
+ */
 class FastaFastqGzParser: public Parser {
+    typedef std::vector<SingleRead> ReadBatch;
+
+    static const size_t BATCH_SIZE = 4096;
+    static const size_t BATCH_QUEUE_CAPACITY = 8;
+
 public:
     /*
      * Default constructor.
      *
      * @param filename The name of the file to be opened.
      * @param offset The offset of the read quality.
+     * @param nthreads The number of threads decompressing the file.
      */
     FastaFastqGzParser(const std::string& filename, OffsetType offset_type =
-            PhredOffset) :
-            Parser(filename, offset_type), fp_(), seq_(NULL) {
+            PhredOffset, unsigned nthreads = 1) :
+            Parser(filename, offset_type), nthreads_(nthreads), batch_pos_(0) {
         open();
     }
 
@@ -77,20 +99,7 @@ public:
             return *this;
         }
         //todo offset_type_ should be used in future
-        if (seq_->qual.s) {
-            read = SingleRead(seq_->name.s, seq_->seq.s, seq_->qual.s, offset_type_);
-        } else {
-            read = SingleRead(seq_->name.s, seq_->seq.s);
-//            size_t len = strlen(seq_->seq.s);
-//            char* qual = (char*) malloc(len + 1);
-//            char q = '\2' + 64;
-//            for (size_t i = 0; i < len; ++i) {
-//                qual[i] = q;
-//            }
-//            qual[len] = '\0';
-//            read.SetAll(seq_->name.s, seq_->seq.s, qual, SolexaOffset);
-//            free(qual);
-        }
+        read = std::move(batch_[batch_pos_++]);
         ReadAhead();
         return *this;
     }
@@ -101,10 +110,14 @@ public:
     /* virtual */
     void close() {
         if (is_open_) {
-            // STEP 5: destroy seq
-            fastafastqgz::kseq_destroy(seq_);
-            // STEP 6: close the file handler
-            gzclose(fp_);
+            // Unblock the parsing thread wherever it waits and let it finish
+            batches_->close();
+            reader_->cancel();
+            parser_.join();
+            batches_.reset();
+            reader_.reset();
+            batch_.clear();
+            batch_pos_ = 0;
             is_open_ = false;
             eof_ = true;
         }
@@ -112,14 +125,26 @@ public:
 
 private:
     /*
-     * @variable File that is associated with gzipped data file.
+     * @variable The number of threads decompressing the file.
+     */
+    unsigned nthreads_;
+    /*
+     * @variable Decompressed data of the file.
+     */
+    std::unique_ptr<ParallelGzReader> reader_;
+    /*
+     * @variable Batches of reads parsed ahead.
+     */
+    std::unique_ptr<BlockingQueue<ReadBatch>> batches_;
+    /*
+     * @variable Parsing thread.
      */
-    gzFile fp_;
+    std::thread parser_;
     /*
-     * @variable Data element that stores last SingleRead got from
-     * stream.
+     * @variable Current batch and the position of the next read in it.
      */
-    fastafastqgz::kseq_t* seq_;
+    ReadBatch batch_;
+    size_t batch_pos_;
 
     /*
      * Open a stream.
@@ -127,25 +152,61 @@ private:
     /* virtual */
     void open() {
         // STEP 2: open the file handler
-        fp_ = gzopen(filename_.c_str(), "r");
-        if (!fp_) {
+        reader_.reset(new ParallelGzReader(filename_, nthreads_));
+        if (!reader_->is_open()) {
+            reader_.reset();
             is_open_ = false;
             return;
         }
-        // STEP 3: initialize seq
-        seq_ = fastafastqgz::kseq_init(fp_);
+        batches_.reset(new BlockingQueue<ReadBatch>(BATCH_QUEUE_CAPACITY));
+        parser_ = std::thread(&FastaFastqGzParser::Parse, this);
         eof_ = false;
         is_open_ = true;
         ReadAhead();
     }
 
+    /*
+     * Parse the reads into batches, runs in its own thread.
+     */
+    void Parse() {
+        // STEP 3: initialize seq
+        fastafastqgz::kseq_t* seq = fastafastqgz::kseq_init(reader_.get());
+        ReadBatch batch;
+        batch.reserve(BATCH_SIZE);
+        // STEP 4: read sequences
+        while (fastafastqgz::kseq_read(seq) >= 0) {
+            if (seq->qual.s) {
+                batch.emplace_back(seq->name.s, seq->seq.s, seq->qual.s, offset_type_);
+            } else {
+                batch.emplace_back(seq->name.s, seq->seq.s);
+            }
+
+            if (batch.size() == BATCH_SIZE) {
+                if (!batches_->push(std::move(batch)))
+                    break;
+                batch.clear();
+                batch.reserve(BATCH_SIZE);
+            }
+        }
+        if (!batch.empty())
+            batches_->push(std::move(batch));
+        batches_->close();
+        // STEP 5: destroy seq
+        fastafastqgz::kseq_destroy(seq);
+    }
+
     /*
      * Read next SingleRead from file.
      */
     void ReadAhead() {
         VERIFY(is_open_);
         VERIFY(!eof_);
-        if (fastafastqgz::kseq_read(seq_) < 0) {
+        if (batch_pos_ < batch_.size())
+            return;
+
+        batch_.clear();
+        batch_pos_ = 0;
+        if (!batches_->pop(batch_)) {
             eof_ = true;
         }
     }
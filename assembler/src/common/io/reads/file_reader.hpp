@@ -31,12 +31,14 @@ public:
      * @param distance Doesn't have any sense here, but necessary for
      * wrappers.
      * @param offset The offset of the read quality.
+     * @param nthreads The number of threads decompressing the file.
      */
     explicit FileReadStream(const std::string &filename,
-                            OffsetType offset_type = PhredOffset)
+                            OffsetType offset_type = PhredOffset,
+                            unsigned nthreads = 1)
             : filename_(filename), offset_type_(offset_type), parser_(NULL) {
         path::CheckFileExistenceFATAL(filename_);
-        parser_ = SelectParser(filename_, offset_type_);
+        parser_ = SelectParser(filename_, offset_type_, nthreads);
     }
 
     /*
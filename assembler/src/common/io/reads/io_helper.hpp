@@ -65,8 +65,9 @@ namespace io {
     }
     
     inline SingleStreamPtr EasyStream(const std::string& filename, bool followed_by_rc,
-                                      bool handle_Ns = true, OffsetType offset_type = PhredOffset) {
-        SingleStreamPtr reader = make_shared<FileReadStream>(filename, offset_type);
+                                      bool handle_Ns = true, OffsetType offset_type = PhredOffset,
+                                      unsigned nthreads = 1) {
+        SingleStreamPtr reader = make_shared<FileReadStream>(filename, offset_type, nthreads);
         if (handle_Ns) {
             reader = CarefulFilteringWrap<SingleRead>(reader);
         }
@@ -92,10 +93,10 @@ namespace io {
     inline PairedStreamPtr PairedEasyStream(const std::string& filename1, const std::string& filename2,
                                      bool followed_by_rc, size_t insert_size, bool change_read_order = false,
                                      bool use_orientation = true, LibraryOrientation orientation = LibraryOrientation::FR,
-                                     OffsetType offset_type = PhredOffset) {
+                                     OffsetType offset_type = PhredOffset, unsigned nthreads = 1) {
         PairedStreamPtr reader = make_shared<SeparatePairedReadStream>(filename1, filename2, insert_size,
                                                              change_read_order, use_orientation,
-                                                             orientation, offset_type);
+                                                             orientation, offset_type, nthreads);
         //Use orientation for IS calculation if it's not done by changer
         return WrapPairedStream(reader, followed_by_rc, !use_orientation, orientation);
     }
@@ -103,9 +104,9 @@ namespace io {
     inline PairedStreamPtr PairedEasyStream(const std::string& filename, bool followed_by_rc,
             size_t insert_size, bool change_read_order = false,
             bool use_orientation = true, LibraryOrientation orientation = LibraryOrientation::FR,
-            OffsetType offset_type = PhredOffset) {
+            OffsetType offset_type = PhredOffset, unsigned nthreads = 1) {
         PairedStreamPtr reader = make_shared<InterleavingPairedReadStream>(filename, insert_size, change_read_order,
-                                use_orientation, orientation, offset_type);
+                                use_orientation, orientation, offset_type, nthreads);
         //Use orientation for IS calculation if it's not done by changer
         return WrapPairedStream(reader, followed_by_rc, !use_orientation, orientation);
     }
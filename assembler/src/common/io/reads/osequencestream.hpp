@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <vector>
@@ -51,14 +52,15 @@ protected:
     void write_str(const std::string& s) {
         size_t cur = 0;
         while (cur < s.size()) {
-            ofstream_ << s.substr(cur, 60) << std::endl;
-            cur += 60;
+            size_t len = std::min(size_t(60), s.size() - cur);
+            ofstream_.write(s.data() + cur, len) << '\n';
+            cur += len;
         }
     }
 
     virtual void write_header(const std::string& s) {
         // Velvet format: NODE_1_length_24705_cov_358.255249
-        ofstream_ << ">" << MakeContigId(id_++, s.size()) << std::endl;
+        ofstream_ << ">" << MakeContigId(id_++, s.size()) << '\n';
     }
 
 public:
@@ -87,11 +89,11 @@ public:
      * Doesn't increase counters, don't mix with other methods!
      */
     virtual osequencestream& operator<<(const SingleRead& read) {
-        ofstream_ << ">" << read.name() << std::endl;
+        ofstream_ << ">" << read.name() << '\n';
         size_t cur = 0;
         std::string s = read.GetSequenceString();
         while (cur < s.size()) {
-            ofstream_ << s.substr(cur, 60) << std::endl;
+            ofstream_ << s.substr(cur, 60) << '\n';
             cur += 60;
         }
         return *this;
@@ -109,11 +111,11 @@ protected:
     std::ofstream ofstreamr_;
 
   static void write(const SingleRead& read, std::ofstream& stream) {
-    stream << ">" << read.name() << std::endl;
+    stream << ">" << read.name() << '\n';
     size_t cur = 0;
     std::string s = read.GetSequenceString();
     while (cur < s.size()) {
-      stream << s.substr(cur, 60) << std::endl;
+      stream << s.substr(cur, 60) << '\n';
       cur += 60;
     }
   }
@@ -143,7 +145,7 @@ protected:
 
     virtual void write_header(const std::string& s) {
         // Velvet format: NODE_1_length_24705_cov_358.255249
-        ofstream_ << ">" << MakeContigId(id_++, s.size(), coverage_) << std::endl;
+        ofstream_ << ">" << MakeContigId(id_++, s.size(), coverage_) << '\n';
     }
 
 
@@ -181,7 +183,7 @@ protected:
     double cov_;
 
     virtual void write_header(const std::string& /*s*/) {
-        ofstream_ << ">" << header_ << std::endl;
+        ofstream_ << ">" << header_ << '\n';
     }
 
 public:
@@ -216,7 +218,7 @@ protected:
     double cov_;
 
     virtual void write_header(const std::string& s) {
-        ofstream_ << ">" << GetId(s) << std::endl;
+        ofstream_ << ">" << GetId(s) << '\n';
         id_++;
     }
 
@@ -266,7 +268,7 @@ class osequencestream_with_manual_node_id: public osequencestream_with_id {
             WARN ("NODE ID is not set manually, setting to 0");
             id_ = 0;
         }
-        ofstream_ << ">" << MakeContigId(id_, s.size(), cov_, uid_) << std::endl;
+        ofstream_ << ">" << MakeContigId(id_, s.size(), cov_, uid_) << '\n';
         is_id_set_ = false;
     }
 
@@ -301,8 +303,8 @@ protected:
     std::ofstream scstream_;
 
     virtual void write_header(const std::string& s) {
-        scstream_ << id_ << "\tNODE_" << id_ << "\t" << s.size() << "\t" << (int) round(cov_) << std::endl;
-        ofstream_ << ">" << MakeContigId(id_++, s.size(), cov_, uid_) << std::endl;
+        scstream_ << id_ << "\tNODE_" << id_ << "\t" << s.size() << "\t" << (int) round(cov_) << '\n';
+        ofstream_ << ">" << MakeContigId(id_++, s.size(), cov_, uid_) << '\n';
     }
 
 public:
@@ -362,7 +364,7 @@ public:
                 ++iter;
             }
         }
-        ofstream_ << ";" << std::endl;
+        ofstream_ << ";" << '\n';
         return *this;
     }
 
@@ -28,14 +28,14 @@ class SeparatePairedReadStream : public ReadStream<PairedRead> {
   explicit SeparatePairedReadStream(const std::string& filename1, const std::string& filename2,
          size_t insert_size, bool change_order = false,
          bool use_orientation = true, LibraryOrientation orientation = LibraryOrientation::FR,
-         OffsetType offset_type = PhredOffset)
+         OffsetType offset_type = PhredOffset, unsigned nthreads = 1)
       : insert_size_(insert_size),
         change_order_(change_order),
         use_orientation_(use_orientation),
         changer_(GetOrientationChanger<PairedRead>(orientation)),
         offset_type_(offset_type),
-        first_(new FileReadStream(filename1, offset_type_)),
-        second_(new FileReadStream(filename2, offset_type_)),
+        first_(new FileReadStream(filename1, offset_type_, nthreads)),
+        second_(new FileReadStream(filename2, offset_type_, nthreads)),
         filename1_(filename1),
         filename2_(filename2){}
 
@@ -153,13 +153,13 @@ class InterleavingPairedReadStream : public ReadStream<PairedRead> {
    */
   explicit InterleavingPairedReadStream(const std::string& filename, size_t insert_size, bool change_order = false,
           bool use_orientation = true, LibraryOrientation orientation = LibraryOrientation::FR,
-          OffsetType offset_type = PhredOffset)
+          OffsetType offset_type = PhredOffset, unsigned nthreads = 1)
       : filename_(filename), insert_size_(insert_size),
         change_order_(change_order),
         use_orientation_(use_orientation),
         changer_(GetOrientationChanger<PairedRead>(orientation)),
         offset_type_(offset_type),
-        single_(new FileReadStream(filename_, offset_type_)) {}
+        single_(new FileReadStream(filename_, offset_type_, nthreads)) {}
 
   /*
    * Check whether the stream is opened.
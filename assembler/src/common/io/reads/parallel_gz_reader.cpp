@@ -0,0 +1,425 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#include "parallel_gz_reader.hpp"
+
+#include "utils/logger/logger.hpp"
+#include "utils/openmp_wrapper.h"
+#include "utils/verify.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <initializer_list>
+
+namespace io {
+
+namespace {
+
+// Compressed input is read by windows of this size per decompression thread,
+// speculation never looks past the window
+const size_t WINDOW_PER_THREAD = 1 << 20;
+const size_t MIN_WINDOW_SIZE = 2 << 20;
+// Sequential inflate hands out the data by chunks of this size
+const size_t CHUNK_SIZE = 1 << 20;
+// Number of decompressed chunks the reader could run ahead of the consumer
+const size_t QUEUE_CAPACITY = 4;
+
+enum HeaderStatus {
+    HEADER_INVALID,
+    HEADER_INCOMPLETE,
+    HEADER_OK
+};
+
+struct GzipHeader {
+    size_t length;
+    // Total size of the member for BGZF, 0 otherwise
+    size_t bgzf_size;
+    uint8_t xfl;
+    uint8_t os;
+};
+
+enum GzipFlags {
+    FHCRC = 2,
+    FEXTRA = 4,
+    FNAME = 8,
+    FCOMMENT = 16,
+    FRESERVED = 0xE0
+};
+
+size_t ReadLE16(const uint8_t *p) {
+    return size_t(p[0]) | size_t(p[1]) << 8;
+}
+
+uint32_t ReadLE32(const uint8_t *p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+HeaderStatus ParseGzipHeader(const uint8_t *p, size_t avail, GzipHeader &header) {
+    static const uint8_t MAGIC[] = { 0x1f, 0x8b, 0x08 };
+    for (size_t i = 0; i < std::min(avail, sizeof(MAGIC)); ++i)
+        if (p[i] != MAGIC[i])
+            return HEADER_INVALID;
+
+    size_t len = 10;
+    if (avail < len)
+        return HEADER_INCOMPLETE;
+
+    uint8_t flags = p[3];
+    if (flags & FRESERVED)
+        return HEADER_INVALID;
+
+    header.bgzf_size = 0;
+    header.xfl = p[8];
+    header.os = p[9];
+    if (flags & FEXTRA) {
+        if (avail < len + 2)
+            return HEADER_INCOMPLETE;
+        size_t xlen = ReadLE16(p + len);
+        len += 2;
+        if (avail < len + xlen)
+            return HEADER_INCOMPLETE;
+
+        // BGZF stores the member size minus one in the 'BC' subfield
+        for (size_t off = len; off + 4 <= len + xlen; off += 4 + ReadLE16(p + off + 2)) {
+            if (p[off] == 'B' && p[off + 1] == 'C' && ReadLE16(p + off + 2) == 2 && off + 6 <= len + xlen)
+                header.bgzf_size = ReadLE16(p + off + 4) + 1;
+        }
+        len += xlen;
+    }
+
+    for (uint8_t flag : { FNAME, FCOMMENT }) {
+        if (!(flags & flag))
+            continue;
+        if (avail <= len)
+            return HEADER_INCOMPLETE;
+        const uint8_t *end = (const uint8_t*)memchr(p + len, 0, avail - len);
+        if (!end)
+            return HEADER_INCOMPLETE;
+        len = (end - p) + 1;
+    }
+
+    if (flags & FHCRC)
+        len += 2;
+    if (avail < len)
+        return HEADER_INCOMPLETE;
+
+    header.length = len;
+    return HEADER_OK;
+}
+
+// Weeds out most of the random magic matches inside the compressed data
+bool IsPlausibleMember(const GzipHeader &header) {
+    return (header.xfl == 0 || header.xfl == 2 || header.xfl == 4) &&
+           (header.os <= 13 || header.os == 255);
+}
+
+// Inflates the raw deflate data of the member with known decompressed size
+bool InflateRaw(const uint8_t *in, size_t in_size, char *out, size_t out_size, uint32_t crc) {
+    if (out_size == 0)
+        return true;
+
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, -MAX_WBITS) != Z_OK)
+        return false;
+
+    strm.next_in = const_cast<Bytef*>(in);
+    strm.avail_in = (uInt)in_size;
+    strm.next_out = (Bytef*)out;
+    strm.avail_out = (uInt)out_size;
+    int ret = inflate(&strm, Z_FINISH);
+    bool ok = (ret == Z_STREAM_END && strm.avail_out == 0);
+    inflateEnd(&strm);
+
+    return ok && crc32(0, (const Bytef*)out, (uInt)out_size) == crc;
+}
+
+// Inflates the whole gzip member starting at in, zlib checks the trailer for us
+bool InflateMember(const uint8_t *in, size_t in_size, std::string &out, size_t &consumed) {
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (inflateInit2(&strm, MAX_WBITS + 16) != Z_OK)
+        return false;
+
+    strm.next_in = const_cast<Bytef*>(in);
+    strm.avail_in = (uInt)std::min(in_size, size_t(UINT_MAX));
+    out.resize(1 << 20);
+    size_t filled = 0;
+    int ret;
+    do {
+        if (filled == out.size())
+            out.resize(2 * out.size());
+        strm.next_out = (Bytef*)&out[filled];
+        strm.avail_out = (uInt)(out.size() - filled);
+        ret = inflate(&strm, Z_NO_FLUSH);
+        filled = out.size() - strm.avail_out;
+    } while (ret == Z_OK);
+
+    consumed = strm.total_in;
+    inflateEnd(&strm);
+    out.resize(filled);
+
+    return ret == Z_STREAM_END;
+}
+
+}
+
+struct ParallelGzReader::Block {
+    size_t offset;
+    size_t size;
+    size_t header_length;
+    size_t output_offset;
+    size_t output_size;
+};
+
+ParallelGzReader::ParallelGzReader(const std::string &filename, unsigned nthreads)
+        : filename_(filename), file_(fopen(filename.c_str(), "rb")),
+          nthreads_(std::max(nthreads, 1u)),
+          window_size_(std::max(MIN_WINDOW_SIZE, nthreads_ * WINDOW_PER_THREAD)),
+          in_pos_(0), in_eof_(false), stopped_(false),
+          chunks_(QUEUE_CAPACITY), chunk_pos_(0) {
+    if (file_)
+        thread_ = std::thread(&ParallelGzReader::Run, this);
+}
+
+ParallelGzReader::~ParallelGzReader() {
+    cancel();
+    if (thread_.joinable())
+        thread_.join();
+    if (file_)
+        fclose(file_);
+}
+
+int ParallelGzReader::read(void *buf, unsigned len) {
+    char *out = (char*)buf;
+    size_t copied = 0;
+    while (copied < len) {
+        if (chunk_pos_ == chunk_.size()) {
+            chunk_pos_ = 0;
+            chunk_.clear();
+            if (!chunks_.pop(chunk_))
+                break;
+            continue;
+        }
+
+        size_t n = std::min(len - copied, chunk_.size() - chunk_pos_);
+        memcpy(out + copied, chunk_.data() + chunk_pos_, n);
+        chunk_pos_ += n;
+        copied += n;
+    }
+
+    return (int)copied;
+}
+
+void ParallelGzReader::Refill(size_t target) {
+    if (in_pos_) {
+        in_.erase(in_.begin(), in_.begin() + in_pos_);
+        in_pos_ = 0;
+    }
+
+    if (in_eof_ || in_.size() >= target)
+        return;
+
+    size_t size = in_.size();
+    in_.resize(target);
+    size_t n = fread(in_.data() + size, 1, target - size, file_);
+    in_.resize(size + n);
+    if (n < target - size)
+        in_eof_ = true;
+}
+
+bool ParallelGzReader::Ensure(size_t bytes) {
+    while (available() < bytes && !in_eof_)
+        Refill(std::max(bytes, window_size_));
+
+    return available() >= bytes;
+}
+
+bool ParallelGzReader::Emit(std::string &&chunk) {
+    if (chunk.empty())
+        return true;
+
+    if (!chunks_.push(std::move(chunk)))
+        stopped_ = true;
+
+    return !stopped_;
+}
+
+void ParallelGzReader::Run() {
+    Refill(window_size_);
+    if (available() < 2 || input()[0] != 0x1f || input()[1] != 0x8b) {
+        PassThrough();
+        chunks_.close();
+        return;
+    }
+
+    bool speculate = false;
+    while (!stopped_ && Ensure(1)) {
+        GzipHeader header;
+        HeaderStatus status;
+        while ((status = ParseGzipHeader(input(), available(), header)) == HEADER_INCOMPLETE &&
+               Ensure(available() + 1)) {}
+
+        // Trailing garbage after the last member is ignored, the same as gzread does
+        if (status != HEADER_OK)
+            break;
+
+        bool done;
+        if (header.bgzf_size)
+            done = InflateBlocks();
+        else
+            done = speculate && InflateSpeculatively();
+
+        if (!done) {
+            StreamMember();
+            // Once we have seen one member finish, the file might consist of many of them
+            speculate = true;
+        }
+    }
+
+    chunks_.close();
+}
+
+void ParallelGzReader::PassThrough() {
+    while (!stopped_ && Ensure(1)) {
+        Emit(std::string(input(), input() + available()));
+        in_pos_ = in_.size();
+    }
+}
+
+bool ParallelGzReader::InflateBlocks() {
+    Refill(window_size_);
+
+    const uint8_t *data = input();
+    size_t avail = available();
+    std::vector<Block> blocks;
+    size_t offset = 0, output_size = 0;
+    while (offset < avail && output_size < 4 * window_size_) {
+        GzipHeader header;
+        if (ParseGzipHeader(data + offset, avail - offset, header) != HEADER_OK ||
+            header.bgzf_size < header.length + 8 || offset + header.bgzf_size > avail)
+            break;
+
+        Block block;
+        block.offset = offset;
+        block.size = header.bgzf_size;
+        block.header_length = header.length;
+        block.output_offset = output_size;
+        block.output_size = ReadLE32(data + offset + block.size - 4);
+        blocks.push_back(block);
+
+        offset += block.size;
+        output_size += block.output_size;
+    }
+
+    if (blocks.empty())
+        return false;
+
+    std::string output(output_size, '\0');
+    std::vector<uint8_t> ok(blocks.size());
+#   pragma omp parallel for schedule(dynamic) num_threads(nthreads_)
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const Block &block = blocks[i];
+        const uint8_t *member = data + block.offset;
+        ok[i] = InflateRaw(member + block.header_length, block.size - block.header_length - 8,
+                           &output[0] + block.output_offset, block.output_size,
+                           ReadLE32(member + block.size - 8));
+    }
+
+    if (std::find(ok.begin(), ok.end(), 0) != ok.end())
+        FATAL_ERROR("Corrupted BGZF block in file " << filename_);
+
+    in_pos_ += offset;
+    Emit(std::move(output));
+
+    return true;
+}
+
+bool ParallelGzReader::InflateSpeculatively() {
+    Refill(window_size_);
+
+    const uint8_t *data = input();
+    size_t avail = available();
+    std::vector<size_t> candidates = { 0 };
+    for (const uint8_t *p = data + 1; p < data + avail; ++p) {
+        p = (const uint8_t*)memchr(p, 0x1f, data + avail - p);
+        if (!p)
+            break;
+
+        GzipHeader header;
+        if (ParseGzipHeader(p, data + avail - p, header) == HEADER_OK && IsPlausibleMember(header))
+            candidates.push_back(p - data);
+    }
+
+    std::vector<std::string> outputs(candidates.size());
+    std::vector<size_t> consumed(candidates.size(), 0);
+#   pragma omp parallel for schedule(dynamic) num_threads(nthreads_)
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (!InflateMember(data + candidates[i], avail - candidates[i], outputs[i], consumed[i])) {
+            consumed[i] = 0;
+            outputs[i].clear();
+        }
+    }
+
+    // Chain the members which were decoded successfully from the current position
+    size_t offset = 0, i = 0;
+    while (i < candidates.size() && candidates[i] == offset && consumed[i]) {
+        offset += consumed[i];
+        if (!Emit(std::move(outputs[i])))
+            break;
+        i = std::lower_bound(candidates.begin() + i + 1, candidates.end(), offset) - candidates.begin();
+    }
+    in_pos_ += offset;
+
+    return offset > 0;
+}
+
+bool ParallelGzReader::StreamMember() {
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    VERIFY(inflateInit2(&strm, MAX_WBITS + 16) == Z_OK);
+
+    std::string chunk(CHUNK_SIZE, '\0');
+    size_t filled = 0;
+    int ret = Z_OK;
+    while (!stopped_) {
+        if (available() == 0 && !Ensure(1))
+            break;
+
+        size_t avail = std::min(available(), size_t(UINT_MAX));
+        strm.next_in = const_cast<Bytef*>(input());
+        strm.avail_in = (uInt)avail;
+        strm.next_out = (Bytef*)&chunk[filled];
+        strm.avail_out = (uInt)(CHUNK_SIZE - filled);
+        ret = inflate(&strm, Z_NO_FLUSH);
+        in_pos_ += avail - strm.avail_in;
+        filled = CHUNK_SIZE - strm.avail_out;
+
+        if (filled == CHUNK_SIZE) {
+            Emit(std::move(chunk));
+            chunk.assign(CHUNK_SIZE, '\0');
+            filled = 0;
+        }
+
+        if (ret == Z_STREAM_END || (ret != Z_OK && !(ret == Z_BUF_ERROR && available() == 0)))
+            break;
+    }
+    inflateEnd(&strm);
+
+    if (stopped_)
+        return false;
+
+    if (ret != Z_STREAM_END)
+        FATAL_ERROR("Corrupted or truncated gzip data in file " << filename_);
+
+    chunk.resize(filled);
+    return Emit(std::move(chunk));
+}
+
+}
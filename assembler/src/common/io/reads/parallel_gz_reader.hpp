@@ -0,0 +1,149 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace io {
+
+/**
+ * @brief Bounded FIFO handing data over between the reader threads. push() blocks
+ *        while the queue is full and pop() blocks while it is empty. After close()
+ *        push() fails immediately, while pop() still drains the remaining items.
+ */
+template<class T>
+class BlockingQueue {
+public:
+    explicit BlockingQueue(size_t capacity)
+            : capacity_(capacity), closed_(false) {}
+
+    bool push(T &&value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || queue_.size() < capacity_; });
+        if (closed_)
+            return false;
+
+        queue_.push_back(std::move(value));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    bool pop(T &value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+        if (queue_.empty())
+            return false;
+
+        value = std::move(queue_.front());
+        queue_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    size_t capacity_;
+    bool closed_;
+    std::deque<T> queue_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_, not_full_;
+};
+
+/**
+ * @brief Reads the decompressed contents of a (possibly) gzipped file. Decompression
+ *        runs in the background thread ahead of the consumer:
+ *        - BGZF blocks carry their compressed size in the header, so batches of them
+ *          are inflated in parallel;
+ *        - for the ordinary multi-member gzip all the plausible member headers in the
+ *          input window are inflated speculatively in parallel and the results are
+ *          chained from the current position, wrong guesses are simply dropped;
+ *        - a single gzip member (and whatever speculation failed to split) is inflated
+ *          sequentially, still overlapping with the parsing.
+ *        Files without gzip magic are passed through as is, the same as gzread does.
+ *        The inflating runs in nthreads threads (the background one included), the
+ *        caller opening several readers at once should split its budget between them.
+ */
+class ParallelGzReader {
+public:
+    ParallelGzReader(const std::string &filename, unsigned nthreads);
+    ~ParallelGzReader();
+
+    bool is_open() const {
+        return file_ != nullptr;
+    }
+
+    /*
+     * Copy up to len decompressed bytes into buf.
+     *
+     * @return The number of bytes copied, 0 at the end of data.
+     */
+    int read(void *buf, unsigned len);
+
+    /*
+     * Stop the decompression, any further read() reaches the end of data
+     * after the already decompressed chunks.
+     */
+    void cancel() {
+        chunks_.close();
+    }
+
+private:
+    struct Block;
+
+    void Run();
+    void PassThrough();
+    bool InflateBlocks();
+    bool InflateSpeculatively();
+    bool StreamMember();
+
+    size_t available() const {
+        return in_.size() - in_pos_;
+    }
+    const uint8_t *input() const {
+        return in_.data() + in_pos_;
+    }
+    void Refill(size_t target);
+    bool Ensure(size_t bytes);
+    bool Emit(std::string &&chunk);
+
+    std::string filename_;
+    FILE *file_;
+    unsigned nthreads_;
+    size_t window_size_;
+
+    // Producer side: window of compressed data, [in_pos_, in_.size()) is not consumed yet
+    std::vector<uint8_t> in_;
+    size_t in_pos_;
+    bool in_eof_;
+    bool stopped_;
+
+    BlockingQueue<std::string> chunks_;
+
+    // Consumer side: the chunk being read
+    std::string chunk_;
+    size_t chunk_pos_;
+
+    std::thread thread_;
+
+    ParallelGzReader(const ParallelGzReader &) = delete;
+    void operator=(const ParallelGzReader &) = delete;
+};
+
+}
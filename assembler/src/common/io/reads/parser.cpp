@@ -65,12 +65,13 @@ std::string GetExtension(const std::string& filename) {
  * offset.
  */
 Parser* SelectParser(const std::string& filename,
-                     OffsetType offset_type /*= PhredOffset*/) {
+                     OffsetType offset_type /*= PhredOffset*/,
+                     unsigned nthreads /*= 1*/) {
   std::string ext = GetExtension(filename);
   if (ext == "bam")
-      return new BAMParser(filename, offset_type);
+      return new BAMParser(filename, offset_type, nthreads);
 
-  return new FastaFastqGzParser(filename, offset_type);
+  return new FastaFastqGzParser(filename, offset_type, nthreads);
   /*
   if ((ext == "fastq") || (ext == "fastq.gz") ||
       (ext == "fasta") || (ext == "fasta.gz") ||
@@ -8,22 +8,23 @@
 #ifndef COMMON_IO_BAMPARSER_HPP
 #define COMMON_IO_BAMPARSER_HPP
 
-#include "reads/single_read.hpp"
+#include "io/reads/single_read.hpp"
 #include "io/reads/parser.hpp"
+#include "io/sam/sam_reader.hpp"
 #include "sequence/quality.hpp"
 #include "sequence/nucl.hpp"
 #include "utils/verify.hpp"
 
-#include "bamtools/api/BamReader.h"
-
+#include <memory>
 #include <string>
 
 namespace io {
 
 class BAMParser: public Parser {
 public:
-    BAMParser(const std::string& filename, OffsetType offset_type = PhredOffset)
-            : Parser(filename, offset_type) {
+    BAMParser(const std::string& filename, OffsetType offset_type = PhredOffset,
+              unsigned nthreads = 1)
+            : Parser(filename, offset_type), nthreads_(nthreads) {
         open();
     }
 
@@ -35,27 +36,33 @@ public:
         if (!is_open_ || eof_)
             return *this;
 
-        read = SingleRead(seq_.Name, seq_.QueryBases, seq_.Qualities, offset_type_);
-        eof_ = (false == reader_.GetNextAlignment(seq_));
+        *reader_ >> seq_;
+        std::string qual = seq_.qual();
+        if (qual.empty())
+            read = SingleRead(seq_.name(), seq_.seq());
+        else
+            read = SingleRead(seq_.name(), seq_.seq(), qual, offset_type_);
+        eof_ = reader_->eof();
 
         return *this;
     }
 
     void close() {
-        reader_.Close();
+        reader_.reset();
         is_open_ = false;
         eof_ = true;
     }
 
 private:
-    BamTools::BamReader reader_;
-    BamTools::BamAlignment seq_;
+    unsigned nthreads_;
+    std::unique_ptr<sam_reader::MappedSamStream> reader_;
+    sam_reader::SingleSamRead seq_;
 
     void open() {
-        reader_.Open(filename_);
-        is_open_ = true;
+        reader_.reset(new sam_reader::MappedSamStream(filename_, nthreads_));
+        is_open_ = reader_->is_open();
 
-        eof_ = (false == reader_.GetNextAlignment(seq_));
+        eof_ = reader_->eof();
     }
 
     BAMParser(const BAMParser& parser);
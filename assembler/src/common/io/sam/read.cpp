@@ -37,6 +37,17 @@ string SingleSamRead::seq() const {
     return res;
 }
 
+string SingleSamRead::qual() const {
+    string res = "";
+    auto q = bam1_qual(data_);
+    if (data_->core.l_qseq == 0 || q[0] == 0xff)
+        return res;
+    for (int k = 0; k < data_->core.l_qseq; ++k) {
+        res += char(q[k] + 33);
+    }
+    return res;
+}
+
 
 }
 ;
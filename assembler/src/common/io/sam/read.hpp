@@ -31,8 +31,8 @@ public:
         bam_destroy1(data_);
     }
     SingleSamRead& operator= (const SingleSamRead &c){
-        bam_destroy1(data_);
-        data_ = bam_dup1(c.data_);
+        if (this != &c)
+            bam_copy1(data_, c.data_);
         return *this;
     }
 
@@ -83,10 +83,12 @@ public:
     std::string cigar() const;
     std::string name() const;
     std::string seq() const;
+    //Phred+33 as in SAM, empty when the qualities are absent
+    std::string qual() const;
 
+    //Reuses the already allocated storage
     void set_data(bam1_t *seq_) {
-        bam_destroy1(data_);
-        data_ = bam_dup1( seq_);
+        bam_copy1(data_, seq_);
     }
 };
 
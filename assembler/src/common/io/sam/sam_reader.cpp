@@ -8,8 +8,28 @@
 #include <io/sam/read.hpp>
 #include <io/sam/sam_reader.hpp>
 
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
 namespace sam_reader {
 
+namespace {
+
+const char BAM_MAGIC[4] = {'B', 'A', 'M', '\1'};
+
+bool IsGzipped(const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f)
+        return false;
+    unsigned char magic[2];
+    bool answer = fread(magic, 1, 2, f) == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+    fclose(f);
+    return answer;
+}
+
+}
+
 bool MappedSamStream::eof() const {
         return eof_;
 }
@@ -22,8 +42,7 @@ MappedSamStream& MappedSamStream::operator>>(SingleSamRead& read) {
     if (!is_open_ || eof_)
         return *this;
     read.set_data(seq_);
-    int tmp = samread(reader_, seq_);
-    eof_ = (0 >= tmp);
+    eof_ = !ReadNext();
     return *this;
 }
 
@@ -41,16 +60,28 @@ MappedSamStream& MappedSamStream::operator >>(PairedSamRead& read) {
     return *this;
 }
 
+size_t MappedSamStream::ReadBatch(std::vector<SingleSamRead>& reads) {
+    size_t cnt = 0;
+    for (; cnt < reads.size() && is_open_ && !eof_; ++cnt)
+        *this >> reads[cnt];
+    return cnt;
+}
+
 const char* MappedSamStream::get_contig_name(int i) const {
-    VERIFY(i < reader_->header->n_targets);
-    return (reader_->header->target_name[i]);
+    VERIFY(i < header_->n_targets);
+    return (header_->target_name[i]);
 }
 
 void MappedSamStream::close() {
-    samclose(reader_);
+    if (reader_)
+        samclose(reader_);
+    else if (header_)
+        bam_header_destroy(header_);
+    reader_ = nullptr;
+    header_ = nullptr;
+    bam_reader_.reset();
     is_open_ = false;
     eof_ = true;
-    bam_destroy1(seq_);
 }
 
 void MappedSamStream::reset() {
@@ -58,15 +89,113 @@ void MappedSamStream::reset() {
     open();
 }
 
+bool MappedSamStream::ReadBam(void *data, size_t len) {
+    char *out = (char*)data;
+    while (len > 0) {
+        int read = bam_reader_->read(out, (unsigned)std::min(len, size_t(INT_MAX)));
+        if (read <= 0)
+            return false;
+        out += read;
+        len -= read;
+    }
+    return true;
+}
+
+//The same layout as in bam_header_read(), the magic is already consumed
+bam_header_t *MappedSamStream::ReadBamHeader() {
+    bam_header_t *header = bam_header_init();
+    bool ok = ReadBam(&header->l_text, 4);
+    if (ok) {
+        header->text = (char*)calloc(header->l_text + 1, 1);
+        ok = ReadBam(header->text, header->l_text) && ReadBam(&header->n_targets, 4);
+    }
+    if (ok) {
+        header->target_name = (char**)calloc(header->n_targets, sizeof(char*));
+        header->target_len = (uint32_t*)calloc(header->n_targets, 4);
+    }
+    for (int32_t i = 0; ok && i < header->n_targets; ++i) {
+        int32_t name_len;
+        ok = ReadBam(&name_len, 4);
+        if (ok) {
+            header->target_name[i] = (char*)calloc(name_len, 1);
+            ok = ReadBam(header->target_name[i], name_len) && ReadBam(&header->target_len[i], 4);
+        }
+    }
+    if (!ok) {
+        bam_header_destroy(header);
+        return nullptr;
+    }
+    return header;
+}
+
+//The same decoding as in bam_read1(), SPAdes runs on little-endian hosts only
+bool MappedSamStream::ReadBamRecord(bam1_t *b) {
+    bam1_core_t *c = &b->core;
+    int32_t block_len;
+    uint32_t x[8];
+
+    if (!ReadBam(&block_len, 4))
+        return false;
+    if (block_len < int32_t(BAM_CORE_SIZE) || !ReadBam(x, BAM_CORE_SIZE)) {
+        WARN("Truncated BAM file " << filename_);
+        return false;
+    }
+    c->tid = x[0]; c->pos = x[1];
+    c->bin = uint16_t(x[2] >> 16); c->qual = uint8_t(x[2] >> 8 & 0xff); c->l_qname = uint8_t(x[2] & 0xff);
+    c->flag = uint16_t(x[3] >> 16); c->n_cigar = uint16_t(x[3] & 0xffff);
+    c->l_qseq = x[4];
+    c->mtid = x[5]; c->mpos = x[6]; c->isize = x[7];
+    b->data_len = block_len - int32_t(BAM_CORE_SIZE);
+    if (b->m_data < b->data_len) {
+        b->m_data = b->data_len;
+        kroundup32(b->m_data);
+        b->data = (uint8_t*)realloc(b->data, b->m_data);
+    }
+    if (!ReadBam(b->data, b->data_len)) {
+        WARN("Truncated BAM file " << filename_);
+        return false;
+    }
+    b->l_aux = b->data_len - c->n_cigar * 4 - c->l_qname - c->l_qseq - (c->l_qseq + 1) / 2;
+    return true;
+}
+
+bool MappedSamStream::OpenBam() {
+    if (!IsGzipped(filename_))
+        return false;
+    bam_reader_.reset(new io::ParallelGzReader(filename_, nthreads_));
+    char magic[4];
+    if (!ReadBam(magic, 4) || !std::equal(magic, magic + 4, BAM_MAGIC)) {
+        //gzipped SAM
+        bam_reader_.reset();
+        return false;
+    }
+    return true;
+}
+
+bool MappedSamStream::ReadNext() {
+    if (bam_reader_)
+        return ReadBamRecord(seq_);
+    return samread(reader_, seq_) > 0;
+}
+
 void MappedSamStream::open() {
-    if ((reader_ = samopen(filename_.c_str(), "r", NULL)) == NULL) {
+    if (OpenBam()) {
+        header_ = ReadBamHeader();
+        if (!header_) {
+            WARN("Fail to read BAM header of " << filename_);
+            bam_reader_.reset();
+        }
+    } else if ((reader_ = samopen(filename_.c_str(), "r", NULL)) != NULL) {
+        header_ = reader_->header;
+    }
+
+    if (!header_) {
         WARN("Fail to open SAM file " << filename_);
         is_open_ = false;
         eof_ = true;
     } else {
         is_open_ = true;
-        int tmp = samread(reader_, seq_);
-        eof_ = (0 >= tmp);
+        eof_ = !ReadNext();
     }
 }
 
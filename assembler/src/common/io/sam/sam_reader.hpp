@@ -8,41 +8,69 @@
 
 #include "read.hpp"
 
+#include "io/reads/parallel_gz_reader.hpp"
 #include "utils/logger/log_writers.hpp"
 
 #include <samtools/sam.h>
 #include <samtools/bam.h>
 
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace sam_reader {
 
+/**
+ * Sequential reader of SAM and BAM files. SAM is read with samtools, BAM records
+ * are decoded here, while their BGZF blocks are inflated by nthreads threads
+ * ahead of the decoding.
+ */
 class MappedSamStream {
 public:
-    MappedSamStream(const std::string &filename)
-            : filename_(filename) {
+    MappedSamStream(const std::string &filename, unsigned nthreads)
+            : filename_(filename), nthreads_(nthreads) {
         open();
     }
 
     virtual ~MappedSamStream() {
+        close();
+        bam_destroy1(seq_);
     }
 
     bool is_open() const;
     bool eof() const;
     MappedSamStream& operator >>(SingleSamRead& read);
     MappedSamStream& operator >>(PairedSamRead& read);
+
+    /*
+     * Read up to reads.size() alignments, the storage of the reads is reused.
+     *
+     * @return The number of alignments read.
+     */
+    size_t ReadBatch(std::vector<SingleSamRead>& reads);
+
     const char* get_contig_name(int i) const;
     void close();
     void reset();
 
 private:
-    samfile_t *reader_;
+    samfile_t *reader_ = nullptr;
+    std::unique_ptr<io::ParallelGzReader> bam_reader_;
+    bam_header_t *header_ = nullptr;
     bam1_t *seq_ = bam_init1();
     std::string filename_;
+    unsigned nthreads_;
     bool is_open_;
     bool eof_;
 
     void open();
+    bool OpenBam();
+    bool ReadBam(void *data, size_t len);
+    bam_header_t *ReadBamHeader();
+    bool ReadBamRecord(bam1_t *b);
+    bool ReadNext();
+
+    DECL_LOGGER("MappedSamStream");
 };
 
 }
@@ -13,6 +13,8 @@
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <cstring>
 
 // all of the bwa and kseq stuff is in unaligned sequence
 // best way I had to keep from clashes with klib macros
@@ -255,73 +257,87 @@ void BWAIndex::Init() {
     idx_->pac = fwd_pac;
 }
 
-omnigraph::MappingPath<debruijn_graph::EdgeId> BWAIndex::AlignSequence(const Sequence &sequence) const {
+static omnigraph::MappingPath<debruijn_graph::EdgeId> GetMappingPath(const debruijn_graph::Graph &g,
+                                                                     const bntseq_t *bns,
+                                                                     const std::vector<debruijn_graph::EdgeId> &ids,
+                                                                     const mem_alnreg_v &ar, size_t seq_length) {
     omnigraph::MappingPath<debruijn_graph::EdgeId> res;
 
-    if (!idx_) return res;
-
-    std::string seq = sequence.str();
-    mem_alnreg_v ar = mem_align1(memopt_.get(), idx_->bwt, idx_->bns, idx_->pac,
-                                 seq.length(), seq.data());
     for (size_t i = 0; i < ar.n; ++i) {
         const mem_alnreg_t &a = ar.a[i];
         if (a.secondary >= 0) continue; // skip secondary alignments
-//        if (a.qe - a.qb < g_.k()) continue; // skip short alignments
-//        if (a.re - a.rb < g_.k()) continue;
+//        if (a.qe - a.qb < g.k()) continue; // skip short alignments
+//        if (a.re - a.rb < g.k()) continue;
         int is_rev = 0;
-        size_t pos = bns_depos(idx_->bns, a.rb < idx_->bns->l_pac? a.rb : a.re - 1, &is_rev) - idx_->bns->anns[a.rid].offset;
-/*        fprintf(stderr, "%zu: [%lld, %lld]\t[%d, %d] %c %d %s %ld %zu\n",
-                i,
-                a.rb, a.re, a.qb, a.qe,
-                "+-"[is_rev], a.rid,
-                idx_->bns->anns[a.rid].name, g_.int_id(ids_[a.rid]), pos);
-*/
+        size_t pos = bns_depos(bns, a.rb < bns->l_pac? a.rb : a.re - 1, &is_rev) - bns->anns[a.rid].offset;
         size_t initial_range_end = a.qe;
         size_t mapping_range_end = pos + a.re - a.rb;
-        size_t read_length = seq.length() ;
+        size_t read_length = seq_length;
         //we had to reduce the range to kmer-based
-        if (pos + (a.re - a.rb) >= g_.length(ids_[a.rid]) ){
-            if (a.qe > g_.k() + a.qb)
-                initial_range_end -= g_.k();
+        if (pos + (a.re - a.rb) >= g.length(ids[a.rid]) ){
+            if (a.qe > g.k() + a.qb)
+                initial_range_end -= g.k();
             else continue;
-            if (a.re > g_.k() + a.rb)
-                mapping_range_end -= g_.k();
+            if (a.re > g.k() + a.rb)
+                mapping_range_end -= g.k();
             else continue;
-            if (read_length >= g_.k())
-                read_length -= g_.k();
+            if (read_length >= g.k())
+                read_length -= g.k();
             else continue;
         }
         // FIXME: Check this!
         if (!is_rev) {
-            res.push_back(ids_[a.rid],
+            res.push_back(ids[a.rid],
                           { { (size_t)a.qb, initial_range_end },
                             { pos, mapping_range_end}});
         } else {
-//          fprintf (stderr,"%d %d %d\n", a.qb, a.qe  - g_.k(), seq.length() - g_.k());
-
-//            fprintf (stderr,"%d %d %d\n", pos, pos + a.re - a.rb , g_.length(ids_[a.rid]) );
-
-            res.push_back(g_.conjugate(ids_[a.rid]),
+            res.push_back(g.conjugate(ids[a.rid]),
                           { omnigraph::Range(a.qb, initial_range_end).Invert(read_length),
-                            omnigraph::Range(pos, mapping_range_end ).Invert(g_.length(ids_[a.rid])) });
+                            omnigraph::Range(pos, mapping_range_end ).Invert(g.length(ids[a.rid])) });
 
         }
+    }
 
-#if 0
-        mem_aln_t aln = mem_reg2aln(memopt_.get(), idx_->bns, idx_->pac, seq.length(), seq.c_str(), &a);
+    return res;
+}
 
-        // print alignment
-        printf("\t%c\t%s\t%ld %ld %ld\t%d\t", "+-"[aln.is_rev], idx_->bns->anns[aln.rid].name, aln.rid, g_.int_id(ids_[aln.rid]), (long)aln.pos, aln.mapq);
-        for (int k = 0; k < aln.n_cigar; ++k) // print CIGAR
-            printf("%d%c", aln.cigar[k]>>4, "MIDSH"[aln.cigar[k]&0xf]);
-        printf("\t%d\n", aln.NM); // print edit distance
-        free(aln.cigar);
-#endif
+omnigraph::MappingPath<debruijn_graph::EdgeId> BWAIndex::AlignSequence(const Sequence &sequence) const {
+    if (!idx_) return omnigraph::MappingPath<debruijn_graph::EdgeId>();
 
-    }
+    std::string seq = sequence.str();
+    mem_alnreg_v ar = mem_align1(memopt_.get(), idx_->bwt, idx_->bns, idx_->pac,
+                                 seq.length(), seq.data());
+    auto res = GetMappingPath(g_, idx_->bns, ids_, ar, seq.length());
     free(ar.a);
 
     return res;
 }
 
+std::vector<omnigraph::MappingPath<debruijn_graph::EdgeId>> BWAIndex::AlignSequences(const std::vector<Sequence> &sequences) const {
+    std::vector<omnigraph::MappingPath<debruijn_graph::EdgeId>> res(sequences.size());
+    if (!idx_ || sequences.empty()) return res;
+
+    // BWA converts the queries into 2-bit encoding in place, so we need our own copies
+    std::vector<std::string> seqs(sequences.size());
+    std::vector<bseq1_t> batch(sequences.size());
+    for (size_t i = 0; i < sequences.size(); ++i) {
+        seqs[i] = sequences[i].str();
+        bseq1_t &s = batch[i];
+        memset(&s, 0, sizeof(s));
+        s.l_seq = (int)seqs[i].length();
+        s.id = (int)i;
+        s.seq = &seqs[i][0];
+    }
+
+    std::vector<mem_alnreg_v> regs(sequences.size());
+    mem_align_seqs(memopt_.get(), idx_->bwt, idx_->bns, idx_->pac,
+                   0, (int)batch.size(), batch.data(), regs.data());
+    for (size_t i = 0; i < regs.size(); ++i) {
+        res[i] = GetMappingPath(g_, idx_->bns, ids_, regs[i], seqs[i].length());
+        free(regs[i].a);
+    }
+
+    return res;
+}
+
 }
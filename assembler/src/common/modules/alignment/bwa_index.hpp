@@ -27,6 +27,10 @@ class BWAIndex {
     ~BWAIndex();
 
     omnigraph::MappingPath<debruijn_graph::EdgeId> AlignSequence(const Sequence &sequence) const;
+
+    // Aligns the whole batch with a single call to BWA, so seeding buffers
+    // are reused between the sequences
+    std::vector<omnigraph::MappingPath<debruijn_graph::EdgeId>> AlignSequences(const std::vector<Sequence> &sequences) const;
   private:
     void Init();
 
@@ -21,10 +21,14 @@ public:
             : debruijn_graph::AbstractSequenceMapper<Graph>(g),
             index_(g) {}
 
-    omnigraph::MappingPath<EdgeId> MapSequence(const Sequence &sequence) const {
+    omnigraph::MappingPath<EdgeId> MapSequence(const Sequence &sequence) const override {
         return index_.AlignSequence(sequence);
     }
 
+    std::vector<omnigraph::MappingPath<EdgeId>> MapSequences(const std::vector<Sequence> &sequences) const override {
+        return index_.AlignSequences(sequences);
+    }
+
     ~BWAReadMapper() {
     }
 
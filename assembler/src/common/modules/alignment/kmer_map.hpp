@@ -8,16 +8,129 @@
 #define __KMER_MAP_HPP__
 
 #include "sequence/rtseq.hpp"
+#include "utils/mph_index/mphf.hpp"
+#include "utils/mph_index/base_hash.hpp"
+#include "utils/mph_index/hypergraph_sorter_seq.hpp"
+#include "utils/openmp_wrapper.h"
 
 #include <htrie/hat-trie.h>
+#include <city/city.h>
 #include <boost/iterator/iterator_facade.hpp>
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
 namespace debruijn_graph {
 class KMerMap {
     typedef RtSeq Kmer;
     typedef RtSeq Seq;
     typedef typename Seq::DataType RawSeqData;
 
+    /**
+     * Read-only representation of the map. Keys are split into buckets by hash,
+     * every bucket is indexed by its own minimal perfect hash function and keys and
+     * values are stored packed (rawcnt_ words each) at the slot given by it.
+     * Blocked bloom filter in front of it rejects most of the absent keys (and
+     * the majority of queries are for absent ones) with a single cache line access.
+     * Values of the frozen keys could be updated in place and the keys could be marked
+     * as erased, the keys added after freezing are kept in the trie.
+     */
+    struct FrozenMap {
+        typedef emphf::mphf<emphf::city_hasher> BucketIndex;
+
+        size_t size;
+        unsigned rawcnt;
+        std::vector<size_t> bucket_starts;
+        std::vector<BucketIndex> index;
+        std::vector<RawSeqData> keys;
+        std::vector<RawSeqData> values;
+        std::vector<uint64_t> filter;
+        std::vector<bool> erased;
+        size_t erased_count;
+    };
+
+    static const size_t NO_SLOT = size_t(-1);
+
+    // 512-bit filter blocks, ~16 bits per key, 4 probes give ~0.1% false positives
+    static const size_t FILTER_BLOCK_WORDS = 8;
+    static const size_t FILTER_BITS_PER_KEY = 16;
+    static const unsigned FILTER_PROBES = 4;
+    static const size_t KEYS_PER_BUCKET = 1 << 12;
+
+    struct RawKeyAdaptor {
+        const RawSeqData *data;
+        unsigned rawcnt;
+
+        emphf::byte_range_t operator()(size_t idx) const {
+            const uint8_t *p = reinterpret_cast<const uint8_t*>(data + idx * rawcnt);
+            return std::make_pair(p, p + rawcnt * sizeof(RawSeqData));
+        }
+    };
+
+    struct KmerAdaptor {
+        unsigned rawcnt;
+
+        emphf::byte_range_t operator()(const Kmer &k) const {
+            const uint8_t *p = reinterpret_cast<const uint8_t*>(k.data());
+            return std::make_pair(p, p + rawcnt * sizeof(RawSeqData));
+        }
+    };
+
+    uint64_t raw_hash(const RawSeqData *data) const {
+        return CityHash64(reinterpret_cast<const char*>(data), rawcnt_ * sizeof(RawSeqData));
+    }
+
+    static size_t filter_block(const FrozenMap &frozen, uint64_t h) {
+        return (size_t)(h % (frozen.filter.size() / FILTER_BLOCK_WORDS)) * FILTER_BLOCK_WORDS;
+    }
+
+    static unsigned filter_bit(uint64_t h, unsigned probe) {
+        // Independent bits of the remixed hash select the bits inside the block
+        return (unsigned)((h * 0x9E3779B97F4A7C15ULL) >> (64 - 9 * (probe + 1))) & 511;
+    }
+
+    static bool filter_contains(const FrozenMap &frozen, uint64_t h) {
+        const uint64_t *block = frozen.filter.data() + filter_block(frozen, h);
+        for (unsigned i = 0; i < FILTER_PROBES; ++i) {
+            unsigned bit = filter_bit(h, i);
+            if (!(block[bit >> 6] & (uint64_t(1) << (bit & 63))))
+                return false;
+        }
+        return true;
+    }
+
+    static size_t hash_bucket(const FrozenMap &frozen, uint64_t h) {
+        return (size_t)((h >> 32) % frozen.index.size());
+    }
+
+    // Slot of the key in the frozen arrays (erased ones included) or NO_SLOT
+    size_t frozen_slot(const Kmer &key) const {
+        const FrozenMap &frozen = *frozen_;
+        if (frozen.size == 0)
+            return NO_SLOT;
+
+        uint64_t h = raw_hash(key.data());
+        if (!filter_contains(frozen, h))
+            return NO_SLOT;
+
+        size_t bucket = hash_bucket(frozen, h);
+        size_t start = frozen.bucket_starts[bucket], sz = frozen.bucket_starts[bucket + 1] - start;
+        if (sz == 0)
+            return NO_SLOT;
+
+        size_t idx = frozen.index[bucket].lookup(key, KmerAdaptor{rawcnt_});
+        if (idx >= sz)
+            return NO_SLOT;
+
+        size_t slot = start + idx;
+        if (memcmp(&frozen.keys[slot * rawcnt_], key.data(), rawcnt_ * sizeof(RawSeqData)))
+            return NO_SLOT;
+
+        return slot;
+    }
+
     value_t* internal_tryget(const Kmer &key) const {
         return hattrie_tryget(mapping_, (const char *)key.data(), rawcnt_ * sizeof(RawSeqData));
     }
@@ -30,22 +143,74 @@ class KMerMap {
         return hattrie_del(mapping_, (const char *)key.data(), rawcnt_ * sizeof(RawSeqData));
     }
 
+    void internal_set(const RawSeqData *key, const RawSeqData *value) {
+        value_t *vp = hattrie_tryget(mapping_, (const char *)key, rawcnt_ * sizeof(RawSeqData));
+        RawSeqData *rawvalue = nullptr;
+        if (vp == nullptr) {
+            vp = hattrie_get(mapping_, (const char *)key, rawcnt_ * sizeof(RawSeqData));
+            rawvalue = new RawSeqData[rawcnt_];
+            *vp = reinterpret_cast<uintptr_t>(rawvalue);
+        } else {
+            rawvalue = reinterpret_cast<RawSeqData*>(*vp);
+        }
+
+        memcpy(rawvalue, value, rawcnt_ * sizeof(RawSeqData));
+    }
+
+    void clear_trie() {
+        // Delete all the values
+        auto *iter = hattrie_iter_begin(mapping_, false);
+        while (!hattrie_iter_finished(iter)) {
+            RawSeqData *value = (RawSeqData*)(*hattrie_iter_val(iter));
+            delete[] value;
+            hattrie_iter_next(iter);
+        }
+        hattrie_iter_free(iter);
+        // Delete the mapping and all the keys
+        hattrie_clear(mapping_);
+    }
+
+    bool modified_after_freeze() const {
+        return frozen_ && (frozen_->erased_count || hattrie_size(mapping_));
+    }
+
+    // Goes over the live frozen entries first and then over the trie
     class iterator : public boost::iterator_facade<iterator,
                                                    const std::pair<Kmer, Seq>,
                                                    std::forward_iterator_tag,
                                                    const std::pair<Kmer, Seq>> {
       public:
-        iterator(unsigned k, hattrie_iter_t *start = nullptr)
-                : k_(k), iter_(start, [](hattrie_iter_t *p) { hattrie_iter_free(p); }) {}
+        iterator(unsigned k, const FrozenMap *frozen, size_t pos, hattrie_iter_t *start = nullptr)
+                : k_(k), iter_(start, [](hattrie_iter_t *p) { if (p) hattrie_iter_free(p); }),
+                  frozen_(frozen), pos_(pos) {
+            skip_erased();
+        }
 
       private:
         friend class boost::iterator_core_access;
 
+        bool in_frozen() const {
+            return frozen_ && pos_ < frozen_->size;
+        }
+
+        void skip_erased() {
+            while (in_frozen() && frozen_->erased[pos_])
+                pos_ += 1;
+        }
+
         void increment() {
-            hattrie_iter_next(iter_.get());
+            if (in_frozen()) {
+                pos_ += 1;
+                skip_erased();
+            } else {
+                hattrie_iter_next(iter_.get());
+            }
         }
 
         bool equal(const iterator &other) const {
+            if (in_frozen() || other.in_frozen())
+                return frozen_ == other.frozen_ && pos_ == other.pos_;
+
             // Special case: NULL and finished are equal
             if (iter_.get() == nullptr || hattrie_iter_finished(iter_.get()))
                 return other.iter_.get() == nullptr || hattrie_iter_finished(other.iter_.get());
@@ -57,6 +222,12 @@ class KMerMap {
         }
 
         const std::pair<Kmer, Seq> dereference() const {
+            if (in_frozen()) {
+                size_t offset = pos_ * frozen_->rawcnt;
+                return std::make_pair(Kmer(k_, &frozen_->keys[offset]),
+                                      Seq(k_, &frozen_->values[offset]));
+            }
+
             size_t len;
             Kmer k(k_, (const RawSeqData*)hattrie_iter_key(iter_.get(), &len));
             Seq s(k_, (const RawSeqData*)(*hattrie_iter_val(iter_.get())));
@@ -65,6 +236,8 @@ class KMerMap {
 
         unsigned k_;
         std::shared_ptr<hattrie_iter_t> iter_;
+        const FrozenMap *frozen_;
+        size_t pos_;
     };
 
   public:
@@ -79,6 +252,17 @@ class KMerMap {
     }
 
     void erase(const Kmer &key) {
+        if (frozen_) {
+            size_t slot = frozen_slot(key);
+            if (slot != NO_SLOT) {
+                if (!frozen_->erased[slot]) {
+                    frozen_->erased[slot] = true;
+                    frozen_->erased_count += 1;
+                }
+                return;
+            }
+        }
+
         value_t *vp = internal_tryget(key);
         if (vp == nullptr)
             return;
@@ -90,24 +274,35 @@ class KMerMap {
     }
 
     void set(const Kmer &key, const Seq &value) {
-        value_t *vp = internal_tryget(key);
-        RawSeqData *rawvalue = nullptr;
-        if (vp == nullptr) {
-            vp = internal_get(key);
-            rawvalue = new RawSeqData[rawcnt_];
-            *vp = reinterpret_cast<uintptr_t>(rawvalue);
-        } else {
-            rawvalue = reinterpret_cast<RawSeqData*>(*vp);
+        if (frozen_) {
+            size_t slot = frozen_slot(key);
+            if (slot != NO_SLOT) {
+                if (frozen_->erased[slot]) {
+                    frozen_->erased[slot] = false;
+                    frozen_->erased_count -= 1;
+                }
+                memcpy(&frozen_->values[slot * rawcnt_], value.data(), rawcnt_ * sizeof(RawSeqData));
+                return;
+            }
         }
 
-        memcpy(rawvalue, value.data(), rawcnt_ * sizeof(RawSeqData));
+        internal_set(key.data(), value.data());
     }
 
     bool count(const Kmer &key) const {
-        return internal_tryget(key) != nullptr;
+        return find(key) != nullptr;
     }
 
     const RawSeqData *find(const Kmer &key) const {
+        if (frozen_) {
+            size_t slot = frozen_slot(key);
+            if (slot != NO_SLOT)
+                return frozen_->erased[slot] ? nullptr : &frozen_->values[slot * rawcnt_];
+            // Frozen and trie keys never intersect
+            if (hattrie_size(mapping_) == 0)
+                return nullptr;
+        }
+
         value_t *vp = internal_tryget(key);
         if (vp == nullptr)
             return nullptr;
@@ -116,34 +311,161 @@ class KMerMap {
     }
 
     void clear() {
-        // Delete all the values
+        frozen_.reset();
+        clear_trie();
+    }
+
+    size_t size() const {
+        return (frozen_ ? frozen_->size - frozen_->erased_count : 0) + hattrie_size(mapping_);
+    }
+
+    bool frozen() const {
+        return (bool)frozen_;
+    }
+
+    /**
+     * @brief Turns the map into the read-only form (see FrozenMap). The changes made
+     *        after freezing are kept aside and merged into it by the next freeze().
+     */
+    void freeze() {
+        if (frozen_ && !modified_after_freeze())
+            return;
+
+        // Live entries are gathered into flat arrays, the old frozen map and the trie
+        // are released before the new arrays are built
+        std::vector<RawSeqData> keys, values;
+        if (frozen_) {
+            keys = std::move(frozen_->keys);
+            values = std::move(frozen_->values);
+            size_t live = 0;
+            for (size_t i = 0; i < frozen_->size; ++i) {
+                if (frozen_->erased[i])
+                    continue;
+                if (live != i) {
+                    std::copy_n(&keys[i * rawcnt_], rawcnt_, &keys[live * rawcnt_]);
+                    std::copy_n(&values[i * rawcnt_], rawcnt_, &values[live * rawcnt_]);
+                }
+                live += 1;
+            }
+            keys.resize(live * rawcnt_);
+            values.resize(live * rawcnt_);
+            frozen_.reset();
+        }
+
+        size_t n = keys.size() / rawcnt_ + hattrie_size(mapping_);
+        keys.reserve(n * rawcnt_);
+        values.reserve(n * rawcnt_);
         auto *iter = hattrie_iter_begin(mapping_, false);
         while (!hattrie_iter_finished(iter)) {
-            RawSeqData *value = (RawSeqData*)(*hattrie_iter_val(iter));
-            delete[] value;
+            size_t len;
+            const RawSeqData *key = (const RawSeqData*)hattrie_iter_key(iter, &len);
+            const RawSeqData *value = (const RawSeqData*)(*hattrie_iter_val(iter));
+            keys.insert(keys.end(), key, key + rawcnt_);
+            values.insert(values.end(), value, value + rawcnt_);
             hattrie_iter_next(iter);
         }
         hattrie_iter_free(iter);
-        // Delete the mapping and all the keys
-        hattrie_clear(mapping_);
+        clear_trie();
+
+        std::unique_ptr<FrozenMap> frozen(new FrozenMap());
+        frozen->size = n;
+        frozen->rawcnt = rawcnt_;
+        frozen->erased.assign(n, false);
+        frozen->erased_count = 0;
+
+        std::vector<uint64_t> hashes(n);
+#       pragma omp parallel for schedule(static)
+        for (size_t i = 0; i < n; ++i)
+            hashes[i] = raw_hash(&keys[i * rawcnt_]);
+
+        size_t num_buckets = std::max<size_t>(1, std::min<size_t>(n / KEYS_PER_BUCKET,
+                                                                  16 * (size_t)omp_get_max_threads()));
+        frozen->index.resize(num_buckets);
+        frozen->bucket_starts.assign(num_buckets + 1, 0);
+        for (size_t i = 0; i < n; ++i)
+            frozen->bucket_starts[hash_bucket(*frozen, hashes[i]) + 1] += 1;
+        for (size_t b = 0; b < num_buckets; ++b)
+            frozen->bucket_starts[b + 1] += frozen->bucket_starts[b];
+
+        std::vector<size_t> order(n);
+        {
+            std::vector<size_t> pos(frozen->bucket_starts.begin(), frozen->bucket_starts.end() - 1);
+            for (size_t i = 0; i < n; ++i)
+                order[pos[hash_bucket(*frozen, hashes[i])]++] = i;
+        }
+
+        frozen->keys.resize(n * rawcnt_);
+        frozen->values.resize(n * rawcnt_);
+        frozen->filter.assign(std::max<size_t>(1, (n * FILTER_BITS_PER_KEY + 511) / 512) * FILTER_BLOCK_WORDS, 0);
+        RawKeyAdaptor adaptor{keys.data(), rawcnt_};
+
+#       pragma omp parallel for schedule(dynamic)
+        for (size_t b = 0; b < num_buckets; ++b) {
+            size_t start = frozen->bucket_starts[b], end = frozen->bucket_starts[b + 1];
+            size_t sz = end - start;
+            if (sz == 0)
+                continue;
+
+            auto range = emphf::range(order.cbegin() + start, order.cbegin() + end);
+            size_t max_nodes = (size_t(std::ceil(double(sz) * 1.23)) + 2) / 3 * 3;
+            if (max_nodes >= uint64_t(1) << 32) {
+                emphf::hypergraph_sorter_seq<emphf::hypergraph<uint64_t> > sorter;
+                FrozenMap::BucketIndex(sorter, sz, range, adaptor).swap(frozen->index[b]);
+            } else {
+                emphf::hypergraph_sorter_seq<emphf::hypergraph<uint32_t> > sorter;
+                FrozenMap::BucketIndex(sorter, sz, range, adaptor).swap(frozen->index[b]);
+            }
+
+            const FrozenMap::BucketIndex &index = frozen->index[b];
+            for (size_t j = start; j < end; ++j) {
+                size_t i = order[j];
+                size_t slot = (start + index.lookup(i, adaptor)) * rawcnt_;
+                memcpy(&frozen->keys[slot], &keys[i * rawcnt_], rawcnt_ * sizeof(RawSeqData));
+                memcpy(&frozen->values[slot], &values[i * rawcnt_], rawcnt_ * sizeof(RawSeqData));
+
+                uint64_t h = hashes[i];
+                uint64_t *block = frozen->filter.data() + filter_block(*frozen, h);
+                for (unsigned p = 0; p < FILTER_PROBES; ++p) {
+                    unsigned bit = filter_bit(h, p);
+                    __sync_fetch_and_or(block + (bit >> 6), uint64_t(1) << (bit & 63));
+                }
+            }
+        }
+
+        frozen_ = std::move(frozen);
     }
 
-    size_t size() const {
-        return hattrie_size(mapping_);
+    /**
+     * @brief Replaces every value of the just frozen map with f(key, value) in parallel.
+     *        f is evaluated against the old values, so it may freely query the map.
+     */
+    template<class F>
+    void transform_values(const F &f) {
+        VERIFY(frozen_ && !modified_after_freeze());
+        std::vector<RawSeqData> values(frozen_->values.size());
+        size_t n = frozen_->size;
+#       pragma omp parallel for schedule(guided)
+        for (size_t i = 0; i < n; ++i) {
+            Seq value = f(Kmer(k_, &frozen_->keys[i * rawcnt_]),
+                          Seq(k_, &frozen_->values[i * rawcnt_]));
+            memcpy(&values[i * rawcnt_], value.data(), rawcnt_ * sizeof(RawSeqData));
+        }
+        frozen_->values.swap(values);
     }
-    
+
     iterator begin() const {
-        return iterator(k_, hattrie_iter_begin(mapping_, false));
+        return iterator(k_, frozen_.get(), 0, hattrie_iter_begin(mapping_, false));
     }
 
     iterator end() const {
-        return iterator(k_);
+        return iterator(k_, frozen_.get(), frozen_ ? frozen_->size : 0);
     }
 
   private:
     unsigned k_;
     unsigned rawcnt_;
     hattrie_t *mapping_;
+    std::unique_ptr<FrozenMap> frozen_;
 };
 
 }
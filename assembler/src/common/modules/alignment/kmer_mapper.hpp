@@ -67,14 +67,13 @@ public:
         if (normalized_)
             return;
 
-        KMerVector<Kmer> all(k_, size());
-        for (auto it = begin(); it != end(); ++it)
-            all.push_back(it->first);
-
-        for (auto it = all.begin(); it != all.end(); ++it) {
-            Seq val(k_, it.data());
-            Normalize(val);
-        }
+        // Every key is mapped to the end of its substitution chain. The chains are
+        // followed against the old (frozen) values, so all the keys could be processed
+        // independently and the result does not depend on the processing order.
+        mapping_.freeze();
+        mapping_.transform_values([this](const Kmer &, const Seq &value) {
+            return Substitute(value);
+        });
         normalized_ = true;
     }
 
@@ -141,6 +140,11 @@ public:
         RemapKmers(this->g().EdgeNucls(edge1), this->g().EdgeNucls(edge2));
     }
 
+    //only sequences of the glued edges are used, nobody maps reads during the simplification
+    bool IsDeferrable() const override {
+        return true;
+    }
+
     Kmer Substitute(const Kmer &kmer) const {
         VERIFY(this->IsAttached());
         Kmer answer = kmer;
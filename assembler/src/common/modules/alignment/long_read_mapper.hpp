@@ -27,22 +27,6 @@ public:
               path_extractor_(path_extractor) {
     }
 
-    void StartProcessLibrary(size_t threads_count) override {
-        for (size_t i = 0; i < threads_count; ++i)
-            buffer_storages_.emplace_back(g_);
-    }
-
-    void StopProcessLibrary() override {
-        buffer_storages_.clear();
-    }
-
-    void MergeBuffer(size_t thread_index) override {
-        DEBUG("Merge buffer " << thread_index << " with size " << buffer_storages_[thread_index].size());
-        storage_.AddStorage(buffer_storages_[thread_index]);
-        buffer_storages_[thread_index].Clear();
-        DEBUG("Now size " << storage_.size());
-    }
-
     void ProcessSingleRead(size_t thread_index,
                            const io::SingleRead&,
                            const MappingPath<EdgeId>& read) override {
@@ -60,17 +44,17 @@ public:
     }
 
 private:
-    void ProcessSingleRead(size_t thread_index, const MappingPath<EdgeId>& mapping) {
+    // Path storage supports concurrent insertion, so no per-thread buffers are needed
+    void ProcessSingleRead(size_t /*thread_index*/, const MappingPath<EdgeId>& mapping) {
         DEBUG("Processing read");
         for (const auto& path : path_extractor_(mapping)) {
-            buffer_storages_[thread_index].AddPath(path, 1, false);
+            storage_.AddPath(path, 1, false);
         }
         DEBUG("Read processed");
     }
 
     const Graph& g_;
     PathStorage<Graph>& storage_;
-    std::vector<PathStorage<Graph>> buffer_storages_;
     PathExtractionF path_extractor_;
     DECL_LOGGER("LongReadMapper");
 };
@@ -15,6 +15,9 @@
 #pragma once
 
 #include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace debruijn_graph {
 
@@ -63,91 +66,140 @@ public:
 
 };
 
+/**
+ * Storage of weighted edge paths (long read & single read alignments).
+ * Paths are hash-consed: every distinct path is stored once in the arena of one of
+ * the stripes and is referred to by an integer handle; adding an existing path only
+ * bumps its weight in place. Stripes are chosen by the path hash and locked
+ * separately, so AddPath can be called concurrently (but not with the readers).
+ * Readers see the paths ordered lexicographically, i.e. grouped by the first edge.
+ */
 template<class Graph>
 class PathStorage {
     friend class PathInfo<Graph> ;
     typedef typename Graph::EdgeId EdgeId;
-    typedef map<EdgeId, set<PathInfo<Graph> > > InnerIndex;
+    typedef size_t PathHandle;
+
+    struct PathRecord {
+        size_t offset;
+        size_t length;
+        size_t weight;
+    };
+
+    struct Stripe {
+        std::mutex lock;
+        std::vector<EdgeId> edges;
+        std::vector<PathRecord> paths;
+        std::unordered_multimap<size_t, size_t> index;
+    };
+
+    static const size_t kStripes = 64;
+    static const size_t kLongEdgeForStats = 500;
 
     const Graph &g_;
-    InnerIndex inner_index_;
-    static const size_t kLongEdgeForStats = 500;
+    std::vector<Stripe> stripes_;
 
-    void HiddenAddPath(const vector<EdgeId> &p, int w){
-        if (p.size() == 0 ) return;
-        for (typename set<PathInfo<Graph> >::iterator iter = inner_index_[p[0]].begin(); iter != inner_index_[p[0]].end(); ++iter) {
+    static size_t PathHash(const EdgeId *p, size_t length) {
+        size_t h = length;
+        for (size_t i = 0; i < length; ++i)
+            h ^= p[i].hash() + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+        return h;
+    }
+
+    const PathRecord &record(PathHandle h) const {
+        return stripes_[h % kStripes].paths[h / kStripes];
+    }
+
+    const EdgeId *path_begin(PathHandle h) const {
+        return stripes_[h % kStripes].edges.data() + record(h).offset;
+    }
+
+    const EdgeId *path_end(PathHandle h) const {
+        return path_begin(h) + record(h).length;
+    }
+
+    vector<EdgeId> path(PathHandle h) const {
+        return vector<EdgeId>(path_begin(h), path_end(h));
+    }
 
-            if (iter->path == p) {
-                iter->increaseWeight(w);
+    // If the path is already present, its weight is increased by w (or left as is if !sum_weights)
+    void HiddenAddPath(const EdgeId *p, size_t length, int w, bool sum_weights = true) {
+        if (length == 0) return;
+        size_t hash = PathHash(p, length);
+        Stripe &stripe = stripes_[hash % kStripes];
+        std::lock_guard<std::mutex> guard(stripe.lock);
+        auto range = stripe.index.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            PathRecord &rec = stripe.paths[it->second];
+            if (rec.length == length &&
+                std::equal(p, p + length, stripe.edges.begin() + rec.offset)) {
+                if (sum_weights)
+                    rec.weight += w;
                 return;
             }
         }
-        inner_index_[p[0]].insert(PathInfo<Graph>(p, w));
-        size_++;
+        stripe.index.emplace(hash, stripe.paths.size());
+        stripe.paths.push_back({stripe.edges.size(), length, size_t(w)});
+        stripe.edges.insert(stripe.edges.end(), p, p + length);
+    }
+
+    void HiddenAddPath(const vector<EdgeId> &p, int w){
+        HiddenAddPath(p.data(), p.size(), w);
+    }
+
+    // Frozen view: handles of all the paths in lexicographic order
+    std::vector<PathHandle> SortedPaths() const {
+        std::vector<PathHandle> res;
+        for (size_t i = 0; i < kStripes; ++i)
+            for (size_t j = 0; j < stripes_[i].paths.size(); ++j)
+                res.push_back(j * kStripes + i);
+
+        std::sort(res.begin(), res.end(), [&](PathHandle a, PathHandle b) {
+            return std::lexicographical_compare(path_begin(a), path_end(a),
+                                                path_begin(b), path_end(b));
+        });
+        return res;
+    }
+
+    // Calls f(first, last) for each range of sorted handles sharing the first edge
+    template<class F>
+    void ForEachFirstEdgeGroup(const std::vector<PathHandle> &sorted, F f) const {
+        for (size_t i = 0; i < sorted.size(); ) {
+            size_t j = i + 1;
+            EdgeId first = *path_begin(sorted[i]);
+            while (j < sorted.size() && *path_begin(sorted[j]) == first)
+                ++j;
+            f(i, j);
+            i = j;
+        }
     }
 
 public:
 
     PathStorage(const Graph &g)
             : g_(g),
-              inner_index_(),
-              size_(0) {
+              stripes_(kStripes) {
     }
 
     PathStorage(const PathStorage & p)
             : g_(p.g_),
-              inner_index_(),
-              size_(0) {
-        for (auto iter = p.inner_index_.begin(); iter != p.inner_index_.end();
-                iter++) {
-            for (auto j_iter = iter->second.begin();
-                    j_iter != iter->second.end(); j_iter++) {
-                this->AddPath(j_iter->path, (int) j_iter->getWeight());
-            }
-        }
+              stripes_(kStripes) {
+        AddStorage(p);
     }
 
     void ReplaceEdges(map<EdgeId, EdgeId> &old_to_new){
-        map<int, EdgeId> tmp_map;
-//        for (auto iter = g_.SmartEdgeBegin(); !iter.IsEnd(); ++iter ){
-//            tmp_map[g_.int_id(*iter)] = *iter;
-//        }
-        InnerIndex new_index;
-        for (auto iter = inner_index_.begin(); iter != inner_index_.end(); iter++) {
-            auto tmp = iter->second;
-            EdgeId new_first;
-            if (old_to_new.find(iter->first) == old_to_new.end())
-                new_first = iter->first;
-            else {
-                DEBUG("new first edge: "<< g_.int_id(old_to_new[iter->first]) << " with " << tmp.size() << " edges ");
-                new_first = old_to_new[iter->first];
-            }
-            set<PathInfo<Graph> > new_tmp;
-            for (auto j_iter = tmp.begin(); j_iter != tmp.end(); j_iter++) {
-                PathInfo<Graph> pi = *(j_iter);
-                for (size_t k = 0; k < pi.path.size(); k++)
-                    if (old_to_new.find(pi.path[k]) != old_to_new.end()) {
-//                        INFO(g_.int_id(old_to_new[pi.path[k]]));
-                        pi.path[k] = old_to_new[pi.path[k]];
-                    }
-                DEBUG(pi.str(g_));
-                new_tmp.insert(pi);
-
-            }
-            if (new_first != iter->first) {
-                TRACE("and mmew_tmp.size: "<< new_tmp.size());
-            }
-            if (new_index.find(new_first) == new_index.end()) {
-                new_index[new_first] = new_tmp;
-            } else {
-                for (auto j_iter = new_tmp.begin(); j_iter != new_tmp.end(); j_iter++) {
-                    new_index[new_first].insert(*j_iter);
-                }
-            }
-
+        // Paths that become equal after replacement are collapsed, the one that was first keeps its weight
+        PathStorage<Graph> new_storage(g_);
+        for (PathHandle h : SortedPaths()) {
+            vector<EdgeId> p = path(h);
+            for (size_t k = 0; k < p.size(); k++)
+                if (old_to_new.find(p[k]) != old_to_new.end())
+                    p[k] = old_to_new[p[k]];
+            new_storage.HiddenAddPath(p.data(), p.size(), (int) record(h).weight, /*sum_weights*/false);
         }
 
-        inner_index_ = new_index;
+        Clear();
+        AddStorage(new_storage);
     }
 
     void AddPath(const vector<EdgeId> &p, int w, bool add_rc = false) {
@@ -170,26 +222,25 @@ public:
         ofstream filestr(filename);
         set<EdgeId> continued_edges;
 
-        for(auto iter = inner_index_.begin(); iter != inner_index_.end(); ++iter){
-            filestr<< iter->second.size() << endl;
-            int non1 = 0;
-            for (auto j_iter = iter->second.begin(); j_iter != iter->second.end(); ++j_iter) {
-                filestr << " Weight: " << j_iter->getWeight();
-                if (j_iter->getWeight() > stats_weight_cutoff)
-                    non1++;
-
-                filestr << " length: " << j_iter->path.size() << " ";
-                for (auto p_iter = j_iter->path.begin(); p_iter != j_iter->path.end(); ++p_iter) {
-                    if (p_iter != j_iter->path.end() - 1 && j_iter->getWeight() > stats_weight_cutoff) {
+        std::vector<PathHandle> sorted = SortedPaths();
+        ForEachFirstEdgeGroup(sorted, [&](size_t first, size_t last) {
+            filestr << last - first << "\n";
+            for (size_t i = first; i < last; ++i) {
+                PathHandle h = sorted[i];
+                size_t weight = record(h).weight;
+                filestr << " Weight: " << weight;
+                filestr << " length: " << record(h).length << " ";
+                for (const EdgeId *p_iter = path_begin(h); p_iter != path_end(h); ++p_iter) {
+                    if (p_iter != path_end(h) - 1 && weight > stats_weight_cutoff) {
                         continued_edges.insert(*p_iter);
                     }
 
                     filestr << g_.int_id(*p_iter) << "(" << g_.length(*p_iter) << ") ";
                 }
-                filestr << endl;
+                filestr << "\n";
             }
-            filestr << endl;
-        }
+            filestr << "\n";
+        });
 
         int noncontinued = 0;
         int long_gapped = 0;
@@ -224,11 +275,8 @@ public:
     }
 
      void SaveAllPaths(vector<PathInfo<Graph>> &res) const {
-        for (auto iter = inner_index_.begin(); iter != inner_index_.end(); ++iter) {
-            for (auto j_iter = iter->second.begin(); j_iter != iter->second.end(); ++j_iter) {
-                res.push_back(*j_iter);
-            }
-        }
+        for (PathHandle h : SortedPaths())
+            res.emplace_back(path(h), record(h).weight);
     }
 
     void LoadFromFile(const string s, bool force_exists = true) {
@@ -283,36 +331,26 @@ public:
         INFO("Loading finished.");
     }
 
-    void AddStorage(PathStorage<Graph> & to_add) {
-
-        for(auto iter = to_add.inner_index_.begin(); iter != to_add.inner_index_.end(); iter++) {
-            for(auto j_iter = iter->second.begin(); j_iter != iter->second.end(); j_iter ++) {
-                this->AddPath(j_iter->path, (int) j_iter->getWeight());
-            }
-        }
+    void AddStorage(const PathStorage<Graph> & to_add) {
+        for (const auto &stripe : to_add.stripes_)
+            for (const auto &rec : stripe.paths)
+                HiddenAddPath(stripe.edges.data() + rec.offset, rec.length, (int) rec.weight);
     }
 
     void Clear() {
-        inner_index_.clear();
-        size_ = 0;
+        for (auto &stripe : stripes_) {
+            std::vector<EdgeId>().swap(stripe.edges);
+            std::vector<PathRecord>().swap(stripe.paths);
+            stripe.index.clear();
+        }
     }
 
     size_t size() const {
-        return size_;
-    }
-
-//    typename InnerIndex::iterator begin() const {
-//        return inner_index.begin();
-//    }
-//
-//    typename InnerIndex::iterator end() const {
-//        return inner_index.end();
-//    }
-//    typename InnerIndex::iterator operator*(){
-//        return this->first;
-//    }
-private:
-    size_t size_;
+        size_t res = 0;
+        for (const auto &stripe : stripes_)
+            res += stripe.paths.size();
+        return res;
+    }
 };
 
 template<class Graph>
@@ -51,6 +51,15 @@ public:
     virtual MappingPath<EdgeId> MapSequence(const Sequence &sequence) const = 0;
 
     virtual MappingPath<EdgeId> MapRead(const io::SingleRead &read) const = 0;
+
+    //Mappers which benefit from batching (e.g. BWA) should override this
+    virtual std::vector<MappingPath<EdgeId>> MapSequences(const std::vector<Sequence> &sequences) const {
+        std::vector<MappingPath<EdgeId>> res;
+        res.reserve(sequences.size());
+        for (const auto &s : sequences)
+            res.push_back(MapSequence(s));
+        return res;
+    }
 };
 
 template<class Graph>
@@ -22,6 +22,7 @@ namespace debruijn_graph {
 //todo think if we still need all this
 class SequenceMapperListener {
 public:
+    //Reads are reported with thread_index < threads_count, one index per stream of the library
     virtual void StartProcessLibrary(size_t /* threads_count */) {}
     virtual void StopProcessLibrary() {}
 
@@ -40,6 +41,7 @@ public:
 
 class SequenceMapperNotifier {
     static constexpr size_t BUFFER_SIZE = 200000;
+    static constexpr size_t BATCH_SIZE = 4096;
 public:
     typedef SequenceMapper<conj_graph_pack::graph_t> SequenceMapperT;
 
@@ -61,20 +63,24 @@ public:
             threads_count = streams.size();
 
         streams.reset();
-        NotifyStartProcessLibrary(lib_index, threads_count);
+        //listeners get one buffer index per stream, whatever number of threads processes them
+        NotifyStartProcessLibrary(lib_index, streams.size());
         size_t counter = 0, n = 15;
         size_t fmem = get_free_memory();
 
         #pragma omp parallel for num_threads(threads_count) shared(counter)
         for (size_t i = 0; i < streams.size(); ++i) {
             size_t size = 0;
-            ReadType r;
+            std::vector<ReadType> batch;
+            batch.reserve(BATCH_SIZE);
             auto& stream = streams[i];
             while (!stream.eof()) {
                 if (size == BUFFER_SIZE || 
                     // Stop filling buffer if the amount of available is smaller
                     // than half of free memory.
                     (10 * get_free_memory() / 4 < fmem && size > 10000)) {
+                    NotifyProcessReads(batch, mapper, lib_index, i);
+                    batch.clear();
                     #pragma omp critical
                     {
                         counter += size;
@@ -86,15 +92,20 @@ public:
                         NotifyMergeBuffer(lib_index, i);
                     }
                 }
-                stream >> r;
+                batch.emplace_back();
+                stream >> batch.back();
                 ++size;
-                NotifyProcessRead(r, mapper, lib_index, i);
+                if (batch.size() == BATCH_SIZE) {
+                    NotifyProcessReads(batch, mapper, lib_index, i);
+                    batch.clear();
+                }
             }
+            NotifyProcessReads(batch, mapper, lib_index, i);
             #pragma omp atomic
             counter += size;
         }
 
-        for (size_t i = 0; i < threads_count; ++i)
+        for (size_t i = 0; i < streams.size(); ++i)
             NotifyMergeBuffer(lib_index, i);
 
         INFO("Total " << counter << " reads processed");
@@ -105,6 +116,32 @@ private:
     template<class ReadType>
     void NotifyProcessRead(const ReadType& r, const SequenceMapperT& mapper, size_t ilib, size_t ithread) const;
 
+    void NotifyProcessRead(const io::PairedReadSeq& r,
+                           const MappingPath<EdgeId>& path1, const MappingPath<EdgeId>& path2,
+                           size_t ilib, size_t ithread) const {
+        for (const auto& listener : listeners_[ilib]) {
+            TRACE("Dist: " << r.second().size() << " - " << r.insert_size() << " = " << r.second().size() - r.insert_size());
+            listener->ProcessPairedRead(ithread, r, path1, path2);
+            listener->ProcessSingleRead(ithread, r.first(), path1);
+            listener->ProcessSingleRead(ithread, r.second(), path2);
+        }
+    }
+
+    void NotifyProcessRead(const io::SingleReadSeq& r, const MappingPath<EdgeId>& path,
+                           size_t ilib, size_t ithread) const {
+        for (const auto& listener : listeners_[ilib])
+            listener->ProcessSingleRead(ithread, r, path);
+    }
+
+    //Maps reads one by one, reads with packed sequences are mapped by a single
+    //MapSequences call per batch (see specializations below)
+    template<class ReadType>
+    void NotifyProcessReads(const std::vector<ReadType>& reads, const SequenceMapperT& mapper,
+                            size_t ilib, size_t ithread) const {
+        for (const auto& r : reads)
+            NotifyProcessRead(r, mapper, ilib, ithread);
+    }
+
     void NotifyStartProcessLibrary(size_t ilib, size_t thread_count) const {
         for (const auto& listener : listeners_[ilib])
             listener->StartProcessLibrary(thread_count);
@@ -125,21 +162,19 @@ private:
 };
 
 template<>
-inline void SequenceMapperNotifier::NotifyProcessRead(const io::PairedReadSeq& r,
-                                                      const SequenceMapperT& mapper,
-                                                      size_t ilib,
-                                                      size_t ithread) const {
-
-    const Sequence& read1 = r.first().sequence();
-    const Sequence& read2 = r.second().sequence();
-    MappingPath<EdgeId> path1 = mapper.MapSequence(read1);
-    MappingPath<EdgeId> path2 = mapper.MapSequence(read2);
-    for (const auto& listener : listeners_[ilib]) {
-        TRACE("Dist: " << r.second().size() << " - " << r.insert_size() << " = " << r.second().size() - r.insert_size());
-        listener->ProcessPairedRead(ithread, r, path1, path2);
-        listener->ProcessSingleRead(ithread, r.first(), path1);
-        listener->ProcessSingleRead(ithread, r.second(), path2);
+inline void SequenceMapperNotifier::NotifyProcessReads(const std::vector<io::PairedReadSeq>& reads,
+                                                       const SequenceMapperT& mapper,
+                                                       size_t ilib,
+                                                       size_t ithread) const {
+    std::vector<Sequence> seqs;
+    seqs.reserve(2 * reads.size());
+    for (const auto& r : reads) {
+        seqs.push_back(r.first().sequence());
+        seqs.push_back(r.second().sequence());
     }
+    std::vector<MappingPath<EdgeId>> paths = mapper.MapSequences(seqs);
+    for (size_t i = 0; i < reads.size(); ++i)
+        NotifyProcessRead(reads[i], paths[2 * i], paths[2 * i + 1], ilib, ithread);
 }
 
 template<>
@@ -158,14 +193,17 @@ inline void SequenceMapperNotifier::NotifyProcessRead(const io::PairedRead& r,
 }
 
 template<>
-inline void SequenceMapperNotifier::NotifyProcessRead(const io::SingleReadSeq& r,
-                                                      const SequenceMapperT& mapper,
-                                                      size_t ilib,
-                                                      size_t ithread) const {
-    const Sequence& read = r.sequence();
-    MappingPath<EdgeId> path = mapper.MapSequence(read);
-    for (const auto& listener : listeners_[ilib])
-        listener->ProcessSingleRead(ithread, r, path);
+inline void SequenceMapperNotifier::NotifyProcessReads(const std::vector<io::SingleReadSeq>& reads,
+                                                       const SequenceMapperT& mapper,
+                                                       size_t ilib,
+                                                       size_t ithread) const {
+    std::vector<Sequence> seqs;
+    seqs.reserve(reads.size());
+    for (const auto& r : reads)
+        seqs.push_back(r.sequence());
+    std::vector<MappingPath<EdgeId>> paths = mapper.MapSequences(seqs);
+    for (size_t i = 0; i < reads.size(); ++i)
+        NotifyProcessRead(reads[i], paths[i], ilib, ithread);
 }
 
 template<>
@@ -15,6 +15,7 @@
 #include "assembly_graph/graph_support/parallel_processing.hpp"
 #include "assembly_graph/graph_support/basic_vertex_conditions.hpp"
 #include "assembly_graph/core/basic_graph_stats.hpp"
+#include "utils/coverage_model/coverage_histogram.hpp"
 
 #ifdef USE_GLIBCXX_PARALLEL
 #include "parallel/algorithm"
@@ -46,11 +47,12 @@ private:
         return !eq;
     }
 
-    double weight(size_t value, const map<size_t, size_t> &histogram,
+    //the bucket is also cut at the number of distinct coverage values
+    double weight(size_t value, const vector<size_t> &histogram, size_t distinct_values,
                   size_t backet_width) const {
         double result = 0;
-        for (size_t i = 0; i < backet_width && value + i < histogram.size(); i++) {
-            result += (double) (getValue(value + i, histogram) * std::min(i + 1, backet_width - i));
+        for (size_t i = 0; i < backet_width && value + i < distinct_values; i++) {
+            result += (double) (histogram[value + i] * std::min(i + 1, backet_width - i));
         }
         return result;
     }
@@ -71,14 +73,6 @@ private:
         return coverages[coverages.size() / 2];
     }
 
-    size_t getValue(size_t arg, const map<size_t, size_t> &ssmap) const {
-        auto it = ssmap.find(arg);
-        if (it == ssmap.end())
-            return 0;
-        else
-            return it->second;
-    }
-
 public:
     ErroneousConnectionThresholdFinder(const Graph &graph, size_t backet_width = 0) :
             graph_(graph), backet_width_(backet_width) {
@@ -94,32 +88,42 @@ public:
         return cov / length;
     }
 
-    std::map<size_t, size_t> ConstructHistogram() const {
-        std::map<size_t, size_t> result;
-        for (auto it = graph_.ConstEdgeBegin(); !it.IsEnd(); ++it) {
-            if (IsInteresting(*it))
-                result[(size_t)graph_.coverage(*it)]++;
+    //number of interesting edges for every coverage value up to the maximal one
+    std::vector<size_t> ConstructHistogram() const {
+        utils::coverage_model::CoverageHistogram histogram;
+        auto chunk_iterators = IterationHelper<Graph, EdgeId>(graph_).Chunks(10 * omp_get_max_threads());
+
+        #pragma omp parallel for schedule(guided)
+        for (size_t i = 0; i < chunk_iterators.size() - 1; ++i) {
+            for (auto it = chunk_iterators[i], end = chunk_iterators[i + 1]; it != end; ++it) {
+                if (IsInteresting(*it))
+                    histogram.Add((size_t) graph_.coverage(*it));
+            }
         }
-        return result;
+        return histogram.Counts();
     }
 
-    double FindThreshold(const map<size_t, size_t> &histogram) const {
+    double FindThreshold(const vector<size_t> &histogram) const {
         size_t backet_width = backet_width_;
         if (backet_width == 0) {
             backet_width = (size_t)(0.3 * AvgCovereageCounter<Graph>(graph_).Count() + 5);
         }
-        size_t size = 0;
-        if (histogram.size() != 0)
-            size = histogram.rbegin()->first + 1;
+        size_t size = histogram.size();
+        size_t distinct_values = std::count_if(histogram.begin(), histogram.end(),
+                                               [](size_t count) { return count != 0; });
         INFO("Bucket size: " << backet_width);
+
+        vector<double> weights(size > backet_width ? size - backet_width : 0);
+        for (size_t i = 0; i < weights.size(); i++)
+            weights[i] = weight(i, histogram, distinct_values, backet_width);
+
         size_t cnt = 0;
         for (size_t i = 1; i + backet_width < size; i++) {
-            if (weight(i, histogram, backet_width) > weight(i - 1, histogram, backet_width))
+            if (weights[i] > weights[i - 1])
                 cnt++;
 
             if (i > backet_width &&
-                weight(i - backet_width,     histogram, backet_width) >
-                weight(i - backet_width - 1, histogram, backet_width)) {
+                weights[i - backet_width] > weights[i - backet_width - 1]) {
                 cnt--;
             }
             if (2 * cnt >= backet_width)
@@ -132,7 +136,7 @@ public:
 
     double FindThreshold() const {
         INFO("Finding threshold started");
-        std::map<size_t, size_t> histogram = ConstructHistogram(/*weights*/);
+        std::vector<size_t> histogram = ConstructHistogram(/*weights*/);
         for (size_t i = 0; i < histogram.size(); i++) {
             TRACE(i << " " << histogram[i]);
         }
@@ -7,9 +7,10 @@
 
 #pragma once
 
-#include <map>
-#include <queue>
+#include <algorithm>
+#include <numeric>
 
+#include "utils/openmp_wrapper.h"
 #include "assembly_graph/components/splitters.hpp"
 #include "cleaner.hpp"
 #include "assembly_graph/graph_support/graph_processing_algorithm.hpp"
@@ -17,347 +18,272 @@
 namespace omnigraph {
 
 using std::set;
-using std::map;
 using std::vector;
-using std::pair;
-using std::queue;
-using std::make_pair;
 
-template<class Graph>
+/**
+ * Flow network of a single component in the compressed sparse row form, every
+ * edge is stored as a pair of arcs keeping the residual capacities. Vertices are
+ * numbered densely, the source and the sink go first. The storage survives Reset(),
+ * so a network per thread serves any number of components.
+ */
 class FlowGraph {
 public:
     typedef size_t FlowVertexId;
-    typedef pair<FlowVertexId, FlowVertexId> FlowEdgeId;
+    typedef size_t ArcId;
 
-private:
-    typedef typename Graph::VertexId OuterVertexId;
-    map<OuterVertexId, FlowVertexId> vertex_mapping_;
-    map<FlowVertexId, map<FlowVertexId, int>> capacities_;
-    set<FlowVertexId> vertices_;
-    size_t vertex_number_;
-    FlowVertexId source_;
-    FlowVertexId sink_;
+    static const int DEFAULT_CAPACITY = 10000;
 
-    FlowVertexId AddVertex() {
-        vertices_.insert(vertex_number_);
-        capacities_[vertex_number_];
-        vertex_number_++;
-        return vertex_number_ - 1;
-    }
+    struct Arc {
+        FlowVertexId end;
+        ArcId reverse;
+        int capacity;
+    };
 
-    void PushFlow(FlowEdgeId edge, int capacity) {
-        VERIFY(capacities_[EdgeStart(edge)][EdgeEnd(edge)] >= capacity);
-        capacities_[EdgeStart(edge)][EdgeEnd(edge)] -= capacity;
-        capacities_[EdgeEnd(edge)][EdgeStart(edge)] += capacity;
-    }
+private:
+    struct Edge {
+        FlowVertexId start;
+        FlowVertexId end;
+        int capacity;
+    };
 
-    void AddEdge(FlowVertexId first, FlowVertexId second, int capacity = 10000) {
-        capacities_[first][second] += capacity; // operator [] creates entry with default values in case argument is not in keyset
-        capacities_[second][first] += 0;
-    }
+    size_t vertex_number_;
+    vector<Edge> edges_;
+    vector<size_t> offsets_;
+    vector<size_t> positions_;
+    vector<Arc> arcs_;
 
 public:
-    FlowGraph() :
-            vertex_number_(0), source_(AddVertex()), sink_(AddVertex()) {
-    }
-
-    FlowVertexId GetCorrespondingVertex(OuterVertexId v) const {
-        return vertex_mapping_.find(v)->second;
-    }
-
-    bool HasCorrespondingVertex(OuterVertexId v) const {
-        return vertex_mapping_.find(v) == vertex_mapping_.end();
+    FlowGraph() : vertex_number_(2) {
     }
 
-    FlowVertexId AddVertex(OuterVertexId vertex) {
-        FlowVertexId new_vertex = AddVertex();
-        vertex_mapping_[vertex] = new_vertex;
-        return new_vertex;
+    void Reset(size_t inner_vertex_number) {
+        vertex_number_ = inner_vertex_number + 2;
+        edges_.clear();
+        arcs_.clear();
     }
 
-    void AddEdge(OuterVertexId outer_first, OuterVertexId outer_second,
-            int capacity = 10000) {
-        VERIFY(
-                vertex_mapping_.find(outer_first) != vertex_mapping_.end()
-                        && vertex_mapping_.find(outer_second)
-                                != vertex_mapping_.end());
-        FlowVertexId first = vertex_mapping_[outer_first];
-        FlowVertexId second = vertex_mapping_[outer_second];
-        AddEdge(first, second, capacity);
+    void AddEdge(FlowVertexId first, FlowVertexId second, int capacity = DEFAULT_CAPACITY) {
+        VERIFY(first < vertex_number_ && second < vertex_number_);
+        edges_.push_back({first, second, capacity});
     }
 
-    void AddSource(OuterVertexId vertex, int capacity) {
-        AddEdge(source_, GetCorrespondingVertex(vertex), capacity);
+    //Lays out the arcs, has to be called after all edges are added
+    void Build() {
+        offsets_.assign(vertex_number_ + 1, 0);
+        for (const Edge &edge : edges_) {
+            ++offsets_[edge.start + 1];
+            ++offsets_[edge.end + 1];
+        }
+        std::partial_sum(offsets_.begin(), offsets_.end(), offsets_.begin());
+        positions_.assign(offsets_.begin(), offsets_.end() - 1);
+        arcs_.resize(2 * edges_.size());
+        for (const Edge &edge : edges_) {
+            ArcId direct = positions_[edge.start]++;
+            ArcId reverse = positions_[edge.end]++;
+            arcs_[direct] = {edge.end, reverse, edge.capacity};
+            arcs_[reverse] = {edge.start, direct, 0};
+        }
     }
 
-    void AddSink(OuterVertexId vertex, int capacity) {
-        AddEdge(GetCorrespondingVertex(vertex), sink_, capacity);
+    size_t size() const {
+        return vertex_number_;
     }
 
     FlowVertexId Source() const {
-        return source_;
+        return 0;
     }
 
     FlowVertexId Sink() const {
-        return sink_;
+        return 1;
     }
 
-    bool Connected(FlowVertexId start, FlowVertexId end) const {
-        return capacities_.find(start) != capacities_.end()
-                && capacities_.find(start)->second.find(end)
-                        != capacities_.find(start)->second.end()
-                && capacities_.find(start)->second.find(end)->second > 0;
+    FlowVertexId InnerVertex(size_t i) const {
+        return i + 2;
     }
 
-    vector<FlowEdgeId> OutgoingEdges(FlowVertexId v) const {
-        vector<FlowEdgeId> result;
-        const map<FlowVertexId, int> &outgoing = capacities_.find(v)->second;
-        for (auto it = outgoing.begin(); it != outgoing.end(); ++it) {
-            if (it->second > 0) {
-                result.push_back(make_pair(v, it->first));
-            }
-        }
-        return result;
-    }
-
-    vector<FlowEdgeId> IncomingEdges(FlowVertexId v) const {
-        vector<FlowEdgeId> result;
-        const map<FlowVertexId, int> &outgoing = capacities_.find(v)->second;
-        for (auto it = outgoing.begin(); it != outgoing.end(); ++it) {
-            if (Connected(it->first, v)) {
-                result.push_back(make_pair(it->first, v));
-            }
-        }
-        return result;
+    ArcId ArcsBegin(FlowVertexId v) const {
+        return offsets_[v];
     }
 
-    size_t OutgoingEdgesCount(FlowVertexId v) const {
-        return OutgoingEdges(v).size();
+    ArcId ArcsEnd(FlowVertexId v) const {
+        return offsets_[v + 1];
     }
 
-    size_t IncomingEdgesCount(FlowVertexId v) const {
-        return IncomingEdges(v).size();
+    const Arc &arc(ArcId a) const {
+        return arcs_[a];
     }
 
-    FlowVertexId EdgeStart(FlowEdgeId edge) const {
-        return edge.first;
+    FlowVertexId ArcStart(ArcId a) const {
+        return arcs_[arcs_[a].reverse].end;
     }
 
-    FlowVertexId EdgeEnd(FlowEdgeId edge) const {
-        return edge.second;
+    //Arc reversed to the a-th one is residual
+    bool HasReverse(ArcId a) const {
+        return arcs_[arcs_[a].reverse].capacity > 0;
     }
 
-    set<FlowVertexId>::iterator begin() const {
-        return vertices_.begin();
+    void PushFlow(ArcId a, int capacity) {
+        VERIFY(arcs_[a].capacity >= capacity);
+        arcs_[a].capacity -= capacity;
+        arcs_[arcs_[a].reverse].capacity += capacity;
     }
-
-    set<FlowVertexId>::iterator end() const {
-        return vertices_.end();
-    }
-
-    int GetCapacity(FlowVertexId first, FlowVertexId second) const {
-        auto it1 = capacities_.find(first);
-        if (it1 == capacities_.end())
-            return 0;
-        auto it2 = it1->second.find(second);
-        if (it2 == it1->second.end())
-            return 0;
-        return it2->second;
-    }
-
-    void PushFlow(vector<FlowVertexId> path, int capacity) {
-        size_t n = path.size();
-        VERIFY(path[0] == source_ && path[n - 1] == sink_);
-        for (size_t i = 0; i + 1 < n; i++) {
-            PushFlow(make_pair(path[i], path[i + 1]), capacity);
-        }
-    }
-
-//    void Print() const {
-//        for(auto it = vertex_mapping_.begin(); it != vertex_mapping_.end(); ++it) {
-//            TRACE(it->first << " " << it->second);
-//        }
-//        for(auto it = vertices_.begin(); it != vertices_.end();) {
-//            auto out = OutgoingEdges(*it);
-//            for(auto it1 = out.begin(); it1 != out.end(); ++it1) {
-//                TRACE("edge " << (*it1) << " " << GetCapacity(*it, it1->second));
-//            }
-//            ++it;
-//            if(it == vertices_.end())
-//                break;
-//        }
-//    }
 };
 
-template<class Graph>
-class BFS {
+/**
+ * Dinic's blocking flow algorithm, the buffers are kept between the runs.
+ */
+class MaxFlowFinder {
 private:
-    const Graph &graph_;
-    typedef typename Graph::FlowVertexId FlowVertexId;
-    typedef typename Graph::FlowEdgeId FlowEdgeId;
-
-    vector<FlowVertexId> RestoreAnswer(FlowVertexId start, FlowVertexId end,
-            const map<FlowVertexId, FlowVertexId> &prev) {
-        vector<FlowVertexId> result;
-        result.push_back(end);
-        FlowVertexId current = end;
-        while (current != start) {
-            current = prev.find(current)->second;
-            result.push_back(current);
-        }
-        return vector<FlowVertexId>(result.rbegin(), result.rend());
-    }
-
-public:
-    BFS(const Graph &graph) :
-            graph_(graph) {
-    }
-
-    vector<FlowVertexId> Go(FlowVertexId start, FlowVertexId finish) {
-        queue<FlowVertexId> q;
-        q.push(start);
-        map<FlowVertexId, FlowVertexId> prev;
-        prev[start] = start;
-        while (!q.empty()) {
-            FlowVertexId current = q.front();
-            q.pop();
-            vector<FlowEdgeId> outgoing = graph_.OutgoingEdges(current);
-            for (auto it = outgoing.begin(); it != outgoing.end(); ++it) {
-                if (prev.find(it->second) == prev.end()) {
-                    q.push(it->second);
-                    prev[it->second] = current;
-                }
-                if (it->second == finish) {
-                    return RestoreAnswer(start, finish, prev);
+    typedef FlowGraph::FlowVertexId FlowVertexId;
+    typedef FlowGraph::ArcId ArcId;
+
+    vector<int> level_;
+    vector<ArcId> current_arc_;
+    vector<FlowVertexId> queue_;
+    vector<ArcId> path_;
+
+    bool Admissible(const FlowGraph &fg, FlowVertexId v, ArcId a) const {
+        return fg.arc(a).capacity > 0 && level_[fg.arc(a).end] == level_[v] + 1;
+    }
+
+    bool BuildLevels(const FlowGraph &fg) {
+        level_.assign(fg.size(), -1);
+        queue_.clear();
+        queue_.push_back(fg.Source());
+        level_[fg.Source()] = 0;
+        for (size_t head = 0; head < queue_.size(); ++head) {
+            FlowVertexId v = queue_[head];
+            for (ArcId a = fg.ArcsBegin(v); a != fg.ArcsEnd(v); ++a) {
+                FlowVertexId next = fg.arc(a).end;
+                if (fg.arc(a).capacity > 0 && level_[next] < 0) {
+                    level_[next] = level_[v] + 1;
+                    queue_.push_back(next);
                 }
             }
         }
-        return vector<FlowVertexId>();
-    }
-};
-
-template<class Graph>
-class MaxFlowFinder {
-private:
-    FlowGraph<Graph> &graph_;
-    typedef typename FlowGraph<Graph>::FlowVertexId FlowVertexId;
-    typedef typename FlowGraph<Graph>::FlowEdgeId FlowEdgeId;
-
-    int MinCapacity(vector<FlowVertexId> path) {
-        VERIFY(path.size() >= 2);
-        int result = graph_.GetCapacity(path[0], path[1]);
-        for (size_t i = 1; i + 1 < path.size(); i++) {
-            result = std::min(result, graph_.GetCapacity(path[i], path[i + 1]));
-        }
-        return result;
+        return level_[fg.Sink()] >= 0;
     }
 
-public:
-    MaxFlowFinder(FlowGraph<Graph> &graph) :
-            graph_(graph) {
+    void AugmentPath(FlowGraph &fg) {
+        int capacity = fg.arc(path_[0]).capacity;
+        for (ArcId a : path_)
+            capacity = std::min(capacity, fg.arc(a).capacity);
+        VERIFY(capacity > 0);
+        for (ArcId a : path_)
+            fg.PushFlow(a, capacity);
     }
 
-    void Find() {
-        BFS<FlowGraph<Graph> > bfs(graph_);
+    void BlockingFlow(FlowGraph &fg) {
+        current_arc_.resize(fg.size());
+        for (FlowVertexId v = 0; v < fg.size(); ++v)
+            current_arc_[v] = fg.ArcsBegin(v);
+        path_.clear();
+        FlowVertexId v = fg.Source();
         while (true) {
-            vector<FlowVertexId> path = bfs.Go(graph_.Source(), graph_.Sink());
-            if (path.size() == 0)
+            if (v == fg.Sink()) {
+                AugmentPath(fg);
+                //retreat to the first saturated arc
+                size_t i = 0;
+                while (fg.arc(path_[i]).capacity > 0)
+                    ++i;
+                v = fg.ArcStart(path_[i]);
+                path_.resize(i);
+                continue;
+            }
+            ArcId &a = current_arc_[v];
+            while (a != fg.ArcsEnd(v) && !Admissible(fg, v, a))
+                ++a;
+            if (a != fg.ArcsEnd(v)) {
+                path_.push_back(a);
+                v = fg.arc(a).end;
+            } else if (v == fg.Source()) {
                 break;
-            int capacity = MinCapacity(path);
-            VERIFY(capacity > 0);
-            graph_.PushFlow(path, capacity);
-//            graph_.Print();
-        }
-    }
-};
-
-template<class Graph>
-class TopSorter {
-private:
-    typedef typename Graph::FlowVertexId FlowVertexId;
-    typedef typename Graph::FlowEdgeId FlowEdgeId;
-    const Graph &graph_;
-
-    void Find(FlowVertexId v, vector<FlowVertexId> &result, set<FlowVertexId> &visited) {
-        visited.insert(v);
-        vector<FlowEdgeId> outgoing = graph_.OutgoingEdges(v);
-        for (auto it = outgoing.begin(); it != outgoing.end(); ++it) {
-            FlowVertexId next = graph_.EdgeEnd(*it);
-            if (visited.count(next) == 0) {
-                Find(next, result, visited);
+            } else {
+                //dead end
+                level_[v] = -1;
+                v = fg.ArcStart(path_.back());
+                path_.pop_back();
             }
         }
-        result.push_back(v);
     }
 
 public:
-    TopSorter(const Graph &graph) :
-            graph_(graph) {
-    }
-
-    vector<FlowVertexId> Sort() {
-        vector<FlowVertexId> result;
-        set<FlowVertexId> visited;
-        for (auto it = graph_.begin(); it != graph_.end(); ++it) {
-            if (visited.count(*it) == 0) {
-                Find(*it, result, visited);
-            }
+    void Find(FlowGraph &fg) {
+        while (BuildLevels(fg)) {
+            BlockingFlow(fg);
         }
-        return result;
     }
 };
 
-template<class Graph>
-class ReverseDFSComponentFinder {
+/**
+ * Kosaraju's algorithm on the residual network with explicit stacks.
+ */
+class StronglyConnectedComponentFinder {
 private:
-    typedef typename Graph::FlowVertexId FlowVertexId;
-    typedef typename Graph::FlowEdgeId FlowEdgeId;
-
-    const Graph &graph_;
-
-    void Find(FlowVertexId v, map<FlowVertexId, size_t> &result, size_t cc) {
-        result[v] = cc;
-        vector<FlowEdgeId> incoming = graph_.IncomingEdges(v);
-        for (auto it = incoming.begin(); it != incoming.end(); ++it) {
-            FlowVertexId next = graph_.EdgeStart(*it);
-            if (result.count(next) == 0) {
-                Find(next, result, cc);
+    typedef FlowGraph::FlowVertexId FlowVertexId;
+    typedef FlowGraph::ArcId ArcId;
+
+    static const size_t NO_COLOUR = size_t(-1);
+
+    vector<bool> visited_;
+    vector<ArcId> current_arc_;
+    vector<FlowVertexId> stack_;
+    vector<FlowVertexId> order_;
+    vector<size_t> colouring_;
+
+    void TopSort(const FlowGraph &fg, FlowVertexId start) {
+        visited_[start] = true;
+        stack_.push_back(start);
+        while (!stack_.empty()) {
+            FlowVertexId v = stack_.back();
+            ArcId &a = current_arc_[v];
+            while (a != fg.ArcsEnd(v) && (fg.arc(a).capacity == 0 || visited_[fg.arc(a).end]))
+                ++a;
+            if (a != fg.ArcsEnd(v)) {
+                visited_[fg.arc(a).end] = true;
+                stack_.push_back(fg.arc(a).end);
+            } else {
+                order_.push_back(v);
+                stack_.pop_back();
             }
         }
     }
-public:
-    ReverseDFSComponentFinder(const Graph &graph) :
-            graph_(graph) {
-    }
 
-    map<FlowVertexId, size_t> Find(const vector<FlowVertexId> &order) {
-        size_t cc = 0;
-        map<FlowVertexId, size_t> result;
-        for (auto it = order.rbegin(); it != order.rend(); ++it) {
-            if (result.count(*it) == 0) {
-                Find(*it, result, cc);
-                cc++;
+    void Colour(const FlowGraph &fg, FlowVertexId start, size_t cc) {
+        colouring_[start] = cc;
+        stack_.push_back(start);
+        while (!stack_.empty()) {
+            FlowVertexId v = stack_.back();
+            stack_.pop_back();
+            for (ArcId a = fg.ArcsBegin(v); a != fg.ArcsEnd(v); ++a) {
+                FlowVertexId prev = fg.arc(a).end;
+                if (fg.HasReverse(a) && colouring_[prev] == NO_COLOUR) {
+                    colouring_[prev] = cc;
+                    stack_.push_back(prev);
+                }
             }
         }
-        return result;
     }
-};
 
-template<class Graph>
-class StroglyConnectedComponentFinder {
-private:
-    typedef typename Graph::FlowVertexId FlowVertexId;
-    const Graph &graph_;
-    bool ready_;
 public:
-    StroglyConnectedComponentFinder(const Graph &graph) :
-            graph_(graph), ready_(false) {
-    }
+    const vector<size_t> &ColourComponents(const FlowGraph &fg) {
+        visited_.assign(fg.size(), false);
+        current_arc_.resize(fg.size());
+        for (FlowVertexId v = 0; v < fg.size(); ++v)
+            current_arc_[v] = fg.ArcsBegin(v);
+        order_.clear();
+        for (FlowVertexId v = 0; v < fg.size(); ++v) {
+            if (!visited_[v])
+                TopSort(fg, v);
+        }
 
-    map<FlowVertexId, size_t> ColourComponents() {
-        map<FlowVertexId, size_t> result;
-        vector<FlowVertexId> order = TopSorter<Graph>(graph_).Sort();
-        return ReverseDFSComponentFinder<Graph>(graph_).Find(order);
+        colouring_.assign(fg.size(), size_t(NO_COLOUR));
+        size_t cc = 0;
+        for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+            if (colouring_[*it] == NO_COLOUR)
+                Colour(fg, *it, cc++);
+        }
+        return colouring_;
     }
 };
 
@@ -388,31 +314,48 @@ private:
         return g_.length(edge) <= max_length_ && !IsTip(edge);
     }
 
-    set<EdgeId> CollectUnusedEdges(set<VertexId> component, FlowGraph<Graph> fg,
-            const map<typename FlowGraph<Graph>::FlowVertexId, size_t> &colouring) {
-        set<EdgeId> result;
-        for (auto it_start = component.begin(); it_start != component.end();
-                ++it_start) {
-            VertexId start = *it_start;
-            auto outgoing = g_.OutgoingEdges(start);
-            for (auto it_edge = outgoing.begin(); it_edge != outgoing.end();
-                    ++it_edge) {
-                EdgeId edge = *it_edge;
+    struct FlowWorkspace {
+        vector<VertexId> component;
+        FlowGraph fg;
+        MaxFlowFinder mf_finder;
+        StronglyConnectedComponentFinder component_finder;
+    };
+
+    bool InComponent(const vector<VertexId> &component, VertexId v) const {
+        return std::binary_search(component.begin(), component.end(), v);
+    }
+
+    FlowGraph::FlowVertexId GetCorrespondingVertex(const FlowWorkspace &ws, VertexId v) const {
+        auto it = std::lower_bound(ws.component.begin(), ws.component.end(), v);
+        VERIFY(it != ws.component.end() && *it == v);
+        return ws.fg.InnerVertex(it - ws.component.begin());
+    }
+
+    vector<EdgeId> CollectUnusedEdges(const FlowWorkspace &ws, const vector<size_t> &colouring) {
+        vector<EdgeId> result;
+        for (VertexId start : ws.component) {
+            for (EdgeId edge : g_.OutgoingEdges(start)) {
                 VertexId end = g_.EdgeEnd(edge);
-                if (component.count(end) == 1 && IsSuspicious(edge)
-                        && colouring.find(fg.GetCorrespondingVertex(start))->second
-                                != colouring.find(
-                                        fg.GetCorrespondingVertex(end))->second) {
-                    result.insert(edge);
+                if (InComponent(ws.component, end) && IsSuspicious(edge)
+                        && colouring[GetCorrespondingVertex(ws, start)]
+                                != colouring[GetCorrespondingVertex(ws, end)]) {
+                    result.push_back(edge);
                 }
             }
         }
         return result;
     }
 
-    bool CheckCompleteFlow(FlowGraph<Graph> &fg) {
-        return fg.OutgoingEdges(fg.Source()).size() == 0
-                && fg.IncomingEdges(fg.Sink()).size() == 0;
+    bool CheckCompleteFlow(const FlowGraph &fg) {
+        for (auto a = fg.ArcsBegin(fg.Source()); a != fg.ArcsEnd(fg.Source()); ++a) {
+            if (fg.arc(a).capacity > 0)
+                return false;
+        }
+        for (auto a = fg.ArcsBegin(fg.Sink()); a != fg.ArcsEnd(fg.Sink()); ++a) {
+            if (fg.HasReverse(a))
+                return false;
+        }
+        return true;
     }
 
     bool IsPlausible(EdgeId edge) {
@@ -423,52 +366,70 @@ private:
         return g_.length(edge) >= uniqueness_length_;
     }
 
-    bool IsInnerShortEdge(set<VertexId> component, EdgeId edge) {
-        return !IsUnique(edge) && component.count(g_.EdgeStart(edge)) == 1
-                && component.count(g_.EdgeEnd(edge)) == 1;
+    bool IsInnerShortEdge(const vector<VertexId> &component, EdgeId edge) {
+        return !IsUnique(edge) && InComponent(component, g_.EdgeStart(edge))
+                && InComponent(component, g_.EdgeEnd(edge));
     }
 
-    void ProcessShortEdge(FlowGraph<Graph> &fg, set<VertexId> component,
-            EdgeId edge) {
-        if (IsInnerShortEdge(component, edge)) {
-            fg.AddEdge(g_.EdgeStart(edge), g_.EdgeEnd(edge));
+    void ProcessShortEdge(FlowWorkspace &ws, EdgeId edge) {
+        if (IsInnerShortEdge(ws.component, edge)) {
+            ws.fg.AddEdge(GetCorrespondingVertex(ws, g_.EdgeStart(edge)),
+                          GetCorrespondingVertex(ws, g_.EdgeEnd(edge)));
         }
     }
 
-    void ProcessSource(FlowGraph<Graph> &fg, set<VertexId> /*component*/,
-            EdgeId edge) {
+    void ProcessSource(FlowWorkspace &ws, EdgeId edge) {
         if (IsPlausible(edge) || IsUnique(edge)) {
-            fg.AddSource(g_.EdgeEnd(edge), 1);
+            ws.fg.AddEdge(ws.fg.Source(), GetCorrespondingVertex(ws, g_.EdgeEnd(edge)), 1);
         }
     }
 
-    void ProcessSink(FlowGraph<Graph> &fg, set<VertexId> /*component*/,
-            EdgeId edge) {
+    void ProcessSink(FlowWorkspace &ws, EdgeId edge) {
         if (IsPlausible(edge) || IsUnique(edge)) {
-            fg.AddSink(g_.EdgeStart(edge), 1);
+            ws.fg.AddEdge(GetCorrespondingVertex(ws, g_.EdgeStart(edge)), ws.fg.Sink(), 1);
         }
     }
 
-    void ConstructFlowGraph(FlowGraph<Graph> &fg, set<VertexId> component) {
-        for (auto it = component.begin(); it != component.end(); ++it) {
-            fg.AddVertex(*it);
-        }
-        for (auto it = component.begin(); it != component.end(); ++it) {
-            VertexId vertex = *it;
-            auto outgoing = g_.OutgoingEdges(vertex);
-            for (auto it_edge = outgoing.begin(); it_edge != outgoing.end();
-                    ++it_edge) {
-                EdgeId edge = *it_edge;
-                ProcessShortEdge(fg, component, edge);
-                ProcessSink(fg, component, edge);
+    void ConstructFlowGraph(FlowWorkspace &ws) {
+        ws.fg.Reset(ws.component.size());
+        for (VertexId vertex : ws.component) {
+            for (EdgeId edge : g_.OutgoingEdges(vertex)) {
+                ProcessShortEdge(ws, edge);
+                ProcessSink(ws, edge);
             }
-            auto incoming = g_.IncomingEdges(vertex);
-            for (auto it_edge = incoming.begin(); it_edge != incoming.end();
-                    ++it_edge) {
-                EdgeId edge = *it_edge;
-                ProcessSource(fg, component, edge);
+            for (EdgeId edge : g_.IncomingEdges(vertex)) {
+                ProcessSource(ws, edge);
             }
         }
+        ws.fg.Build();
+    }
+
+    vector<EdgeId> ProcessComponent(const set<VertexId> &component, FlowWorkspace &ws) {
+        ws.component.assign(component.begin(), component.end());
+        ConstructFlowGraph(ws);
+        ws.mf_finder.Find(ws.fg);
+        if (!CheckCompleteFlow(ws.fg)) {
+            TRACE("Suspicious component! No edge delition!");
+            return vector<EdgeId>();
+        }
+        return CollectUnusedEdges(ws, ws.component_finder.ColourComponents(ws.fg));
+    }
+
+    /*
+     * Removal in a component touches only its own edges and the edges of its conjugate,
+     * so components, none of which is conjugate to another, are evaluated in parallel
+     * and the edges are removed afterwards.
+     */
+    void ProcessComponents(const vector<set<VertexId>> &components) {
+        vector<vector<EdgeId>> to_remove(components.size());
+        vector<FlowWorkspace> workspaces(omp_get_max_threads());
+#       pragma omp parallel for schedule(dynamic)
+        for (size_t i = 0; i < components.size(); ++i) {
+            to_remove[i] = ProcessComponent(components[i], workspaces[omp_get_thread_num()]);
+        }
+        for (const auto &edges : to_remove) {
+            component_remover_.DeleteComponent(edges.begin(), edges.end(), false);
+        }
     }
 
 public:
@@ -483,26 +444,31 @@ public:
     }
 
     bool Process() {
+        vector<set<VertexId>> components;
+        set<VertexId> conjugate_vertices;
+        set<VertexId> postponed;
         for (shared_ptr<GraphSplitter<Graph>> splitter_ptr = LongEdgesExclusiveSplitter<Graph>(g_,
                 uniqueness_length_); splitter_ptr->HasNext();) {
             set<VertexId> component = splitter_ptr->Next().vertices();
-            FlowGraph<Graph> fg;
-            ConstructFlowGraph(fg, component);
-//            fg.Print();
-            MaxFlowFinder<Graph> mf_finder(fg);
-            mf_finder.Find();
-            if (!CheckCompleteFlow(fg)) {
-                TRACE("Suspicious component! No edge delition!");
+            if (conjugate_vertices.count(*component.begin())) {
+                postponed.insert(component.begin(), component.end());
                 continue;
             }
-            StroglyConnectedComponentFinder<FlowGraph<Graph>> component_finder(
-                    fg);
-            map<typename FlowGraph<Graph>::FlowVertexId, size_t> colouring =
-                    component_finder.ColourComponents();
-            set<EdgeId> to_remove = CollectUnusedEdges(component, fg,
-                    colouring);
-            component_remover_.DeleteComponent(to_remove.begin(), to_remove.end(), false);
+            for (VertexId v : component)
+                conjugate_vertices.insert(g_.conjugate(v));
+            components.push_back(std::move(component));
         }
+        ProcessComponents(components);
+
+        //conjugate components are split again over the edges that are left
+        components.clear();
+        for (NeighbourhoodFindingSplitter<Graph> splitter(g_,
+                make_shared<CollectionIterator<set<VertexId>>>(postponed),
+                make_shared<ShortEdgeComponentFinder<Graph>>(g_, uniqueness_length_)); splitter.HasNext();) {
+            components.push_back(splitter.Next().vertices());
+        }
+        ProcessComponents(components);
+
         CompressAllVertices(g_);
         Cleaner<Graph>(g_).Run();
 
@@ -23,20 +23,31 @@ namespace simplification {
 
 namespace relative_coverage {
 
+/*
+ * Components are bounded by the number of inner vertices, so the vertex and edge
+ * sets are kept in small vectors and searched linearly. The storage is reused
+ * after Reset().
+ */
 template<class Graph>
 class Component {
     typedef typename Graph::EdgeId EdgeId;
     typedef typename Graph::VertexId VertexId;
 
     const Graph& g_;
-    set<EdgeId> edges_;
-    set<VertexId> inner_vertices_;
-    set<VertexId> border_;
-    set<VertexId> terminating_vertices_;
+    vector<EdgeId> edges_;
+    vector<VertexId> inner_vertices_;
+    vector<VertexId> border_;
+    //sorted
+    vector<VertexId> terminating_vertices_;
     //maybe use something more sophisticated in future
     size_t cumm_length_;
     bool contains_deadends_;
 
+    template<class T>
+    static bool Contains(const vector<T>& v, T t) {
+        return std::find(v.begin(), v.end(), t) != v.end();
+    }
+
     //if edge start = edge end = v returns v
     VertexId OppositeEnd(EdgeId e, VertexId v) const {
         VERIFY(g_.EdgeStart(e) == v
@@ -49,34 +60,51 @@ class Component {
         }
     }
 
+    void AddToBorder(VertexId v) {
+        if (!Contains(border_, v))
+            border_.push_back(v);
+    }
+
     void RemoveFromBorder(VertexId v) {
-        size_t cnt = border_.erase(v);
-        VERIFY(cnt);
+        auto it = std::find(border_.begin(), border_.end(), v);
+        VERIFY(it != border_.end());
+        border_.erase(it);
     }
 
 public:
 
-    Component(const Graph& g, EdgeId e) : g_(g), cumm_length_(0), contains_deadends_(false) {
-        edges_.insert(e);
-        cumm_length_ += g_.length(e);
-        border_.insert(g.EdgeStart(e));
-        border_.insert(g.EdgeEnd(e));
+    Component(const Graph& g) : g_(g), cumm_length_(0), contains_deadends_(false) {
+    }
+
+    Component(const Graph& g, EdgeId e) : Component(g) {
+        Reset(e);
+    }
+
+    void Reset(EdgeId e) {
+        edges_.assign(1, e);
+        inner_vertices_.clear();
+        border_.clear();
+        terminating_vertices_.clear();
+        cumm_length_ = g_.length(e);
+        contains_deadends_ = false;
+        AddToBorder(g_.EdgeStart(e));
+        AddToBorder(g_.EdgeEnd(e));
     }
 
     void MakeInner(VertexId v) {
-        VERIFY(border_.count(v) > 0);
+        VERIFY(Contains(border_, v));
         if (g_.IsDeadEnd(v) || g_.IsDeadStart(v)) {
             contains_deadends_ = true;
         }
-        inner_vertices_.insert(v);
+        inner_vertices_.push_back(v);
         for (EdgeId e : g_.IncidentEdges(v)) {
             //seems to correctly handle loops
-            if (edges_.count(e) == 0) {
-                edges_.insert(e);
+            if (!contains(e)) {
+                edges_.push_back(e);
                 cumm_length_ += g_.length(e);
                 VertexId other_end = OppositeEnd(e, v);
-                if (inner_vertices_.count(other_end) == 0) {
-                    border_.insert(other_end);
+                if (!Contains(inner_vertices_, other_end)) {
+                    AddToBorder(other_end);
                 }
             }
         }
@@ -84,36 +112,42 @@ public:
     }
 
     void TerminateOnVertex(VertexId v) {
-        terminating_vertices_.insert(v);
+        auto it = std::lower_bound(terminating_vertices_.begin(), terminating_vertices_.end(), v);
+        if (it == terminating_vertices_.end() || *it != v)
+            terminating_vertices_.insert(it, v);
         RemoveFromBorder(v);
     }
 
     VertexId NextBorderVertex() const {
-        return *border_.begin();
+        return *std::min_element(border_.begin(), border_.end());
     }
 
     bool IsBorderEmpty() const {
         return border_.empty();
     }
 
-    const set<EdgeId>& edges() const {
+    const vector<EdgeId>& edges() const {
         return edges_;
     }
 
     bool contains(EdgeId e) const {
-        return edges_.count(e) > 0;
+        return Contains(edges_, e);
     }
 
-    const set<VertexId>& terminating_vertices() const {
+    const vector<VertexId>& terminating_vertices() const {
         return terminating_vertices_;
     }
 
-    set<EdgeId> terminating_edges() const {
-        set<EdgeId> answer;
+    bool is_terminating(VertexId v) const {
+        return std::binary_search(terminating_vertices_.begin(), terminating_vertices_.end(), v);
+    }
+
+    vector<EdgeId> terminating_edges() const {
+        vector<EdgeId> answer;
         for (VertexId v : terminating_vertices()) {
             for (EdgeId e : g_.IncidentEdges(v)) {
-                if (contains(e)) {
-                    answer.insert(e);
+                if (contains(e) && !Contains(answer, e)) {
+                    answer.push_back(e);
                 }
             }
         }
@@ -121,12 +155,12 @@ public:
     }
 
     //terminating edges, going into the component
-    set<EdgeId> terminating_in_edges() const {
-        set<EdgeId> answer;
+    vector<EdgeId> terminating_in_edges() const {
+        vector<EdgeId> answer;
         for (VertexId v : terminating_vertices()) {
             for (EdgeId e : g_.OutgoingEdges(v)) {
                 if (contains(e)) {
-                    answer.insert(e);
+                    answer.push_back(e);
                 }
             }
         }
@@ -134,12 +168,12 @@ public:
     }
 
     //terminating edges, going out of the component
-    set<EdgeId> terminating_out_edges() const {
-        set<EdgeId> answer;
+    vector<EdgeId> terminating_out_edges() const {
+        vector<EdgeId> answer;
         for (VertexId v : terminating_vertices()) {
             for (EdgeId e : g_.IncomingEdges(v)) {
                 if (contains(e)) {
-                    answer.insert(e);
+                    answer.push_back(e);
                 }
             }
         }
@@ -197,11 +231,14 @@ public:
         return answer;
     }
 
+    bool IsHighlyCovered(double coverage, double base_coverage) const {
+        return math::gr(coverage, base_coverage * min_coverage_gap_);
+    }
+
     template<class EdgeContainer>
     bool CheckAnyHighlyCovered(const EdgeContainer& edges, VertexId v,
                                double base_coverage) const {
-        return math::gr(MaxLocalCoverage(edges, v),
-                        base_coverage * min_coverage_gap_);
+        return IsHighlyCovered(MaxLocalCoverage(edges, v), base_coverage);
     }
 
     bool AnyHighlyCoveredOnBothSides(VertexId v, double base_coverage) const {
@@ -266,16 +303,35 @@ template<class Graph>
 class LongestPathFinder {
     typedef typename Graph::EdgeId EdgeId;
     typedef typename Graph::VertexId VertexId;
-    const Component<Graph>& component_;
     const Graph& g_;
-    map<VertexId, int> max_distance_;
+    const Component<Graph>* component_;
+    //vertices with known max distances
+    vector<VertexId> vertices_;
+    vector<int> max_distance_;
     vector<VertexId> vertex_stack_;
     bool cycle_detected_;
 
+    bool TryGetKnownDistance(VertexId v, int& distance) const {
+        auto it = std::find(vertices_.begin(), vertices_.end(), v);
+        if (it == vertices_.end())
+            return false;
+        distance = max_distance_[it - vertices_.begin()];
+        return true;
+    }
+
+    void SetMaxDistance(VertexId v, int distance) {
+        auto it = std::find(vertices_.begin(), vertices_.end(), v);
+        if (it == vertices_.end()) {
+            vertices_.push_back(v);
+            max_distance_.push_back(distance);
+        } else {
+            max_distance_[it - vertices_.begin()] = distance;
+        }
+    }
+
     //distance is changed!
     bool TryGetMaxDistance(VertexId v, int& distance) {
-        if (max_distance_.count(v) > 0) {
-            distance = max_distance_[v];
+        if (TryGetKnownDistance(v, distance)) {
             return true;
         }
 
@@ -283,22 +339,23 @@ class LongestPathFinder {
         distance = std::numeric_limits<int>::min();
         for (EdgeId e : g_.IncomingEdges(v)) {
             VertexId start = g_.EdgeStart(e);
-            if (component_.contains(e)) {
-                if (max_distance_.count(start) == 0) {
+            if (component_->contains(e)) {
+                int start_distance = 0;
+                if (!TryGetKnownDistance(start, start_distance)) {
                     if (std::find(vertex_stack_.begin(), vertex_stack_.end(), start) != vertex_stack_.end()) {
                         cycle_detected_ = true;
                     }
                     vertex_stack_.push_back(start);
                     return false;
                 } else {
-                    distance = std::max(distance, max_distance_[start] + int(g_.length(e)));
+                    distance = std::max(distance, start_distance + int(g_.length(e)));
                 }
             }
         }
         //todo think...
         //currently whole length of zig-zag path
         //through several terminal vertices is counted
-        if (component_.terminating_vertices().count(v) > 0) {
+        if (component_->is_terminating(v)) {
             distance = std::max(distance, 0);
         }
         return true;
@@ -313,26 +370,33 @@ class LongestPathFinder {
             VertexId v = vertex_stack_.back();
             int max_dist = 0;
             if (TryGetMaxDistance(v, max_dist)) {
-                max_distance_[v] = max_dist;
+                SetMaxDistance(v, max_dist);
                 vertex_stack_.pop_back();
             }
         }
     }
 
 public:
-    LongestPathFinder(const Component<Graph>& component)
-            : component_(component), g_(component.g()), cycle_detected_(false) {
+    LongestPathFinder(const Graph& g)
+            : g_(g), component_(nullptr), cycle_detected_(false) {
     }
 
     //-1u if component contains a cycle or no path between terminating vertices
-    size_t Find() {
+    size_t Find(const Component<Graph>& component) {
+        component_ = &component;
+        vertices_.clear();
+        max_distance_.clear();
+        vertex_stack_.clear();
+        cycle_detected_ = false;
+
         int answer = 0;
-        for (VertexId v : component_.terminating_vertices()) {
+        for (VertexId v : component_->terminating_vertices()) {
             ProcessVertex(v);
             if (cycle_detected_)
                 return -1u;
-            VERIFY(max_distance_.count(v) > 0);
-            answer = std::max(answer, get(max_distance_, v));
+            int distance = 0;
+            VERIFY(TryGetKnownDistance(v, distance));
+            answer = std::max(answer, distance);
         }
         VERIFY(answer >= 0);
         if (answer == 0)
@@ -386,9 +450,9 @@ public:
         return true;
     }
 
-    bool FullCheck(const Component<Graph>& component) const {
+    bool FullCheck(const Component<Graph>& component, LongestPathFinder<Graph>& path_finder) const {
         TRACE("Performing full check of the component");
-        size_t longest_connecting_path = LongestPathFinder<Graph>(component).Find();
+        size_t longest_connecting_path = path_finder.Find(component);
         if (longest_connecting_path != -1u) {
             if (longest_connecting_path >= longest_connecting_path_bound_) {
                 TRACE("Length of longest path: " << longest_connecting_path << "; threshold: "
@@ -416,6 +480,9 @@ private:
     DECL_LOGGER("RelativelyLowCoveredComponentChecker");
 };
 
+/*
+ * Reusable between the searches, a searcher per thread is enough.
+ */
 template<class Graph>
 class InnerComponentSearcher {
     typedef typename Graph::EdgeId EdgeId;
@@ -425,17 +492,18 @@ class InnerComponentSearcher {
     const RelativeCoverageHelper<Graph>& rel_helper_;
     const ComponentChecker<Graph>& checker_;
     Component<Graph> component_;
+    LongestPathFinder<Graph> path_finder_;
 
 public:
     InnerComponentSearcher(const Graph& g,
                            const RelativeCoverageHelper<Graph>& rel_helper,
-                           const ComponentChecker<Graph>& checker,
-                           EdgeId first_edge)
+                           const ComponentChecker<Graph>& checker)
             : g_(g), rel_helper_(rel_helper), checker_(checker),
-              component_(g_, first_edge) {
+              component_(g_), path_finder_(g_) {
     }
 
-    bool FindComponent() {
+    bool FindComponent(EdgeId first_edge) {
+        component_.Reset(first_edge);
         while (!component_.IsBorderEmpty()) {
             if (!checker_.SizeCheck(component_))
                 return false;
@@ -447,7 +515,7 @@ public:
             if (!IsTerminateVertex(v)) {
                 TRACE("Not terminating, adding neighbourhood");
                 component_.MakeInner(v);
-                if (component_.terminating_vertices().count(v) > 0) {
+                if (component_.is_terminating(v)) {
                     TRACE("Terminating vertex classified as non-terminating");
                     return false;
                 }
@@ -457,7 +525,7 @@ public:
             }
         }
 
-        return checker_.FullCheck(component_);
+        return checker_.FullCheck(component_, path_finder_);
     }
 
     const Component<Graph>& component() const {
@@ -467,41 +535,20 @@ public:
 private:
 
     bool IsTerminateVertex(VertexId v) const {
-        double base_coverage = rel_helper_.MaxLocalCoverage(
-                RetainEdgesFromComponent(g_.IncidentEdges(v)), v);
-        return CheckAnyFilteredHighlyCovered(g_.OutgoingEdges(v),
-                                             v, base_coverage)
-               && CheckAnyFilteredHighlyCovered(
-                g_.IncomingEdges(v), v, base_coverage);
+        double base_coverage = MaxLocalCoverage(g_.IncidentEdges(v), v, /*in component*/true);
+        return rel_helper_.IsHighlyCovered(
+                MaxLocalCoverage(g_.OutgoingEdges(v), v, /*in component*/false), base_coverage)
+               && rel_helper_.IsHighlyCovered(
+                MaxLocalCoverage(g_.IncomingEdges(v), v, /*in component*/false), base_coverage);
     }
 
     template<class EdgeContainer>
-    bool CheckAnyFilteredHighlyCovered(const EdgeContainer& edges,
-                                       VertexId v,
-                                       double base_coverage) const {
-        return rel_helper_.CheckAnyHighlyCovered(
-                FilterEdgesFromComponent(edges), v, base_coverage);
-    }
-
-    template<class EdgeContainer>
-    vector<EdgeId> FilterEdgesFromComponent(
-            const EdgeContainer& edges) const {
-        vector<EdgeId> answer;
-        for (EdgeId e : edges) {
-            if (!component_.contains(e)) {
-                answer.push_back(e);
-            }
-        }
-        return answer;
-    }
-
-    template<class EdgeContainer>
-    vector<EdgeId> RetainEdgesFromComponent(
-            const EdgeContainer& edges) const {
-        vector<EdgeId> answer;
+    double MaxLocalCoverage(const EdgeContainer& edges, VertexId v,
+                            bool in_component) const {
+        double answer = 0.0;
         for (EdgeId e : edges) {
-            if (component_.contains(e)) {
-                answer.push_back(e);
+            if (component_.contains(e) == in_component) {
+                answer = max(answer, rel_helper_.LocalCoverage(e, v));
             }
         }
         return answer;
@@ -524,10 +571,14 @@ class RelativeCovComponentFinder {
     size_t vertex_count_limit_;
     std::string vis_dir_;
 
+    ComponentChecker<Graph> checker_;
+    //per thread
+    mutable vector<InnerComponentSearcher<Graph>> searchers_;
+
     mutable std::atomic_uint fail_cnt_;
     mutable std::atomic_uint succ_cnt_;
 
-    void VisualizeNontrivialComponent(const set<typename Graph::EdgeId>& edges, bool success) const {
+    void VisualizeNontrivialComponent(const vector<EdgeId>& edges, bool success) const {
         auto colorer = visualization::graph_colorer::DefaultColorer(g_);
         auto edge_colorer = make_shared<visualization::graph_colorer::CompositeEdgeColorer<Graph>>("black");
         edge_colorer->AddColorer(colorer);
@@ -572,8 +623,14 @@ public:
               max_coverage_(max_coverage),
               vertex_count_limit_(vertex_count_limit),
               vis_dir_(vis_dir),
+              checker_(g_, vertex_count_limit_, length_bound_,
+                       tip_allowing_length_bound_,
+                       longest_connecting_path_bound_, max_coverage_),
               fail_cnt_(0),
               succ_cnt_(0) {
+        for (int i = 0; i < omp_get_max_threads(); ++i) {
+            searchers_.emplace_back(g_, rel_helper_, checker_);
+        }
         VERIFY(math::gr(min_coverage_gap, 1.));
         VERIFY(tip_allowing_length_bound >= length_bound);
         TRACE("Coverage gap " << min_coverage_gap);
@@ -584,14 +641,15 @@ public:
         }
     }
 
-    boost::optional<Component<Graph>> operator()(EdgeId e) const {
+    //The component stays valid until the next call from the same thread
+    const Component<Graph>* operator()(EdgeId e) const {
         TRACE("Processing edge " << g_.str(e));
 
         //here we use that the graph is conjugate!
         VertexId v = g_.EdgeStart(e);
         if (g_.IncomingEdgeCount(v) == 0 || g_.OutgoingEdgeCount(v) < 2/*==1*/) {
             TRACE("Tip");
-            return boost::none;
+            return nullptr;
         }
 
         double local_cov = rel_helper_.LocalCoverage(e, v);
@@ -602,16 +660,13 @@ public:
         TRACE("Checking presence of highly covered edges around start")
         if (rel_helper_.AnyHighlyCoveredOnBothSides(v, local_cov)) {
             TRACE("Looking for component");
-            ComponentChecker<Graph> checker(g_, vertex_count_limit_, length_bound_,
-                                            tip_allowing_length_bound_,
-                                            longest_connecting_path_bound_, max_coverage_);
-            //case of e being loop is handled implicitly!
-            InnerComponentSearcher<Graph> component_searcher(
-                    g_, rel_helper_, checker, e);
+            VERIFY(size_t(omp_get_thread_num()) < searchers_.size());
+            auto& component_searcher = searchers_[omp_get_thread_num()];
 
-            if (component_searcher.FindComponent()) {
+            //case of e being loop is handled implicitly!
+            if (component_searcher.FindComponent(e)) {
                 TRACE("Deleting component");
-                return boost::optional<Component<Graph>>(component_searcher.component());
+                return &component_searcher.component();
             } else {
                 TRACE("Failed to find component");
                 if (!vis_dir_.empty()) {
@@ -622,7 +677,7 @@ public:
         } else {
             TRACE("No highly covered edges around");
         }
-        return boost::none;
+        return nullptr;
     }
 
 private:
@@ -662,21 +717,21 @@ public:
                       max_coverage, vertex_count_limit, vis_dir),
               component_remover_(g, handler_function) {
         this->interest_el_finder_ = std::make_shared<ParallelInterestingElementFinder<Graph, EdgeId>>(
-                [&](EdgeId e) { return finder_(e); }, chunk_cnt);
+                [&](EdgeId e) { return finder_(e) != nullptr; }, chunk_cnt);
     }
 
 protected:
 
     bool Process(EdgeId e) override {
         DEBUG("Processing edge " << this->g().str(e));
-        auto opt_component = finder_(e);
-        if (!opt_component) {
+        auto component = finder_(e);
+        if (!component) {
             DEBUG("Failed to detect component starting with edge " << this->g().str(e));
             return false;
         }
-        VERIFY(opt_component->edges().size());
-        DEBUG("Detected component edge cnt: " << opt_component->edges().size());
-        component_remover_.DeleteComponent(opt_component->edges());
+        VERIFY(component->edges().size());
+        DEBUG("Detected component edge cnt: " << component->edges().size());
+        component_remover_.DeleteComponent(component->edges());
         DEBUG("Relatively low coverage component removed");
         return true;
     }
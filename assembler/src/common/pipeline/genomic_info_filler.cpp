@@ -8,6 +8,7 @@
 #include "genomic_info_filler.hpp"
 
 #include "utils/coverage_model/kmer_coverage_model.hpp"
+#include "utils/coverage_model/coverage_histogram.hpp"
 #include "modules/simplification/ec_threshold_finder.hpp"
 
 #include "llvm/Support/YAMLTraits.h"
@@ -16,29 +17,17 @@
 
 #include <string>
 
-#include <map>
 #include <vector>
 
 using namespace llvm;
 using namespace debruijn_graph;
 
-static std::vector<size_t> extract(const std::map<size_t, size_t> &hist) {
-    std::map<size_t, size_t> tmp = hist;
+// Drop the zero coverage bin, the histogram starts from coverage 1
+static std::vector<size_t> extract(const std::vector<size_t> &hist) {
+    if (hist.empty())
+        return std::vector<size_t>();
 
-    size_t maxcov = 0;
-    for (auto it = tmp.cbegin(), et = tmp.cend(); it != et; ++it)
-        maxcov = std::max(maxcov, it->first);
-
-    // Touch all the values until maxcov to make sure all the values exist in the map
-    for (size_t i = 0; i <= maxcov; ++i)
-        tmp[i];
-
-    // Extract the values
-    std::vector<size_t> res(maxcov);
-    for (size_t i = 0; i < maxcov; ++i)
-        res[i] = tmp[i + 1];
-
-    return res;
+    return std::vector<size_t>(hist.begin() + 1, hist.end());
 }
 
 namespace llvm { namespace yaml {
@@ -98,7 +87,7 @@ void GenomicInfo::Save(const std::string &filename) const {
 void GenomicInfoFiller::run(conj_graph_pack &gp, const char*) {
     if (cfg::get().uneven_depth) {
         ErroneousConnectionThresholdFinder<decltype(gp.g)> finder(gp.g);
-        std::map<size_t, size_t> hist = finder.ConstructHistogram();
+        std::vector<size_t> hist = finder.ConstructHistogram();
         double avg = finder.AvgCoverage();
         double gthr = finder.FindThreshold(hist);
         INFO("Average edge coverage: " << avg);
@@ -108,19 +97,17 @@ void GenomicInfoFiller::run(conj_graph_pack &gp, const char*) {
         gp.ginfo.set_ec_bound(std::min(avg, gthr));
     } else {
         // First, get k-mer coverage histogram
-        std::map<size_t, size_t> tmp;
-        size_t maxcov = 0;
+        typedef conj_graph_pack::index_t::InnerIndex InnerIndex;
+        utils::coverage_model::CoverageHistogram hist;
         size_t kmer_per_record = 1;
-        if (conj_graph_pack::index_t::InnerIndex::storing_type::IsInvertable())
+        if (InnerIndex::storing_type::IsInvertable())
             kmer_per_record = 2;
 
-        for (auto I = gp.index.inner_index().value_cbegin(), E = gp.index.inner_index().value_cend(); I != E;  ++I) {
-            size_t ccov = I->count;
-            maxcov = std::max(ccov, maxcov);
-            tmp[ccov] += kmer_per_record;
-        }
+        ParallelForEachValue(gp.index.inner_index(), [&](const InnerIndex::ValueType &edge_info) {
+            hist.Add(edge_info.count, kmer_per_record);
+        });
 
-        gp.ginfo.set_cov_histogram(extract(tmp));
+        gp.ginfo.set_cov_histogram(extract(hist.Counts()));
 
         // Fit the coverage model and get the threshold
         utils::coverage_model::KMerCoverageModel CovModel(gp.ginfo.cov_histogram(), cfg::get().kcm.probability_threshold, cfg::get().kcm.strong_probability_threshold);
@@ -121,8 +121,7 @@ struct graph_pack: private boost::noncopyable {
             edge_pos.Attach();
         }
         edge_pos.clear();
-        visualization::position_filler::FillPos(*this, genome.GetSequence(), "ref0");
-        visualization::position_filler::FillPos(*this, !genome.GetSequence(), "ref1");
+        visualization::position_filler::FillPos(*this, genome.GetSequence(), "ref0", "ref1");
     }
     
     void EnsureDebugInfo() {
@@ -9,9 +9,13 @@
 #include "pipeline/graphio.hpp"
 
 #include "utils/logger/log_writers.hpp"
+#include "utils/openmp_wrapper.h"
+
+#include <cppformat/format.h>
 
 #include <algorithm>
 #include <cstring>
+#include <fstream>
 
 namespace spades {
 
@@ -35,6 +39,87 @@ void AssemblyStage::save(const debruijn_graph::conj_graph_pack& gp,
     debruijn_graph::config::write_lib_data(p);
 }
 
+static std::string JSONString(const std::string &s) {
+    std::string res = "\"";
+    for (char c : s) {
+        switch (c) {
+            case '"': res += "\\\""; break;
+            case '\\': res += "\\\\"; break;
+            case '\n': res += "\\n"; break;
+            case '\t': res += "\\t"; break;
+            case '\r': res += "\\r"; break;
+            case '\b': res += "\\b"; break;
+            case '\f': res += "\\f"; break;
+            default:
+                if ((unsigned char) c < 0x20)
+                    res += fmt::format("\\u{:04x}", unsigned(c));
+                else
+                    res += c;
+        }
+    }
+    return res + "\"";
+}
+
+static std::string RunPrefix(const std::string &run) {
+    return "    {\"run\": " + JSONString(run) + ",";
+}
+
+StageTimeline::StageTimeline(const std::string &filename, const std::string &run)
+        : filename_(filename),
+          run_(run),
+          nthreads_((unsigned) omp_get_max_threads()),
+          origin_(resource_usage::now()) {
+    //keep the records of the other runs sharing the file
+    std::ifstream is(filename_);
+    std::string line;
+    const std::string any_run = "    {\"run\": ", this_run = RunPrefix(run_);
+    while (std::getline(is, line)) {
+        if (line.compare(0, any_run.size(), any_run) || !line.compare(0, this_run.size(), this_run))
+            continue;
+        if (line.back() == ',')
+            line.pop_back();
+        other_runs_.push_back(line);
+    }
+}
+
+void StageTimeline::Record(const char *id, const char *name, const char *type,
+                           const resource_usage &start, const resource_usage &end) {
+    entries_.push_back({ id, name, type, start, end });
+    Dump();
+}
+
+void StageTimeline::Dump() const {
+    std::ofstream os(filename_);
+    if (!os) {
+        WARN("Cannot write stage timeline to " << filename_);
+        return;
+    }
+
+    os << "{\n  \"runs\": [\n";
+    for (const std::string &run : other_runs_)
+        os << run << ",\n";
+
+    os << RunPrefix(run_) << " \"threads\": " << nthreads_ << ", \"stages\": [";
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const Entry &e = entries_[i];
+        double wall = e.end.wall - e.start.wall;
+        double user = e.end.user - e.start.user, sys = e.end.sys - e.start.sys;
+        double utilization = wall > 0 ? (user + sys) / (wall * nthreads_) : 0;
+        os << (i ? ", " : "")
+           << fmt::format("{{\"id\": {}, \"name\": {}, \"type\": {}, "
+                          "\"start\": {:.3f}, \"wall\": {:.3f}, \"user\": {:.3f}, \"sys\": {:.3f}, "
+                          "\"thread_utilization\": {:.3f}, "
+                          "\"max_rss\": {}, \"rss\": {}, \"used_memory\": {}, "
+                          "\"read_bytes\": {}, \"written_bytes\": {}}}",
+                          JSONString(e.id), JSONString(e.name), JSONString(e.type),
+                          e.start.wall - origin_.wall, wall, user, sys, utilization,
+                          e.end.max_rss, e.end.rss, e.end.used_memory,
+                          e.end.read_bytes - e.start.read_bytes,
+                          e.end.written_bytes - e.start.written_bytes);
+    }
+    os << "]}\n  ]\n}\n";
+}
+
 class StageIdComparator {
   public:
     StageIdComparator(const char* id)
@@ -94,7 +179,14 @@ void CompositeStageBase::run(debruijn_graph::conj_graph_pack& gp,
         PhaseBase *phase = start_phase->get();
 
         INFO("PROCEDURE == " << phase->name());
+        resource_usage usage = resource_usage::now();
         phase->run(gp, started_from);
+        if (StageTimeline *timeline = parent_->timeline()) {
+            std::string composite_id(id());
+            composite_id += ":";
+            composite_id += phase->id();
+            timeline->Record(composite_id.c_str(), phase->name(), "phase", usage, resource_usage::now());
+        }
 
         if (parent_->saves_policy().make_saves_) {
             std::string composite_id(id());
@@ -124,7 +216,10 @@ void StageManager::run(debruijn_graph::conj_graph_pack& g,
         AssemblyStage *stage = start_stage->get();
 
         INFO("STAGE == " << stage->name());
+        resource_usage usage = resource_usage::now();
         stage->run(g, start_from);
+        if (timeline_)
+            timeline_->Record(stage->id(), stage->name(), "stage", usage, resource_usage::now());
         if (saves_policy_.make_saves_)
             stage->save(g, saves_policy_.save_to_);
     }
@@ -9,9 +9,11 @@
 #define __STAGE_HPP__
 
 #include "pipeline/graph_pack.hpp"
+#include "utils/resource_usage.hpp"
 
 #include <vector>
 #include <memory>
+#include <string>
 
 namespace spades {
 
@@ -113,6 +115,38 @@ private:
     Storage storage_;
 };
 
+/**
+ * @brief Collects resource usage of stages and phases and dumps it as a JSON timeline.
+ *        The file is rewritten after every record, so it is valid even if the run is interrupted.
+ *        Several runs (e.g. one per K) share the file: every run is written on its own line,
+ *        and a run replaces only its own earlier record.
+ */
+class StageTimeline {
+public:
+    StageTimeline(const std::string &filename, const std::string &run);
+
+    void Record(const char *id, const char *name, const char *type,
+                const resource_usage &start, const resource_usage &end);
+
+private:
+    struct Entry {
+        std::string id;
+        std::string name;
+        std::string type;
+        resource_usage start;
+        resource_usage end;
+    };
+
+    void Dump() const;
+
+    std::string filename_;
+    std::string run_;
+    unsigned nthreads_;
+    resource_usage origin_;
+    std::vector<std::string> other_runs_;
+    std::vector<Entry> entries_;
+};
+
 class StageManager {
 
 public:
@@ -128,8 +162,11 @@ public:
                 : make_saves_(make_saves), load_from_(load_from), save_to_(save_to) { }
     };
 
-    StageManager(SavesPolicy policy = SavesPolicy())
-            : saves_policy_(policy) { }
+    StageManager(SavesPolicy policy = SavesPolicy(),
+                 const std::string &timeline_filename = "",
+                 const std::string &timeline_run = "")
+            : saves_policy_(policy),
+              timeline_(timeline_filename.empty() ? nullptr : new StageTimeline(timeline_filename, timeline_run)) { }
 
     StageManager &add(AssemblyStage *stage) {
         stages_.push_back(std::unique_ptr<AssemblyStage>(stage));
@@ -152,9 +189,14 @@ public:
         return saves_policy_;
     }
 
+    StageTimeline *timeline() const {
+        return timeline_.get();
+    }
+
 private:
     std::vector<std::unique_ptr<AssemblyStage> > stages_;
     SavesPolicy saves_policy_;
+    std::unique_ptr<StageTimeline> timeline_;
 
     DECL_LOGGER("StageManager");
 };
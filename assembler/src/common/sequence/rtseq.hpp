@@ -74,41 +74,12 @@ public:
 
 
     RuntimeSeq<max_size_, T> FastRC() const {
-        const static std::array<T, Iterations> LeftMasks(ConstructLeftMasks());
-        const static std::array<T, Iterations> RightMasks(ConstructRightMasks());
-        const static size_t LogTSize = log_<sizeof(T), 2>::value + 3;
-
-        RuntimeSeq<max_size_, T> res(this->size());
-
-        const size_t bit_size = size_ << 1;
-        const size_t extra = bit_size & ((1 << LogTSize) - 1);
-        const size_t to_extra = TBits - extra;
-        const size_t filled = bit_size >> LogTSize;
-        size_t real_length = filled;
-        if (extra == 0) {
-            for (size_t i = 0, j = filled - 1; i < filled; i++, j--) {
-                res.data_[i] = data_[j];
-            }
-        } else {
-            for (size_t i = 0, j = filled; i < filled && j > 0; i++, j--) {
-                res.data_[i] = (data_[j] << to_extra) + (data_[j - 1] >> extra);
-            }
-            res.data_[filled] = (data_[0] << to_extra);
-            real_length++;
-        }
-
-        for (size_t i = 0; i < real_length; i++) {
-            res.data_[i] = res.data_[i] ^ T(-1);
-            for (size_t it = 1; it < Iterations; it++) {
-                size_t shift = 1 << it;
-                res.data_[i] = T((res.data_[i] & LeftMasks[it]) >> shift) ^ T((res.data_[i] & RightMasks[it]) << shift);
-            }
-        }
-
-        if (extra != 0) {
-            res.data_[real_length - 1] = (res.data_[real_length - 1] & ((T(1) << extra) - 1));
+        switch (GetDataSize(size_)) {
+            case 0: return *this;
+            case 1: return FastRC<1>();
+            case 2: return FastRC<2>();
+            default: return FastRC<0>();
         }
-        return res;
     }
 
     /**
@@ -184,6 +155,85 @@ private:
         VERIFY(*s == 0); // C-string always ends on 0
     }
 
+    /**
+     * Gets i-th symbol of Seq without bounds check
+     */
+    char get(const size_t i) const {
+        return (data_[i >> TNuclBits] >> ((i & (TNucl - 1)) << 1)) & 3;
+    }
+
+    /*
+     * Hot kernels are instantiated for the number of words in use: N = 1 (K <= 32 for 64-bit words),
+     * N = 2 (K <= 64) and N = 0 for the general case. This way the loops over the words
+     * are unrolled for the common small K regardless of max_size_.
+     */
+    template<size_t N>
+    size_t WordsInUse() const {
+        return N ? N : GetDataSize(size_);
+    }
+
+    // Complement and reverse the nucleotides within each word, reverse the order of the words
+    // and shift the result right to drop the padding
+    template<size_t N>
+    RuntimeSeq<max_size_, T> FastRC() const {
+        const static std::array<T, Iterations> LeftMasks(ConstructLeftMasks());
+        const static std::array<T, Iterations> RightMasks(ConstructRightMasks());
+
+        RuntimeSeq<max_size_, T> res(this->size());
+        size_t data_size = WordsInUse<N>();
+        for (size_t i = 0; i < data_size; ++i) {
+            T word = data_[data_size - 1 - i] ^ T(-1);
+            for (size_t it = 1; it < Iterations; it++) {
+                size_t shift = 1 << it;
+                word = T((word & LeftMasks[it]) >> shift) ^ T((word & RightMasks[it]) << shift);
+            }
+            res.data_[i] = word;
+        }
+
+        size_t shift = data_size * TBits - (size_ << 1);
+        if (shift != 0) {
+            for (size_t i = 0; i + 1 < data_size; ++i)
+                res.data_[i] = T(res.data_[i] >> shift) | T(res.data_[i + 1] << (TBits - shift));
+            res.data_[data_size - 1] >>= shift;
+        }
+
+        return res;
+    }
+
+    template<size_t N>
+    void ShiftLeft(char c) {
+        size_t data_size = WordsInUse<N>();
+        for (size_t i = 0; i + 1 < data_size; ++i) {
+            data_[i] = (data_[i] >> 2) | (((T) data_[i + 1] & 3) << (TBits - 2));
+        }
+
+        T lastnuclshift_ = ((size_ + TNucl - 1) & (TNucl - 1)) << 1;
+        data_[data_size - 1] = (data_[data_size - 1] >> 2) | ((T) c << lastnuclshift_);
+    }
+
+    template<size_t N>
+    void ShiftRight(char c) {
+        size_t data_size = WordsInUse<N>();
+        T rm = (T) c;
+        for (size_t i = 0; i < data_size; ++i) {
+            T new_rm = (data_[i] >> (TBits - 2)) & 3;
+            data_[i] = (data_[i] << 2) | rm;
+            rm = new_rm;
+        }
+
+        data_[data_size - 1] &= MaskForLastBucket(size_);
+    }
+
+    template<size_t N>
+    bool Equal(const RuntimeSeq<max_size_, T> &s) const {
+        size_t data_size = WordsInUse<N>();
+        for (size_t i = 0; i < data_size; ++i)
+            if (data_[i] != s.data_[i])
+                return false;
+
+        return true;
+    }
+
     /**
      * Sets i-th symbol of Seq with 0123-char
      */
@@ -396,8 +446,8 @@ public:
      */
     bool IsMinimal() const {
         for (size_t i = 0; (i << 1) + 1 <= size_; ++i) {
-            auto front = this->operator[](i);
-            auto end = complement(this->operator[](size_ - 1 - i));
+            auto front = get(i);
+            auto end = complement(get(size_ - 1 - i));
             if (front != end)
                 return front < end;
         }
@@ -442,18 +492,12 @@ public:
             c = dignucl(c);
         }
 
-        size_t data_size = GetDataSize(size_);
-
-        if (data_size == 0) {
-            return;
+        switch (GetDataSize(size_)) {
+            case 0: return;
+            case 1: ShiftLeft<1>(c); break;
+            case 2: ShiftLeft<2>(c); break;
+            default: ShiftLeft<0>(c);
         }
-
-        for (size_t i = 0; i < data_size - 1; ++i) {
-            data_[i] = (data_[i] >> 2) | (((T) data_[i + 1] & 3) << (TBits - 2));
-        }
-
-        T lastnuclshift_ = ((size_ + TNucl - 1) & (TNucl - 1)) << 1;
-        data_[data_size - 1] = (data_[data_size - 1] >> 2) | ((T) c << lastnuclshift_);
     }
 
 //todo naming convention violation!
@@ -575,27 +619,21 @@ public:
         }
         VERIFY(is_dignucl(c));
 
-        size_t data_size = GetDataSize(size_);
-
-        T rm = (T) c;
-        for (size_t i = 0; i < data_size; ++i) {
-            T new_rm = (data_[i] >> (TBits - 2)) & 3;
-            data_[i] = (data_[i] << 2) | rm;
-            rm = new_rm;
+        switch (GetDataSize(size_)) {
+            case 1: ShiftRight<1>(c); break;
+            case 2: ShiftRight<2>(c); break;
+            default: ShiftRight<0>(c);
         }
-
-        data_[data_size - 1] &= MaskForLastBucket(size_);
     }
 
     bool operator==(const RuntimeSeq<max_size_, T> &s) const {
         VERIFY(size_ == s.size_);
 
-        size_t data_size = GetDataSize(size_);
-        for (size_t i = 0; i < data_size; ++i)
-            if (data_[i] != s.data_[i])
-                return false;
-
-        return true;
+        switch (GetDataSize(size_)) {
+            case 1: return Equal<1>(s);
+            case 2: return Equal<2>(s);
+            default: return Equal<0>(s);
+        }
     }
 
     /**
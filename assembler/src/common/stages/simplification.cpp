@@ -347,7 +347,12 @@ class GraphSimplifier {
 
     bool RunAlgo(const AlgoPtr<Graph>& algo, const string &comment, bool force_primary_launch = false) {
         INFO("Running " << comment);
-        size_t triggered = algo->Run(force_primary_launch);
+        size_t triggered = 0;
+        {
+            //deferrable handlers (edge positions, kmer mapper) catch up after the whole pass
+            omnigraph::EventBatch<Graph> batch(g_);
+            triggered = algo->Run(force_primary_launch);
+        }
         INFO("Triggered " << triggered << " times");
         cnt_callback_.Report();
         return (triggered > 0);
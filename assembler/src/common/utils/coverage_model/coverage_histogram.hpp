@@ -0,0 +1,73 @@
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* Copyright (c) 2011-2014 Saint Petersburg Academic University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "utils/openmp_wrapper.h"
+#include "utils/verify.hpp"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <cstddef>
+
+namespace utils {
+namespace coverage_model {
+
+/*
+ * Histogram of coverage values filled concurrently by the OpenMP threads.
+ * Every thread counts into its own dense array, rare values above dense_limit
+ * go to a per-thread map. The counts are summed up on extraction.
+ */
+class CoverageHistogram {
+    struct ThreadCounts {
+        std::vector<size_t> dense;
+        std::map<size_t, size_t> sparse;
+    };
+
+    size_t dense_limit_;
+    std::vector<ThreadCounts> counts_;
+
+public:
+    CoverageHistogram(size_t dense_limit = 1 << 16)
+            : dense_limit_(dense_limit), counts_(omp_get_max_threads()) {}
+
+    void Add(size_t value, size_t count = 1) {
+        size_t thread = omp_get_thread_num();
+        VERIFY(thread < counts_.size());
+        ThreadCounts &counts = counts_[thread];
+        if (value >= dense_limit_) {
+            counts.sparse[value] += count;
+            return;
+        }
+        if (value >= counts.dense.size())
+            counts.dense.resize(value + 1, 0);
+        counts.dense[value] += count;
+    }
+
+    // Counts of all the values from 0 up to the maximal added one.
+    std::vector<size_t> Counts() const {
+        size_t size = 0;
+        for (const auto &counts : counts_) {
+            size = std::max(size, counts.dense.size());
+            if (!counts.sparse.empty())
+                size = std::max(size, counts.sparse.rbegin()->first + 1);
+        }
+
+        std::vector<size_t> result(size, 0);
+        for (const auto &counts : counts_) {
+            for (size_t i = 0; i < counts.dense.size(); ++i)
+                result[i] += counts.dense[i];
+            for (const auto &entry : counts.sparse)
+                result[entry.first] += entry.second;
+        }
+        return result;
+    }
+};
+
+}
+}
@@ -11,6 +11,7 @@
 #include "utils/verify.hpp"
 #include "math/xmath.h"
 #include "math/smooth.hpp"
+#include "utils/openmp_wrapper.h"
 
 #include <boost/math/special_functions/zeta.hpp>
 #include <boost/math/distributions/normal.hpp>
@@ -96,6 +97,8 @@ private:
 struct CovModelLogLikeEMData {
     const std::vector<size_t>& cov;
     const std::vector<double>& z;
+    // Indices of the non-empty histogram bins, the only ones contributing to the likelihood
+    const std::vector<size_t>& bins;
 };
 
 static double CovModelLogLikeEM(unsigned, const double* x, double*, void* data) {
@@ -110,37 +113,28 @@ static double CovModelLogLikeEM(unsigned, const double* x, double*, void* data)
 
     const std::vector<size_t>& cov = static_cast<CovModelLogLikeEMData*>(data)->cov;
     const std::vector<double>& z = static_cast<CovModelLogLikeEMData*>(data)->z;
+    const std::vector<size_t>& bins = static_cast<CovModelLogLikeEMData*>(data)->bins;
 
-    std::vector<double> kmer_probs(cov.size(), 0);
-
-    // Error
-    for (size_t i = 0; i < kmer_probs.size(); ++i) {
-        if (cov[i] == 0)
-            continue;
-
-        kmer_probs[i] += z[i] * log(perr(i + 1, scale, shape));
-    }
-
-    // Good
     // Pre-compute mixing probabilities
     std::vector<double> mixprobs(MaxCopy, 0);
     for (unsigned copy = 0; copy < MaxCopy; ++copy)
         mixprobs[copy] = dzeta(copy + 1, zp);
 
-    // Compute the density
-    for (size_t i = 0; i < kmer_probs.size(); ++i) {
-        if (cov[i] == 0)
-            continue;
-
+    // Compute the error and good densities of the bins in a single pass
+    std::vector<double> kmer_probs(bins.size(), 0);
+#   pragma omp parallel for schedule(static)
+    for (size_t j = 0; j < bins.size(); ++j) {
+        size_t i = bins[j];
         double val = log(pgood(i + 1, zp, u, sd, shape2, &mixprobs[0]));
         if (!isfinite(val))
             val = -1000.0;
-        kmer_probs[i] += (1 - z[i]) * val;
+        kmer_probs[j] = z[i] * log(perr(i + 1, scale, shape)) + (1 - z[i]) * val;
     }
 
+    // Sum up in a fixed order, so the result does not depend on the number of threads
     double res = 0;
-    for (size_t i = 0; i < kmer_probs.size(); ++i)
-        res += (double) (cov[i]) * kmer_probs[i];
+    for (size_t j = 0; j < bins.size(); ++j)
+        res += (double) (cov[bins[j]]) * kmer_probs[j];
 
     // INFO("f: " << res);
     return res;
@@ -152,6 +146,7 @@ static std::vector<double> EStep(const std::vector<double>& x,
     double zp = x[0], shape = x[1], u = x[2], sd = x[3], scale = x[4], shape2 = x[5];
 
     std::vector<double> res(N);
+#   pragma omp parallel for schedule(static)
     for (size_t i = 0; i < N; ++i) {
         double pe = p * perr(i + 1, scale, shape);
         res[i] = pe / (pe + (1 - p) * pgood(i + 1, zp, u, sd, shape2));
@@ -263,6 +258,10 @@ void KMerCoverageModel::Fit() {
     const double ErrProbThr = 1e-8;
     auto GoodCov = cov_;
     GoodCov.resize(std::min(cov_.size(), 5 * MaxCopy * MaxCov_ / 4));
+    std::vector<size_t> GoodBins;
+    for (size_t i = 0; i < GoodCov.size(); ++i)
+        if (GoodCov[i])
+            GoodBins.push_back(i);
     converged_ = true;
     unsigned it = 1;
     while (fabs(PrevErrProb - ErrorProb) > ErrProbThr) {
@@ -279,7 +278,7 @@ void KMerCoverageModel::Fit() {
         bool LastIter = fabs(PrevErrProb - ErrorProb) <= ErrProbThr;
 
         nlopt::opt opt(nlopt::LN_NELDERMEAD, 6);
-        CovModelLogLikeEMData data = {GoodCov, z};
+        CovModelLogLikeEMData data = {GoodCov, z, GoodBins};
         opt.set_max_objective(CovModelLogLikeEM, &data);
         if (!LastIter)
             opt.set_maxeval(5 * 6 * it);
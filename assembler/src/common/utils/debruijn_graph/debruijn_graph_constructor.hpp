@@ -307,15 +307,34 @@ private:
         }
     }
 
+    //Collects the k-mers of the part which are not junctions in the order of the k-mer file. The index is not modified.
+    void CollectLoopKmers(kmer_iterator &it, std::vector<KeyWithHash> &kmers) const {
+        for (; it.good(); ++it) {
+            KeyWithHash kh = origin_.ConstructKWH(Kmer(kmer_size_, *it));
+            if (!IsJunction(kh))
+                kmers.push_back(kh);
+        }
+    }
+
     //This methods collects all loops that were not extracted by finding unbranching paths because there are no junctions on loops.
-    //TODO make parallel
+    //After the paths are condensed only the k-mers of the loops are not junctions, so the k-mer file is scanned for them
+    //in parallel and the loops are condensed serially in the order of the file, as isolating k-mers rewrites their masks.
     const std::vector<Sequence> CollectLoops() {
         INFO("Collecting perfect loops");
+        std::vector<kmer_iterator> iters = origin_.kmer_begin(10 * omp_get_max_threads());
+        std::vector<std::vector<KeyWithHash>> loop_kmers(iters.size());
+#   pragma omp parallel for schedule(guided)
+        for (size_t i = 0; i < iters.size(); ++i) {
+            CollectLoopKmers(iters[i], loop_kmers[i]);
+        }
+
         UnbranchingPathFinder finder(origin_, kmer_size_);
         std::vector<Sequence> result;
-        for (kmer_iterator it = origin_.kmer_begin(); it.good(); ++it) {
-            KeyWithHash kh = origin_.ConstructKWH(Kmer(kmer_size_, *it));
-            if (!IsJunction(kh)) {
+        for (const auto &chunk : loop_kmers) {
+            for (const KeyWithHash &kh : chunk) {
+                if (IsJunction(kh))
+                    continue;
+
                 vector<Sequence> loop = finder.ConstructLoopFromVertex(kh);
                 for(Sequence s: loop) {
                     result.push_back(s);
@@ -13,6 +13,8 @@
  *      Author: anton
  */
 
+#include <algorithm>
+
 namespace debruijn_graph {
 
 template<class V>
@@ -94,4 +96,24 @@ public:
     }
 };
 
+/*
+ * Applies f to every value of the index. The value range is split into chunks
+ * which are processed by the OpenMP threads, so f must be safe to call
+ * concurrently for different values.
+ */
+template<class Index, class F>
+void ParallelForEachValue(const Index &index, F f, size_t chunk_size = 1 << 16) {
+    auto begin = index.value_cbegin();
+    size_t size = index.value_cend() - begin;
+    size_t chunks = (size + chunk_size - 1) / chunk_size;
+
+#   pragma omp parallel for schedule(dynamic)
+    for (size_t chunk = 0; chunk < chunks; ++chunk) {
+        auto I = begin + chunk * chunk_size;
+        auto E = begin + std::min(size, (chunk + 1) * chunk_size);
+        for (; I != E; ++I)
+            f(*I);
+    }
+}
+
 }
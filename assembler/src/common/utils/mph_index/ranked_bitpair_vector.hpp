@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <iostream>
 
 #include "common.hpp"
 #include "bitpair_vector.hpp"
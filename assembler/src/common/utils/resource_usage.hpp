@@ -0,0 +1,66 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+
+#include "memory_limit.hpp"
+
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+
+/**
+ * @brief Snapshot of the resource usage counters of the current process.
+ *        Times are in seconds, memory and I/O are in bytes. Counters which are not
+ *        available on the platform (e.g. /proc is missing) are left zero.
+ */
+struct resource_usage {
+    double wall;
+    double user;
+    double sys;
+    size_t max_rss;
+    size_t rss;
+    size_t used_memory;
+    size_t read_bytes;
+    size_t written_bytes;
+
+    static resource_usage now() {
+        resource_usage res = {};
+
+        timeval tv;
+        gettimeofday(&tv, NULL);
+        res.wall = (double) tv.tv_sec + (double) tv.tv_usec * 1e-6;
+
+        rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        res.user = (double) ru.ru_utime.tv_sec + (double) ru.ru_utime.tv_usec * 1e-6;
+        res.sys = (double) ru.ru_stime.tv_sec + (double) ru.ru_stime.tv_usec * 1e-6;
+
+        res.max_rss = get_max_rss() * 1024;
+        res.used_memory = get_used_memory();
+
+        std::ifstream statm("/proc/self/statm");
+        size_t vm_pages = 0, rss_pages = 0;
+        if (statm >> vm_pages >> rss_pages)
+            res.rss = rss_pages * (size_t) sysconf(_SC_PAGESIZE);
+
+        // rchar / wchar count all the bytes passed through read(2) and write(2)-like calls
+        std::ifstream io("/proc/self/io");
+        std::string key;
+        size_t value;
+        while (io >> key >> value) {
+            if (key == "rchar:")
+                res.read_bytes = value;
+            else if (key == "wchar:")
+                res.written_bytes = value;
+        }
+
+        return res;
+    }
+};
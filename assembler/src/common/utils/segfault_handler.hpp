@@ -12,6 +12,7 @@
 #include "boost/noncopyable.hpp"
 
 #include <signal.h>
+#include <functional>
 
 struct segfault_handler : boost::noncopyable {
     typedef std::function<void()> callback_t;
@@ -11,6 +11,7 @@
 #include "assembly_graph/handlers/edges_position_handler.hpp"
 #include "io/reads/wrapper_collection.hpp"
 #include "io/reads/io_helper.hpp"
+#include "utils/openmp_wrapper.h"
 
 namespace visualization {
 
@@ -37,8 +38,39 @@ public:
     }
 
     void Process(const io::SingleRead &read) const {
-        omnigraph::MappingPath<EdgeId> path = mapper_->MapRead(read);
-        const string name = read.name();
+        AddPositions(read.name(), mapper_->MapRead(read));
+    }
+
+    //reads are mapped in parallel, positions are added in the order of the reads
+    void Process(const vector<io::SingleRead> &reads) const {
+        vector<omnigraph::MappingPath<EdgeId>> paths(reads.size());
+#       pragma omp parallel for schedule(dynamic)
+        for (size_t i = 0; i < reads.size(); ++i) {
+            paths[i] = mapper_->MapRead(reads[i]);
+        }
+        for (size_t i = 0; i < reads.size(); ++i) {
+            AddPositions(reads[i].name(), paths[i]);
+        }
+    }
+
+    void Process(io::SingleStream &stream) const {
+        vector<io::SingleRead> reads;
+        io::SingleRead read;
+        while (!stream.eof()) {
+            stream >> read;
+            reads.push_back(read);
+            if (reads.size() == READ_BATCH_SIZE) {
+                Process(reads);
+                reads.clear();
+            }
+        }
+        Process(reads);
+    }
+
+private:
+    static const size_t READ_BATCH_SIZE = 1024;
+
+    void AddPositions(const string &name, const omnigraph::MappingPath<EdgeId> &path) const {
         int cur_pos = 0;
         TRACE("Contig " << name << " mapped on " << path.size()
                         << " fragments.");
@@ -66,15 +98,6 @@ public:
         }
     }
 
-    void Process(io::SingleStream &stream) const {
-        io::SingleRead read;
-        while (!stream.eof()) {
-            stream >> read;
-            Process(read);
-        }
-    }
-
-private:
     DECL_LOGGER("PosFiller");
 };
 
@@ -92,5 +115,13 @@ void FillPos(gp_t &gp, const Sequence &s, string name) {
     pos_filler.Process(s, name);
 }
 
+//both strands of the genome are mapped in parallel
+template<class gp_t>
+void FillPos(gp_t &gp, const Sequence &genome, string name, string rc_name) {
+    PosFiller<typename gp_t::graph_t> pos_filler(gp.g, debruijn_graph::MapperInstance(gp), gp.edge_pos);
+    pos_filler.Process(vector<io::SingleRead>{io::SingleRead(name, genome.str()),
+                                              io::SingleRead(rc_name, (!genome).str())});
+}
+
 }
 }
\ No newline at end of file
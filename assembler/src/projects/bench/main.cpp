@@ -0,0 +1,441 @@
+//***************************************************************************
+//* Copyright (c) 2016 Saint Petersburg State University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#include "utils/logger/log_writers.hpp"
+#include "utils/segfault_handler.hpp"
+#include "utils/perfcounter.hpp"
+#include "utils/mph_index/kmer_index_builder.hpp"
+#include "utils/indices/kmer_splitters.hpp"
+
+#include "assembly_graph/core/graph.hpp"
+#include "assembly_graph/dijkstra/dijkstra_helper.hpp"
+#include "assembly_graph/paths/path_processor.hpp"
+#include "modules/graph_construction.hpp"
+#include "modules/alignment/edge_index.hpp"
+#include "modules/alignment/kmer_mapper.hpp"
+#include "modules/alignment/sequence_mapper.hpp"
+#include "paired_info/histogram.hpp"
+#include "paired_info/concurrent_pair_info_buffer.hpp"
+
+#include "io/reads/io_helper.hpp"
+#include "io/reads/rc_reader_wrapper.hpp"
+#include "io/reads/vector_reader.hpp"
+#include "io/reads/read_stream_vector.hpp"
+#include "io/reads/binary_converter.hpp"
+#include "io/reads/binary_streams.hpp"
+#include "sequence/sequence_tools.hpp"
+
+#include "version.hpp"
+
+#include <cxxopts/cxxopts.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace debruijn_graph;
+
+void create_console_logger() {
+    using namespace logging;
+
+    logger *lg = create_logger("");
+    lg->add_writer(std::make_shared<console_writer>());
+    attach_logger(lg);
+}
+
+namespace bench {
+
+/**
+ * @brief Runs the benchmarks and collects their timings. Every benchmark is repeated several
+ *        times, minimal and median wall clock times are reported along with the throughput.
+ */
+class Runner {
+    struct Result {
+        std::string name;
+        std::string unit;
+        size_t items;
+        double min;
+        double median;
+    };
+
+public:
+    Runner(unsigned nthreads, unsigned reps, const std::string &filter)
+            : nthreads_(nthreads), reps_(std::max(reps, 1u)), filter_(filter) {}
+
+    bool enabled(const std::string &name) const {
+        return filter_.empty() || name.find(filter_) != std::string::npos;
+    }
+
+    bool enabled(std::initializer_list<std::string> names) const {
+        return std::any_of(names.begin(), names.end(),
+                           [this](const std::string &name) { return enabled(name); });
+    }
+
+    template<class F>
+    void Run(const std::string &name, const std::string &unit, size_t items, F f) {
+        if (!enabled(name))
+            return;
+
+        INFO("Running " << name);
+        std::vector<double> times;
+        for (unsigned i = 0; i < reps_; ++i) {
+            perf_counter pc;
+            f();
+            times.push_back(pc.time());
+        }
+        std::sort(times.begin(), times.end());
+
+        Result res = { name, unit, items, times.front(), times[times.size() / 2] };
+        INFO(name << ": " << items << " " << unit << ", median " << res.median << " s, "
+             << Rate(res) << " " << unit << "/s");
+        results_.push_back(res);
+    }
+
+    /**
+     * @brief Writes the results as a tab-separated table with a header line.
+     */
+    void Report(std::ostream &os) const {
+        os << "benchmark\tunit\titems\tthreads\trepeats\tmin_sec\tmedian_sec\titems_per_sec\n";
+        for (const auto &res : results_)
+            os << res.name << '\t' << res.unit << '\t' << res.items << '\t'
+               << nthreads_ << '\t' << reps_ << '\t'
+               << res.min << '\t' << res.median << '\t' << Rate(res) << '\n';
+    }
+
+private:
+    static double Rate(const Result &res) {
+        return res.median > 0 ? double(res.items) / res.median : 0;
+    }
+
+    unsigned nthreads_;
+    unsigned reps_;
+    std::string filter_;
+    std::vector<Result> results_;
+};
+
+std::vector<io::SingleRead> GenerateReads(size_t genome_len, size_t read_len,
+                                          double coverage, double error_rate, uint64_t seed) {
+    VERIFY(genome_len >= read_len);
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<unsigned> nucl_dist(0, 3);
+    std::uniform_real_distribution<double> dice(0, 1);
+
+    std::string genome(genome_len, 'A');
+    for (auto &c : genome)
+        c = nucl(char(nucl_dist(rng)));
+
+    size_t nreads = size_t(coverage * double(genome_len) / double(read_len));
+    INFO("Generating " << nreads << " reads of length " << read_len
+         << " from random genome of length " << genome_len);
+
+    std::uniform_int_distribution<size_t> position(0, genome_len - read_len);
+    std::string qual(read_len, 'I');
+    std::vector<io::SingleRead> reads;
+    reads.reserve(nreads);
+    for (size_t i = 0; i < nreads; ++i) {
+        std::string s = genome.substr(position(rng), read_len);
+        for (auto &c : s) {
+            if (dice(rng) < error_rate)
+                c = nucl(char((dignucl(c) + 1 + nucl_dist(rng) % 3) & 3));
+        }
+        if (dice(rng) < 0.5)
+            s = ReverseComplement(s);
+        reads.emplace_back("read_" + std::to_string(i), s, qual);
+    }
+
+    return reads;
+}
+
+std::vector<io::SingleRead> LoadReads(const std::vector<std::string> &files, size_t max_reads) {
+    std::vector<io::SingleRead> reads;
+    for (const auto &file : files) {
+        INFO("Loading reads from " << file);
+        auto stream = io::EasyStream(file, /* followed_by_rc */ false);
+        io::SingleRead r;
+        while (!stream->eof() && reads.size() < max_reads) {
+            *stream >> r;
+            reads.push_back(r);
+        }
+    }
+    INFO("Total " << reads.size() << " reads loaded");
+
+    return reads;
+}
+
+void RunGraphBenchmarks(Runner &runner, const std::vector<io::SingleRead> &reads,
+                        const Graph &g, const EdgeIndex<Graph> &index, const KmerMapper<Graph> &kmer_mapper,
+                        const std::vector<EdgeId> &edges,
+                        unsigned nthreads, size_t queries, size_t path_bound) {
+    typedef BasicSequenceMapper<Graph, EdgeIndex<Graph>> Mapper;
+
+    if (runner.enabled("map_sequence")) {
+        Mapper mapper(g, index, kmer_mapper);
+        runner.Run("map_sequence", "reads", reads.size(), [&]() {
+            size_t mapped = 0;
+#           pragma omp parallel for num_threads(nthreads) schedule(guided) reduction(+ : mapped)
+            for (size_t i = 0; i < reads.size(); ++i)
+                mapped += mapper.MapSequence(reads[i].sequence()).size();
+            VERIFY(mapped);
+        });
+    }
+
+    std::vector<VertexId> starts(g.begin(), g.end());
+    std::shuffle(starts.begin(), starts.end(), std::mt19937_64(42));
+    starts.resize(std::min<size_t>(starts.size(), queries));
+
+    runner.Run("dijkstra", "queries", starts.size(), [&]() {
+        size_t reached = 0;
+#       pragma omp parallel for num_threads(nthreads) schedule(guided) reduction(+ : reached)
+        for (size_t i = 0; i < starts.size(); ++i) {
+            auto dijkstra = DijkstraHelper<Graph>::CreateBoundedDijkstra(g, path_bound);
+            dijkstra.Run(starts[i]);
+            reached += dijkstra.ReachedVertices().size();
+        }
+        VERIFY(reached);
+    });
+
+    if (runner.enabled("path_processor")) {
+        // Every query asks for the paths to the farthest reachable vertex
+        std::vector<std::pair<VertexId, VertexId>> ends;
+        for (VertexId v : starts) {
+            auto dijkstra = DijkstraHelper<Graph>::CreateBoundedDijkstra(g, path_bound);
+            dijkstra.Run(v);
+            VertexId farthest = v;
+            for (VertexId u : dijkstra.ReachedVertices())
+                if (dijkstra.GetDistance(u) > dijkstra.GetDistance(farthest))
+                    farthest = u;
+            ends.push_back(std::make_pair(v, farthest));
+        }
+
+        runner.Run("path_processor", "queries", ends.size(), [&]() {
+            size_t paths = 0;
+#           pragma omp parallel for num_threads(nthreads) schedule(guided) reduction(+ : paths)
+            for (size_t i = 0; i < ends.size(); ++i) {
+                PathStorageCallback<Graph> callback(g);
+                ProcessPaths(g, 0, path_bound, ends[i].first, ends[i].second, callback);
+                paths += callback.size();
+            }
+            VERIFY(paths);
+        });
+    }
+
+    if (runner.enabled("paired_buffer_insert")) {
+        using namespace omnigraph::de;
+
+        std::mt19937_64 rng(42);
+        std::uniform_int_distribution<size_t> edge(0, edges.size() - 1);
+        std::vector<std::pair<EdgeId, EdgeId>> edge_pairs(size_t(1) << 20);
+        for (auto &ep : edge_pairs)
+            ep = std::make_pair(edges[edge(rng)], edges[edge(rng)]);
+
+        runner.Run("paired_buffer_insert", "points", edge_pairs.size(), [&]() {
+            ConcurrentPairedInfoBuffer<Graph> buffer(g);
+#           pragma omp parallel for num_threads(nthreads) schedule(static)
+            for (size_t i = 0; i < edge_pairs.size(); ++i)
+                buffer.Add(edge_pairs[i].first, edge_pairs[i].second,
+                           RawPoint(DEDistance(i % 1000), 1));
+            VERIFY(buffer.size());
+        });
+    }
+}
+
+void RunBenchmarks(Runner &runner, const std::vector<io::SingleRead> &reads,
+                   io::ReadStreamList<io::SingleRead> &streams, const std::string &tmpdir,
+                   unsigned K, unsigned nthreads, size_t queries, size_t path_bound) {
+    typedef KMerIndex<kmer_index_traits<RtSeq>> KMerIndexT;
+    typedef DeBruijnReadKMerSplitter<io::SingleRead, StoringTypeFilter<SimpleStoring>> Splitter;
+
+    size_t read_kmers = 0;
+    for (const auto &r : reads)
+        read_kmers += r.size() >= K ? r.size() - K + 1 : 0;
+
+    if (!read_kmers)
+        WARN("No reads longer than K, k-mer and graph benchmarks skipped");
+
+    // K-mer splitting, both strands of every read are processed
+    if (read_kmers)
+        runner.Run("kmer_splitter", "kmers", 2 * read_kmers, [&]() {
+            std::string splitdir = path::make_temp_dir(tmpdir, "split");
+            Splitter(splitdir, K, 0, streams).Split(16 * nthreads);
+            path::remove_dir(splitdir);
+        });
+
+    if (read_kmers && runner.enabled({"mphf_build", "mphf_lookup"})) {
+        // Index over all the distinct k-mers, the final k-mers are kept for raw MPHF construction
+        Splitter splitter(tmpdir, K, 0, streams);
+        KMerDiskCounter<RtSeq> counter(tmpdir, splitter);
+        KMerIndexT kmer_index;
+        size_t kmers = KMerIndexBuilder<KMerIndexT>(tmpdir, 16, nthreads).BuildIndex(kmer_index, counter, /* save_final */ true);
+        if (runner.enabled("mphf_build")) {
+            auto final_kmers = counter.GetFinalKMers();
+            runner.Run("mphf_build", "kmers", kmers, [&]() {
+                emphf::hypergraph_sorter_seq<emphf::hypergraph<uint64_t>> sorter;
+                emphf::mphf<emphf::city_hasher>(sorter, kmers,
+                                                emphf::range(final_kmers->begin(), final_kmers->end()),
+                                                kmer_index_traits<RtSeq>::KMerRawReferenceAdaptor());
+            });
+        }
+
+        runner.Run("mphf_lookup", "kmers", read_kmers, [&]() {
+            size_t checksum = 0;
+#           pragma omp parallel for num_threads(nthreads) schedule(guided) reduction(+ : checksum)
+            for (size_t i = 0; i < reads.size(); ++i) {
+                const Sequence &seq = reads[i].sequence();
+                if (seq.size() < K)
+                    continue;
+                RtSeq kmer = seq.start<RtSeq>(K) >> 'A';
+                for (size_t j = K - 1; j < seq.size(); ++j) {
+                    kmer <<= seq[j];
+                    checksum += kmer_index.seq_idx(kmer);
+                }
+            }
+            VERIFY(checksum);
+        });
+    }
+
+    if (read_kmers && runner.enabled({"map_sequence", "dijkstra", "path_processor", "paired_buffer_insert"})) {
+        Graph g(K);
+        EdgeIndex<Graph> index(g, tmpdir);
+        KmerMapper<Graph> kmer_mapper(g);
+        index.Detach();
+        ConstructGraph(config::debruijn_config::construction(), streams, g, index);
+        INFO("Graph with " << g.size() << " vertices constructed");
+
+        std::vector<EdgeId> edges;
+        for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it)
+            edges.push_back(*it);
+        if (edges.empty()) {
+            WARN("Graph has no edges, graph benchmarks skipped");
+        } else {
+            RunGraphBenchmarks(runner, reads, g, index, kmer_mapper, edges, nthreads, queries, path_bound);
+        }
+    }
+
+    if (runner.enabled("histogram_merge")) {
+        using namespace omnigraph::de;
+
+        std::mt19937_64 rng(42);
+        std::uniform_int_distribution<int> distance(-1000, 1000);
+        std::vector<RawHistogram> hists(1024);
+        size_t points = 0;
+        for (auto &hist : hists) {
+            for (size_t i = 0; i < 256; ++i)
+                hist.merge_point(RawPoint(DEDistance(distance(rng)), 1));
+            points += hist.size();
+        }
+
+        runner.Run("histogram_merge", "points", points, [&]() {
+            RawHistogram total;
+            for (const auto &hist : hists)
+                total.merge(hist);
+            VERIFY(total.size());
+        });
+    }
+
+    if (runner.enabled("binary_read_stream")) {
+        std::string prefix = path::append_path(tmpdir, "reads");
+        {
+            io::BinaryWriter writer(prefix, nthreads, size_t(64) << 20);
+            io::VectorReadStream<io::SingleRead> stream(reads);
+            writer.ToBinary(stream);
+        }
+
+        runner.Run("binary_read_stream", "reads", reads.size(), [&]() {
+            size_t nreads = 0;
+#           pragma omp parallel for num_threads(nthreads) schedule(static, 1) reduction(+ : nreads)
+            for (unsigned i = 0; i < nthreads; ++i) {
+                io::BinaryFileSingleStream stream(prefix, i);
+                io::SingleReadSeq r;
+                while (!stream.eof()) {
+                    stream >> r;
+                    nreads += 1;
+                }
+            }
+            VERIFY(nreads == reads.size());
+        });
+    }
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    srand(42);
+    srandom(42);
+    try {
+        unsigned nthreads, K, reps, queries;
+        std::string workdir, output, filter;
+        std::vector<std::string> input;
+        size_t genome_len, read_len, max_reads, path_bound;
+        double coverage, error_rate;
+
+        cxxopts::Options options(argv[0], " [<input files>] - SPAdes microbenchmarks");
+        options.add_options()
+                ("k,kmer", "K-mer length", cxxopts::value<unsigned>(K)->default_value("55"), "K")
+                ("t,threads", "# of threads to use", cxxopts::value<unsigned>(nthreads)->default_value(std::to_string(omp_get_max_threads())), "num")
+                ("w,workdir", "Working directory to use", cxxopts::value<std::string>(workdir)->default_value("."), "dir")
+                ("o,output", "Output file for the results (tab-separated)", cxxopts::value<std::string>(output)->default_value("spades-bench.tsv"), "file")
+                ("r,repeats", "# of repetitions of each benchmark", cxxopts::value<unsigned>(reps)->default_value("3"), "num")
+                ("f,filter", "Run only benchmarks whose names contain the string", cxxopts::value<std::string>(filter), "str")
+                ("h,help", "Print help");
+
+        options.add_options("Input")
+                ("genome-length", "Length of the synthetic genome", cxxopts::value<size_t>(genome_len)->default_value("1000000"), "num")
+                ("read-length", "Length of the synthetic reads", cxxopts::value<size_t>(read_len)->default_value("100"), "num")
+                ("coverage", "Coverage of the synthetic reads", cxxopts::value<double>(coverage)->default_value("20"), "num")
+                ("error-rate", "Substitution rate of the synthetic reads", cxxopts::value<double>(error_rate)->default_value("0.001"), "num")
+                ("max-reads", "Maximal # of reads to load from input files", cxxopts::value<size_t>(max_reads)->default_value("1000000"), "num")
+                ("queries", "# of graph traversal queries", cxxopts::value<unsigned>(queries)->default_value("10000"), "num")
+                ("path-bound", "Length bound for graph traversals", cxxopts::value<size_t>(path_bound)->default_value("500"), "num")
+                ("positional", "", cxxopts::value<std::vector<std::string>>(input));
+
+        options.parse_positional("positional");
+        options.parse(argc, argv);
+        if (options.count("help")) {
+            std::cout << options.help({"", "Input"}) << std::endl;
+            exit(0);
+        }
+
+        create_console_logger();
+
+        INFO("Starting SPAdes microbenchmarks, built from " SPADES_GIT_REFSPEC ", git revision " SPADES_GIT_SHA1);
+        INFO("K-mer length set to " << K);
+        INFO("# of threads to use: " << nthreads);
+
+        std::string tmpdir = path::make_temp_dir(workdir, "bench");
+        std::vector<io::SingleRead> reads =
+                input.empty() ?
+                bench::GenerateReads(genome_len, read_len, coverage, error_rate, 42) :
+                bench::LoadReads(input, max_reads);
+        VERIFY_MSG(!reads.empty(), "No reads to run benchmarks on");
+
+        io::ReadStreamList<io::SingleRead> streams;
+        for (unsigned i = 0; i < nthreads; ++i) {
+            std::vector<io::SingleRead> chunk(reads.begin() + reads.size() * i / nthreads,
+                                              reads.begin() + reads.size() * (i + 1) / nthreads);
+            streams.push_back(io::RCWrap<io::SingleRead>(std::make_shared<io::VectorReadStream<io::SingleRead>>(chunk)));
+        }
+
+        bench::Runner runner(nthreads, reps, filter);
+
+        bench::RunBenchmarks(runner, reads, streams, tmpdir, K, nthreads, queries, path_bound);
+
+        std::ofstream os(output);
+        runner.Report(os);
+        INFO("Results saved to " << output);
+
+        path::remove_dir(tmpdir);
+    } catch (std::string const &s) {
+        std::cerr << s;
+        return EINTR;
+    } catch (const cxxopts::OptionException &e) {
+        std::cerr << "error parsing options: " << e.what() << std::endl;
+        exit(1);
+    }
+
+    return 0;
+}
@@ -247,20 +247,19 @@ bool ContigProcessor::CountPositions(const PairedSamRead &read, unordered_map<si
 
 size_t ContigProcessor::ProcessMultipleSamFiles() {
     error_counts_.resize(kMaxErrorNum);
+    vector<SingleSamRead> batch(kReadBatchSize);
     for (const auto &sf : sam_files_) {
-        MappedSamStream sm(sf.first);
-        while (!sm.eof()) {
-            SingleSamRead tmp;
-            sm >> tmp;
-
-            UpdateOneRead(tmp, sm);
+        MappedSamStream sm(sf.first, nthreads_);
+        while (size_t cnt = sm.ReadBatch(batch)) {
+            for (size_t i = 0; i < cnt; ++i)
+                UpdateOneRead(batch[i], sm);
         }
         sm.close();
     }
 
     ipp_.FillInterestingPositions(charts_);
     for (const auto &sf : sam_files_) {
-        MappedSamStream sm(sf.first);
+        MappedSamStream sm(sf.first, nthreads_);
         while (!sm.eof()) {
             unordered_map<size_t, position_description> ps;
             if (sf.second == io::LibraryType::PairedEnd ) {
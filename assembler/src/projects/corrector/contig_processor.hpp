@@ -39,12 +39,14 @@ class ContigProcessor {
     std::vector<position_description> charts_;
     InterestingPositionProcessor ipp_;
     std::vector<int> error_counts_;
+    unsigned nthreads_;
 
     const size_t kMaxErrorNum = 20;
+    const size_t kReadBatchSize = 1024;
 
 public:
-    ContigProcessor(const sam_files_type &sam_files, const std::string &contig_file)
-            : sam_files_(sam_files), contig_file_(contig_file) {
+    ContigProcessor(const sam_files_type &sam_files, const std::string &contig_file, unsigned nthreads = 1)
+            : sam_files_(sam_files), contig_file_(contig_file), nthreads_(nthreads) {
         ReadContig();
         ipp_.set_contig(contig_);
     }
@@ -240,10 +240,13 @@ void DatasetProcessor::ProcessDataset() {
     size_t cont_num = ordered_contigs.size();
     sort(ordered_contigs.begin(), ordered_contigs.end(), std::greater<pair<size_t, string> >());
     auto all_contigs_ptr = &all_contigs_;
+    //Threads left over from the contigs decode the alignments
+    unsigned contig_threads = (unsigned) std::max(size_t(1), nthreads_ / std::max(cont_num, size_t(1)));
 # pragma omp parallel for shared(all_contigs_ptr, ordered_contigs) num_threads(nthreads_) schedule(dynamic,1)
     for (size_t i = 0; i < cont_num; i++) {
         bool long_enough = (*all_contigs_ptr)[ordered_contigs[i].second].contig_length > kMinContigLengthForInfo;
-        ContigProcessor pc((*all_contigs_ptr)[ordered_contigs[i].second].sam_filenames, (*all_contigs_ptr)[ordered_contigs[i].second].input_contig_filename);
+        ContigProcessor pc((*all_contigs_ptr)[ordered_contigs[i].second].sam_filenames, (*all_contigs_ptr)[ordered_contigs[i].second].input_contig_filename,
+                           contig_threads);
         size_t changes = pc.ProcessMultipleSamFiles();
         if (long_enough) {
 #pragma omp critical
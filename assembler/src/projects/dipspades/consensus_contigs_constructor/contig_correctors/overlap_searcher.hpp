@@ -368,19 +368,20 @@ public:
         }
         og.InitializeVertexSet(vertices, id, rc_id);
 
+        vector<vector<EdgeId> > contig_paths;
         vector<vector<VertexId> > seqs;
         for(size_t i = 0; i < contigs->Size(); i++){
-            vector<VertexId> seq = GetListOfVertices((*contigs)[i]->path_seq());
-            seqs.push_back(seq);
+            contig_paths.push_back((*contigs)[i]->path_seq());
+            seqs.push_back(GetListOfVertices(contig_paths.back()));
         }
-        LCSCalculator<VertexId> lcs_calc;
-        set<pair<int, int> > processed_pairs;
 
+        // choice of pairs does not depend on the results, so all of them are aligned at once
+        set<pair<int, int> > processed_pairs;
+        vector<pair<size_t, size_t> > candidate_pairs;
         for(size_t i = 0; i < contigs->Size(); i++){
-            auto path1 = (*contigs)[i]->path_seq();
             size_t id1 = (*contigs)[i]->id();
             size_t rc_id1 = (*contigs)[i]->rc_id();
-            auto contigs_for_processing = path_index_.GetPathsIntersectedWith(path1);
+            auto contigs_for_processing = path_index_.GetPathsIntersectedWith(contig_paths[i]);
             for(auto it = contigs_for_processing.begin(); it != contigs_for_processing.end(); it++){
                 size_t j = *it;
                 size_t id2 = (*contigs)[j]->id();
@@ -390,86 +391,92 @@ public:
                         processed_pairs.end());
                 if(need_process){
                     processed_pairs.insert(pair<int, int>(id1, id2));
-                    auto path2 = (*contigs)[j]->path_seq();
-                    auto lcs_res = lcs_calc.LCS(seqs[i], seqs[j]);
-                    vector<size_t> pos1, pos2;
-                    auto pos_vectors_pair = GetBestPosVectors(lcs_calc, path1, seqs[i], path2, seqs[j], lcs_res);
-                    pos1 = pos_vectors_pair.first;
-                    pos2 = pos_vectors_pair.second;
-
-                    {
-                        TRACE("--------------------------------");
-                        size_t id_i = id1, id_j = id2;
-                        TRACE("Indexes " << i << " " << j );
-                        TRACE("IDs " << id_i << " " << id_j);
-                        TRACE("LCS string : " << VerticesVectorToString(g_, lcs_res));
-                        TRACE("Path1. " << SimplePathWithVerticesToString(g_, path1));
-                        TRACE("Pos1. "  << VectorToString<size_t>(pos1));
-                        TRACE("Path2. " << SimplePathWithVerticesToString(g_, path2));
-                        TRACE("Pos2. "  << VectorToString<size_t>(pos2));
-                    }
+                    candidate_pairs.push_back(make_pair(i, j));
+                }
+            }
+        }
+        vector<PairAlignment> alignments = AlignPairs(contig_paths, seqs, candidate_pairs);
 
-                    // Overlapping
-                    auto overlap_result = ArePathsOverlapped(path1, pos1, path2, pos2);
-                    bool is_overlaped = overlap_result.first.correctness ||
-                            overlap_result.second.correctness;
+        for(size_t k = 0; k < candidate_pairs.size(); k++){
+            size_t i = candidate_pairs[k].first, j = candidate_pairs[k].second;
+            size_t id1 = (*contigs)[i]->id();
+            size_t id2 = (*contigs)[j]->id();
+            const vector<EdgeId> &path1 = contig_paths[i];
+            const vector<EdgeId> &path2 = contig_paths[j];
+            const vector<VertexId> &lcs_res = alignments[k].lcs;
+            vector<size_t> pos1 = alignments[k].pos1, pos2 = alignments[k].pos2;
+
+            {
+                TRACE("--------------------------------");
+                size_t id_i = id1, id_j = id2;
+                TRACE("Indexes " << i << " " << j );
+                TRACE("IDs " << id_i << " " << id_j);
+                TRACE("LCS string : " << VerticesVectorToString(g_, lcs_res));
+                TRACE("Path1. " << SimplePathWithVerticesToString(g_, path1));
+                TRACE("Pos1. "  << VectorToString<size_t>(pos1));
+                TRACE("Path2. " << SimplePathWithVerticesToString(g_, path2));
+                TRACE("Pos2. "  << VectorToString<size_t>(pos2));
+            }
 
-                    if(is_overlaped){
+            // Overlapping
+            auto overlap_result = ArePathsOverlapped(path1, pos1, path2, pos2);
+            bool is_overlaped = overlap_result.first.correctness ||
+                    overlap_result.second.correctness;
 
-                        size_t first_id, last_id;
-                        vector<EdgeId> first_path, last_path;
-                        vector<size_t> first_pos, last_pos;
+            if(is_overlaped){
 
-                        if(overlap_result.first.correctness && overlap_result.second.correctness){
-                            if(overlap_result.first.size < overlap_result.second.size){
-                                first_id = id2; last_id = id1;
-                            }
-                            else {
-                                first_id = id1; last_id = id2;
-                            }
-                        }
-                        else{
-                            if(overlap_result.first.correctness) {
-                                first_id = id2; last_id = id1;
-                            }
-                            else {
-                                first_id = id1; last_id = id2;
-                            }
-                        }
+                size_t first_id, last_id;
+                vector<EdgeId> first_path, last_path;
+                vector<size_t> first_pos, last_pos;
 
-                        first_path = (first_id == id1) ? path1 : path2;
-                        last_path = (last_id == id1) ? path1 : path2;
-                        first_pos = (first_id == id1) ? pos1 : pos2;
-                        last_pos = (last_id == id1) ? pos1 : pos2;
+                if(overlap_result.first.correctness && overlap_result.second.correctness){
+                    if(overlap_result.first.size < overlap_result.second.size){
+                        first_id = id2; last_id = id1;
+                    }
+                    else {
+                        first_id = id1; last_id = id2;
+                    }
+                }
+                else{
+                    if(overlap_result.first.correctness) {
+                        first_id = id2; last_id = id1;
+                    }
+                    else {
+                        first_id = id1; last_id = id2;
+                    }
+                }
 
-                        size_t rc_first_id = contigs->GetContigById(first_id)->rc_id();
-                        size_t rc_last_id = contigs->GetContigById(last_id)->rc_id();
+                first_path = (first_id == id1) ? path1 : path2;
+                last_path = (last_id == id1) ? path1 : path2;
+                first_pos = (first_id == id1) ? pos1 : pos2;
+                last_pos = (last_id == id1) ? pos1 : pos2;
 
-                        size_t lcs_len1 = GetLCSLengthByPath(path1, pos1);
-                        size_t lcs_len2 = GetLCSLengthByPath(path2, pos2);
+                size_t rc_first_id = contigs->GetContigById(first_id)->rc_id();
+                size_t rc_last_id = contigs->GetContigById(last_id)->rc_id();
 
-                        Range overlap_first(first_pos[0], first_pos[first_pos.size() - 1]);
-                        Range overlap_last(last_pos[0], last_pos[last_pos.size() - 1]);
+                size_t lcs_len1 = GetLCSLengthByPath(path1, pos1);
+                size_t lcs_len2 = GetLCSLengthByPath(path2, pos2);
 
-                        Range overlap_first_rc(first_path.size() - overlap_first.end_pos,
-                                first_path.size() - overlap_first.start_pos);
-                        Range overlap_last_rc(last_path.size() - overlap_last.end_pos,
-                                last_path.size() - overlap_last.start_pos);
+                Range overlap_first(first_pos[0], first_pos[first_pos.size() - 1]);
+                Range overlap_last(last_pos[0], last_pos[last_pos.size() - 1]);
 
-                        overlap_map.Add(
-                                OverlappedContigsMap::OverlappedKey(first_id, last_id, rc_first_id, rc_last_id),
-                                OverlappedContigsMap::OverlappedValue(overlap_first, overlap_last,
-                                        overlap_first_rc, overlap_last_rc, max<size_t>(lcs_len1, lcs_len2)));
+                Range overlap_first_rc(first_path.size() - overlap_first.end_pos,
+                        first_path.size() - overlap_first.start_pos);
+                Range overlap_last_rc(last_path.size() - overlap_last.end_pos,
+                        last_path.size() - overlap_last.start_pos);
 
-                        TRACE(first_id << " - " << last_id << ". " << overlap_first.start_pos << " - " <<
-                                overlap_first.end_pos << ", " << overlap_last.start_pos << " - " <<
-                                overlap_last.end_pos);
+                overlap_map.Add(
+                        OverlappedContigsMap::OverlappedKey(first_id, last_id, rc_first_id, rc_last_id),
+                        OverlappedContigsMap::OverlappedValue(overlap_first, overlap_last,
+                                overlap_first_rc, overlap_last_rc, max<size_t>(lcs_len1, lcs_len2)));
 
-                        TRACE(rc_last_id << " - " << rc_first_id << ". " << overlap_last_rc.start_pos << " - " <<
-                                overlap_last_rc.end_pos << ", " << overlap_first_rc.start_pos << " - " <<
-                                overlap_first_rc.end_pos);
-                    }
-                }
+                TRACE(first_id << " - " << last_id << ". " << overlap_first.start_pos << " - " <<
+                        overlap_first.end_pos << ", " << overlap_last.start_pos << " - " <<
+                        overlap_last.end_pos);
+
+                TRACE(rc_last_id << " - " << rc_first_id << ". " << overlap_last_rc.start_pos << " - " <<
+                        overlap_last_rc.end_pos << ", " << overlap_first_rc.start_pos << " - " <<
+                        overlap_first_rc.end_pos);
             }
         }
 
@@ -573,7 +573,7 @@ public:
         return error_num;
     }
 
-    pair<vector<size_t>, vector<size_t> > GetBestPosVectors(LCSCalculator<VertexId> & calc,
+    pair<vector<size_t>, vector<size_t> > GetBestPosVectors(const LCSCalculator<VertexId> & calc,
             vector<EdgeId> path1, vector<VertexId> vert_path1,
             vector<EdgeId> path2, vector<VertexId> vert_path2,
             vector<VertexId> lcs){
@@ -662,7 +662,7 @@ public:
         return pair<vector<size_t>, vector<size_t> >(best_vect1, best_vect2);
     }
 
-    vector<size_t> GetBestPosVector(LCSCalculator<VertexId> & calc, vector<EdgeId> path,
+    vector<size_t> GetBestPosVector(const LCSCalculator<VertexId> & calc, vector<EdgeId> path,
             vector<VertexId> vert_path, vector<VertexId> lcs){
 
         auto pos_right = calc.GetPosVector(vert_path, lcs);
@@ -677,6 +677,32 @@ public:
             return pos_right;
     }
 
+    struct PairAlignment {
+        vector<VertexId> lcs;
+        vector<size_t> pos1, pos2;
+    };
+
+    // LCS and the best position vectors for each pair of contig indices, pairs are independent
+    // and processed in parallel
+    vector<PairAlignment> AlignPairs(const vector<vector<EdgeId> > &paths,
+            const vector<vector<VertexId> > &seqs, const vector<pair<size_t, size_t> > &pairs){
+        LCSCalculator<VertexId> lcs_calc;
+        vector<PairAlignment> alignments(pairs.size());
+
+#       pragma omp parallel for schedule(dynamic)
+        for(size_t k = 0; k < pairs.size(); k++){
+            size_t i = pairs[k].first, j = pairs[k].second;
+            PairAlignment &alignment = alignments[k];
+            alignment.lcs = lcs_calc.LCS(seqs[i], seqs[j]);
+            auto pos_vectors_pair = GetBestPosVectors(lcs_calc, paths[i], seqs[i], paths[j], seqs[j],
+                    alignment.lcs);
+            alignment.pos1 = pos_vectors_pair.first;
+            alignment.pos2 = pos_vectors_pair.second;
+        }
+
+        return alignments;
+    }
+
     void InitializeMap(ContigStoragePtr contigs){
         for(size_t i = 0; i < contigs->Size(); i++){
             size_t id = (*contigs)[i]->id();
@@ -718,12 +744,11 @@ public:
 
         InitializeMap(contigs);
 
-        LCSCalculator<VertexId> lcs_calc;
-
+        vector<vector<EdgeId> > contig_paths;
         vector<vector<VertexId> > seqs;
         for(size_t i = 0; i < contigs->Size(); i++){
-            vector<VertexId> seq = GetListOfVertices((*contigs)[i]->path_seq());
-            seqs.push_back(seq);
+            contig_paths.push_back((*contigs)[i]->path_seq());
+            seqs.push_back(GetListOfVertices(contig_paths.back()));
         }
 
         set<size_t> processed_contigs;
@@ -743,28 +768,33 @@ public:
             if(processed_contigs.find(rc_id_i) == processed_contigs.end() &&
                     absolutely_redundant.find(i) == absolutely_redundant.end()){
 
-                vector<EdgeId> path1 = (*contigs)[i]->path_seq();
+                const vector<EdgeId> &path1 = contig_paths[i];
                 set<int> analyzed_contigs;
 
+                // alignments are computed in advance for all the candidates,
+                // the ones found absolutely redundant meanwhile are skipped below
                 auto contigs_for_analyze = path_index_.GetPathsIntersectedWith(path1);
+                vector<pair<size_t, size_t> > candidate_pairs;
                 for(auto it = contigs_for_analyze.begin(); it != contigs_for_analyze.end(); it++){
-
                     size_t j = *it;
+                    bool need_process = !((i % 2 == 0 && i + 1 == j) || j <= i);
+                    if(need_process && absolutely_redundant.find(j) == absolutely_redundant.end())
+                        candidate_pairs.push_back(make_pair(i, j));
+                }
+                vector<PairAlignment> alignments = AlignPairs(contig_paths, seqs, candidate_pairs);
+
+                for(size_t k = 0; k < candidate_pairs.size(); k++){
+
+                    size_t j = candidate_pairs[k].second;
                     size_t id_j = (*contigs)[j]->id();
                     size_t rc_id_j = (*contigs)[j]->rc_id();
 
-                    bool need_process = !((i % 2 == 0 && i + 1 == j) || j <= i);
-                    need_process = need_process &&
-                            absolutely_redundant.find(j) == absolutely_redundant.end();
+                    bool need_process = absolutely_redundant.find(j) == absolutely_redundant.end();
                     if(need_process){
 
-                        vector<EdgeId> path2 = (*contigs)[j]->path_seq();
-                        vector<VertexId> lcs_res = lcs_calc.LCS(seqs[i], seqs[j]);
-                        vector<size_t> pos1, pos2;
-
-                        auto pos_vectors_pair = GetBestPosVectors(lcs_calc, path1, seqs[i], path2, seqs[j], lcs_res);
-                        pos1 = pos_vectors_pair.first;
-                        pos2 = pos_vectors_pair.second;
+                        const vector<EdgeId> &path2 = contig_paths[j];
+                        const vector<VertexId> &lcs_res = alignments[k].lcs;
+                        vector<size_t> pos1 = alignments[k].pos1, pos2 = alignments[k].pos2;
 
                         {
                             TRACE("--------------------------------");
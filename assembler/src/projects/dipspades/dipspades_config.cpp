@@ -9,6 +9,7 @@
 #include "pipeline/config_common.hpp"
 #include "utils/files_utils.hpp"
 #include "utils/path_helper.hpp"
+#include "utils/openmp_wrapper.h"
 
 using namespace dipspades;
 
@@ -18,6 +19,10 @@ void load(dipspades_config::base_params &bp,
     load(bp.K                    , pt,    "K"                        );
     load(bp.max_memory            , pt,    "max_memory"            );
     load(bp.max_threads            , pt,     "max_threads"            );
+    // Fix number of threads according to OMP capabilities.
+    bp.max_threads = std::min(bp.max_threads, (size_t) omp_get_max_threads());
+    // Inform OpenMP runtime about this
+    omp_set_num_threads((int) bp.max_threads);
     load(bp.read_buffer_size     , pt,     "read_buffer_size"        );
 }
 
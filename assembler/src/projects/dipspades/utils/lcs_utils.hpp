@@ -7,104 +7,122 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <map>
 #include <vector>
 #include <string>
-#include <memory.h>
 
 using namespace std;
 
 namespace dipspades {
 
+/*
+ * LCS of two sequences over an arbitrary alphabet. Rows of the DP table are
+ * computed bit-parallel (Crochemore et al., "A fast and practical bit-vector
+ * algorithm for the longest common subsequence problem"): row j is encoded by
+ * the bit vector V_j over the positions of the first sequence, and
+ * L[i][j] equals the number of zero bits among the first i bits of V_j.
+ * The calculator has no state, so one instance could be shared between threads.
+ */
 template<class T>
 class LCSCalculator{
+    typedef uint64_t Word;
+    static const size_t WORD_BITS = 64;
 
-    int ** mask;
+    class BitTable {
+        size_t words_;
+        // (length2 + 1) rows of words_ words
+        vector<Word> rows_;
 
-    void Initialize(size_t length1, size_t length2){
-        mask = new int*[length1 + 1];
-        for(size_t i = 0; i < length1 + 1; i++){
-            mask[i] = new int[length2 + 1];
-            memset(mask[i], 0, sizeof(int) * (length2 + 1));
-        }
-    }
-
-    void Terminate(size_t length){
-        for(size_t i = 0; i < length + 1; i++)
-            delete[] mask[i];
-        delete[] mask;
-    }
+    public:
+        BitTable(size_t length1, size_t length2) :
+                words_((length1 + WORD_BITS - 1) / WORD_BITS),
+                rows_(words_ * (length2 + 1), ~Word(0)) { }
 
-    void RecursiveLCSLenCalc(vector<T> str1, vector<T> str2, size_t i1, size_t i2){
+        Word *row(size_t j) {
+            return rows_.data() + j * words_;
+        }
 
-//        cout << i1 << " - " << i2 << "; " << str1[i1 - 1] << " - " << str2[i2 - 1] << "; ";
+        size_t words() const {
+            return words_;
+        }
 
-        if(str1[i1 - 1] == str2[i2 - 1]){
-//            cout << "1st case; ";
-            mask[i1][i2] = mask[i1 - 1][i2 - 1] + 1;
+        // L[i][j]
+        size_t Value(size_t i, size_t j) const {
+            const Word *row = rows_.data() + j * words_;
+            size_t ones = 0;
+            for(size_t w = 0; w < i / WORD_BITS; w++)
+                ones += __builtin_popcountll(row[w]);
+            if(i % WORD_BITS != 0)
+                ones += __builtin_popcountll(row[i / WORD_BITS] & ((Word(1) << (i % WORD_BITS)) - 1));
+            return i - ones;
         }
-        else{
+    };
 
-//            cout << "2nd case; ";
-            int res1 = mask[i1][i2 - 1];
-            int res2 = mask[i1 - 1][i2];
+    void FillTable(const vector<T> &str1, const vector<T> &str2, BitTable &table) const {
+        size_t words = table.words();
 
-            mask[i1][i2] = max<int>(res1, res2);
+        map<T, vector<Word> > masks;
+        for(size_t i = 0; i < str1.size(); i++){
+            vector<Word> &mask = masks[str1[i]];
+            if(mask.empty())
+                mask.resize(words, 0);
+            mask[i / WORD_BITS] |= Word(1) << (i % WORD_BITS);
         }
-    }
-
-    int LCSLengthCalculation(vector<T> str1, vector<T> str2){
 
-        for(size_t i = 1; i <= str1.size(); i++)
-            for(size_t j = 1; j <= str2.size(); j++){
-                RecursiveLCSLenCalc(str1, str2, i, j);
+        for(size_t j = 1; j <= str2.size(); j++){
+            const Word *v = table.row(j - 1);
+            Word *next = table.row(j);
+            auto it = masks.find(str2[j - 1]);
+            if(it == masks.end()){
+                copy(v, v + words, next);
+                continue;
             }
 
-        return mask[str1.size()][str2.size()];
-    }
-
-    vector<T> RecursiveRestoreLCS(vector<T> str1, vector<T> str2,
-            size_t i, size_t j){
-        vector<T> res;
-        if(i == 0 || j == 0){
-            return res;
-        }
-
-        if(str1[i - 1] == str2[j - 1]){
-            res = RecursiveRestoreLCS(str1, str2, i - 1, j - 1);
-            res.push_back(str1[i - 1]);
-            return res;
+            // V' = (V + (V & M)) | (V & ~M)
+            const Word *m = it->second.data();
+            Word carry = 0;
+            for(size_t w = 0; w < words; w++){
+                Word u = v[w] & m[w];
+                Word sum = v[w] + u;
+                Word new_carry = sum < v[w];
+                sum += carry;
+                new_carry |= sum < carry;
+                carry = new_carry;
+                next[w] = sum | (v[w] & ~m[w]);
+            }
         }
-
-        if(mask[i][j - 1] > mask[i - 1][j])
-            return RecursiveRestoreLCS(str1, str2, i, j - 1);
-        else
-            return RecursiveRestoreLCS(str1, str2, i - 1, j);
-    }
-
-    vector<T> RestoreLCS(vector<T> string1, vector<T> string2, size_t){
-
-//        cout << "LCS string length - " << lcs_length << endl;
-        vector<T> lcs = RecursiveRestoreLCS(string1, string2, string1.size(), string2.size());
-        return lcs;
     }
 
 public:
 
-    vector<T> LCS(vector<T> string1, vector<T> string2){
+    vector<T> LCS(const vector<T> &string1, const vector<T> &string2) const {
         vector<T> res;
         if(string1.size() == 0 || string2.size() == 0)
             return res;
 
-        Initialize(string1.size(), string2.size());
-
-        int lcs_length = LCSLengthCalculation(string1, string2);
-        res = RestoreLCS(string1, string2, lcs_length);
-        Terminate(string1.size());
+        BitTable table(string1.size(), string2.size());
+        FillTable(string1, string2, table);
 
+        // the same traceback as for the plain DP table
+        size_t i = string1.size(), j = string2.size();
+        while(i > 0 && j > 0){
+            if(string1[i - 1] == string2[j - 1]){
+                res.push_back(string1[i - 1]);
+                i--;
+                j--;
+            }
+            else if(table.Value(i, j - 1) > table.Value(i - 1, j))
+                j--;
+            else
+                i--;
+        }
+        reverse(res.begin(), res.end());
         return res;
     }
 
-    vector<size_t> GetPosVectorFromLeft(vector<T> string, vector<T> lcs){
+    vector<size_t> GetPosVectorFromLeft(const vector<T> &string, const vector<T> &lcs) const {
         vector<size_t> pos;
 
         if(string.size() == 0 || lcs.size() == 0)
@@ -124,7 +142,7 @@ public:
         return pos;
     }
 
-    vector<size_t> GetPosVector(vector<T> string, vector<T> lcs){
+    vector<size_t> GetPosVector(const vector<T> &string, const vector<T> &lcs) const {
         vector<size_t> pos;
         if(string.size() == 0 || lcs.size() == 0)
             return pos;
@@ -133,9 +151,10 @@ public:
         int str_size = int(string.size());
         for(int i = str_size - 1; i >= 0 && lcs_ind >= 0; i--)
             if(string[i] == lcs[lcs_ind]){
-                pos.insert(pos.begin(), size_t(i));
+                pos.push_back(size_t(i));
                 lcs_ind--;
             }
+        reverse(pos.begin(), pos.end());
 
         VERIFY(pos.size() == lcs.size());
 
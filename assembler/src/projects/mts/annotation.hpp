@@ -82,13 +82,34 @@ public:
 };
 
 class EdgeAnnotation {
+    struct EdgeLabel {
+        EdgeId edge;
+        //Sorted without duplicates
+        vector<bin_id> bins;
+    };
+
     const conj_graph_pack& gp_;
     set<bin_id> bins_of_interest_;
-    map<EdgeId, set<bin_id>> edge_annotation_;
+    //Indexed by the edge int ids
+    vector<EdgeLabel> edge_annotation_;
+    size_t annotated_cnt_;
 
     template<class BinCollection>
     void InnerStickAnnotation(EdgeId e, const BinCollection& bins) {
-        edge_annotation_[e].insert(bins.begin(), bins.end());
+        if (bins.begin() == bins.end())
+            return;
+        if (e.int_id() >= edge_annotation_.size())
+            edge_annotation_.resize(e.int_id() + 1);
+        EdgeLabel& label = edge_annotation_[e.int_id()];
+        if (label.bins.empty()) {
+            label.edge = e;
+            ++annotated_cnt_;
+        }
+        size_t old_size = label.bins.size();
+        label.bins.insert(label.bins.end(), bins.begin(), bins.end());
+        std::sort(label.bins.begin() + old_size, label.bins.end());
+        std::inplace_merge(label.bins.begin(), label.bins.begin() + old_size, label.bins.end());
+        label.bins.erase(std::unique(label.bins.begin(), label.bins.end()), label.bins.end());
     }
 
 public:
@@ -96,7 +117,8 @@ public:
     EdgeAnnotation(const conj_graph_pack& gp,
                    const set<bin_id>& bins_of_interest) :
                        gp_(gp),
-                       bins_of_interest_(bins_of_interest)
+                       bins_of_interest_(bins_of_interest),
+                       annotated_cnt_(0)
     {
     }
 
@@ -118,11 +140,10 @@ public:
     }
 
     vector<bin_id> Annotation(EdgeId e) const {
-        if (!edge_annotation_.count(e)) {
+        if (e.int_id() >= edge_annotation_.size()) {
             return {};
         }
-        const auto& annotation = get(edge_annotation_, e);
-        return vector<bin_id>(annotation.begin(), annotation.end());
+        return edge_annotation_[e.int_id()].bins;
     }
 
     set<bin_id> RelevantBins(const vector<EdgeId>& path) const {
@@ -133,19 +154,26 @@ public:
         return answer;
     }
 
-    set<EdgeId> EdgesOfBin(bin_id bin, size_t min_length = 0) const {
-        set<EdgeId> answer;
-        for (auto ann_pair : edge_annotation_) {
-            if (ann_pair.second.count(bin) &&
-                    gp_.g.length(ann_pair.first) > min_length) {
-                answer.insert(ann_pair.first);
+    //Edges longer than min_length of every interesting bin in one pass, sorted
+    map<bin_id, vector<EdgeId>> EdgesOfBins(size_t min_length = 0) const {
+        map<bin_id, vector<EdgeId>> answer;
+        for (const bin_id& bin : bins_of_interest_) {
+            answer[bin];
+        }
+        for (const EdgeLabel& label : edge_annotation_) {
+            if (label.bins.empty() || gp_.g.length(label.edge) <= min_length)
+                continue;
+            for (const bin_id& bin : label.bins) {
+                auto it = answer.find(bin);
+                if (it != answer.end())
+                    it->second.push_back(label.edge);
             }
         }
         return answer;
     }
 
     size_t size() const {
-        return edge_annotation_.size();
+        return annotated_cnt_;
     }
 
     const set<bin_id>& interesting_bins() const {
@@ -13,27 +13,24 @@ size_t SampleCount() {
     return sample_cnt_;
 }
 
-MplVector SingleClusterAnalyzer::SampleMpls(const KmerProfiles& kmer_mpls, size_t sample) const {
-    MplVector answer;
-    answer.reserve(kmer_mpls.size());
-    for (const auto& kmer_mpl : kmer_mpls) {
-        answer.push_back(kmer_mpl[sample]);
+MplVector SingleClusterAnalyzer::MedianVector(const KmerProfiles& kmer_mpls, MplVector& sample_mpls) const {
+    VERIFY(kmer_mpls.size() != 0);
+    const size_t sample_cnt = SampleCount(), kmer_cnt = kmer_mpls.size();
+
+    //Transpose the profiles once, so that the selection runs over contiguous blocks
+    sample_mpls.resize(sample_cnt * kmer_cnt);
+    for (size_t j = 0; j < kmer_cnt; ++j) {
+        const Mpl* kmer_mpl = kmer_mpls[j].begin();
+        for (size_t i = 0; i < sample_cnt; ++i) {
+            sample_mpls[i * kmer_cnt + j] = kmer_mpl[i];
+        }
     }
-    return answer;
-}
 
-Mpl SingleClusterAnalyzer::SampleMedian(const KmerProfiles& kmer_mpls, size_t sample) const {
-    std::vector<Mpl> sample_mpls = SampleMpls(kmer_mpls, sample);
-
-    std::nth_element(sample_mpls.begin(), sample_mpls.begin() + sample_mpls.size()/2, sample_mpls.end());
-    return sample_mpls[sample_mpls.size()/2];
-}
-
-MplVector SingleClusterAnalyzer::MedianVector(const KmerProfiles& kmer_mpls) const {
-    VERIFY(kmer_mpls.size() != 0);
-    MplVector answer(SampleCount(), 0);
-    for (size_t i = 0; i < SampleCount(); ++i) {
-        answer[i] = SampleMedian(kmer_mpls, i);
+    MplVector answer(sample_cnt, 0);
+    for (size_t i = 0; i < sample_cnt; ++i) {
+        auto begin = sample_mpls.begin() + i * kmer_cnt;
+        std::nth_element(begin, begin + kmer_cnt/2, begin + kmer_cnt);
+        answer[i] = begin[kmer_cnt/2];
     }
     return answer;
 }
@@ -66,8 +63,9 @@ KmerProfiles SingleClusterAnalyzer::CloseKmerMpls(const KmerProfiles& kmer_mpls,
     return answer;
 }
 
-boost::optional<AbundanceVector> SingleClusterAnalyzer::operator()(const KmerProfiles& kmer_mpls) const {
-    auto med = MedianVector(kmer_mpls);
+boost::optional<AbundanceVector> SingleClusterAnalyzer::operator()(const KmerProfiles& kmer_mpls,
+                                                                   MplVector& sample_mpls) const {
+    auto med = MedianVector(kmer_mpls, sample_mpls);
     return AbundanceVector(med.begin(), med.end());
     //return boost::optional<AbundanceVector>(answer);
     //MplVector center = MedianVector(kmer_mpls);
@@ -130,12 +128,15 @@ void ContigAbundanceCounter::Init(const std::string& file_prefix) {
     mpl_data_.resize(data_size);
     std::ifstream mpls_in(file_prefix + ".bpr", std::ios::binary);
     mpls_in.read((char *)&mpl_data_[0], data_size * sizeof(Mpl));
+    VERIFY_MSG(mpls_in.gcount() == std::streamsize(data_size * sizeof(Mpl)),
+               "Kmer profiles in " << file_prefix << ".bpr do not match the index");
 }
 
 boost::optional<AbundanceVector> ContigAbundanceCounter::operator()(
         const std::string& s,
-        const std::string& /*name*/) const {
-    KmerProfiles kmer_mpls;
+        AbundanceBuffer& buffer) const {
+    KmerProfiles& kmer_mpls = buffer.kmer_mpls;
+    kmer_mpls.clear();
 
     for (const auto& seq : SplitOnNs(s)) {
         if (seq.size() < k_)
@@ -170,7 +171,7 @@ boost::optional<AbundanceVector> ContigAbundanceCounter::operator()(
         return boost::none;
     }
 
-    return cluster_analyzer_(kmer_mpls);
+    return cluster_analyzer_(kmer_mpls, buffer.sample_mpls);
 }
 
 }
@@ -51,6 +51,16 @@ private:
 
 typedef std::vector<KmerProfile> KmerProfiles;
 
+/**
+ * Scratch space of the abundance estimation, reused between the calls
+ * to avoid reallocations. Should not be shared between threads.
+ */
+struct AbundanceBuffer {
+    KmerProfiles kmer_mpls;
+    //Profiles transposed into contiguous per-sample blocks
+    MplVector sample_mpls;
+};
+
 template<class CovVecs>
 AbundanceVector MeanVector(const CovVecs& cov_vecs) {
     VERIFY(cov_vecs.size() != 0);
@@ -83,9 +93,7 @@ class SingleClusterAnalyzer {
     double coord_vise_proximity_;
     double central_clust_share_;
 
-    MplVector SampleMpls(const KmerProfiles& kmer_mpls, size_t sample) const;
-    Mpl SampleMedian(const KmerProfiles& kmer_mpls, size_t sample) const;
-    MplVector MedianVector(const KmerProfiles& kmer_mpls) const;
+    MplVector MedianVector(const KmerProfiles& kmer_mpls, MplVector& sample_mpls) const;
     bool AreClose(const KmerProfile& c, const KmerProfile& v) const;
     KmerProfiles CloseKmerMpls(const KmerProfiles& kmer_mpls, const KmerProfile& center) const;
 
@@ -96,7 +104,12 @@ public:
         central_clust_share_(central_clust_share) {
     }
 
-    boost::optional<AbundanceVector> operator()(const KmerProfiles& kmer_mpls) const;
+    boost::optional<AbundanceVector> operator()(const KmerProfiles& kmer_mpls, MplVector& sample_mpls) const;
+
+    boost::optional<AbundanceVector> operator()(const KmerProfiles& kmer_mpls) const {
+        MplVector sample_mpls;
+        return (*this)(kmer_mpls, sample_mpls);
+    }
 
 private:
     DECL_LOGGER("SingleClusterAnalyzer");
@@ -134,7 +147,15 @@ public:
 
     void Init(const std::string& kmer_mpl_file);
 
-    boost::optional<AbundanceVector> operator()(const std::string& s, const std::string& /*name*/ = "") const;
+    /**
+     * Thread-safe as long as every thread provides its own buffer.
+     */
+    boost::optional<AbundanceVector> operator()(const std::string& s, AbundanceBuffer& buffer) const;
+
+    boost::optional<AbundanceVector> operator()(const std::string& s, const std::string& /*name*/ = "") const {
+        AbundanceBuffer buffer;
+        return (*this)(s, buffer);
+    }
 
 private:
     DECL_LOGGER("ContigAbundanceCounter");
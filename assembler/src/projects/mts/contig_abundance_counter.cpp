@@ -2,6 +2,7 @@
 #include <string>
 #include <iostream>
 #include "getopt_pp/getopt_pp.h"
+#include "utils/openmp_wrapper.h"
 #include "io/reads/file_reader.hpp"
 #include "io/reads/osequencestream.hpp"
 #include "pipeline/graphio.hpp"
@@ -13,30 +14,54 @@ using namespace debruijn_graph;
 
 //Helper class to have scoped DEBUG()
 class Runner {
+    static const size_t split_length = 10000;
+    //Fragments are processed in batches to bound the memory
+    static const size_t batch_size = 4096;
+
+    static void SplitContig(const io::SingleRead& full_contig, size_t min_length_bound,
+                            std::vector<io::SingleRead>& fragments) {
+        DEBUG("Analyzing contig " << GetId(full_contig));
+
+        for (size_t i = 0; i < full_contig.size(); i += split_length) {
+            if (full_contig.size() - i < min_length_bound) {
+                DEBUG("Fragment shorter than min_length_bound " << min_length_bound);
+                break;
+            }
+
+            fragments.push_back(full_contig.Substr(i, std::min(i + split_length, full_contig.size())));
+            DEBUG("Processing fragment # " << (i / split_length) << " with id " << GetId(fragments.back()));
+        }
+    }
+
 public:
-    static void Run(ContigAbundanceCounter& abundance_counter, size_t min_length_bound,
+    static void Run(const ContigAbundanceCounter& abundance_counter, size_t min_length_bound, size_t nthreads,
                     io::FileReadStream& contigs_stream, io::osequencestream& splits_os,
-                    std::ofstream& id_out, std::ofstream& mpl_out) {
-        static const size_t split_length = 10000;
+                    std::ofstream& id_out, std::ofstream& mpl_out, std::ofstream& bin_out) {
+        std::vector<AbundanceBuffer> buffers(nthreads);
+        std::vector<io::SingleRead> fragments;
+        std::vector<boost::optional<AbundanceVector>> abundances;
+        MplVector profile(SampleCount());
         io::SingleRead full_contig;
         while (!contigs_stream.eof()) {
-            contigs_stream >> full_contig;
-            DEBUG("Analyzing contig " << GetId(full_contig));
+            fragments.clear();
+            while (!contigs_stream.eof() && fragments.size() < batch_size) {
+                contigs_stream >> full_contig;
+                SplitContig(full_contig, min_length_bound, fragments);
+            }
 
-            for (size_t i = 0; i < full_contig.size(); i += split_length) {
-                if (full_contig.size() - i < min_length_bound) {
-                    DEBUG("Fragment shorter than min_length_bound " << min_length_bound);
-                    break;
-                }
+            abundances.assign(fragments.size(), boost::none);
+#           pragma omp parallel for schedule(dynamic) num_threads((int) nthreads)
+            for (size_t i = 0; i < fragments.size(); ++i) {
+                abundances[i] = abundance_counter(fragments[i].GetSequenceString(),
+                                                  buffers[omp_get_thread_num()]);
+            }
 
-                io::SingleRead contig = full_contig.Substr(i, std::min(i + split_length, full_contig.size()));
+            for (size_t i = 0; i < fragments.size(); ++i) {
+                const io::SingleRead& contig = fragments[i];
                 splits_os << contig;
 
                 contig_id id = GetId(contig);
-                DEBUG("Processing fragment # " << (i / split_length) << " with id " << id);
-
-                auto abundance_vec = abundance_counter(contig.GetSequenceString(), contig.name());
-
+                const auto& abundance_vec = abundances[i];
                 if (abundance_vec) {
                     stringstream ss;
                     copy(abundance_vec->begin(), abundance_vec->end(),
@@ -45,6 +70,9 @@ public:
 
                     id_out << id << std::endl;
                     mpl_out << ss.str() << std::endl;
+
+                    std::copy(abundance_vec->begin(), abundance_vec->end(), profile.begin());
+                    bin_out.write((const char *) profile.data(), profile.size() * sizeof(Mpl));
                 } else {
                     DEBUG("Failed to estimate abundance of " << id);
                 }
@@ -59,7 +87,7 @@ int main(int argc, char** argv) {
     using namespace GetOpt;
 
     unsigned k;
-    size_t sample_cnt, min_length_bound;
+    size_t sample_cnt, min_length_bound, nthreads;
     std::string work_dir, contigs_path, splits_path;
     std::string kmer_mult_fn, contigs_abundance_fn;
 
@@ -73,11 +101,13 @@ int main(int argc, char** argv) {
             >> Option('n', sample_cnt)
             >> Option('m', kmer_mult_fn)
             >> Option('o', contigs_abundance_fn)
-            >> Option('l', min_length_bound, size_t(0));
+            >> Option('l', min_length_bound, size_t(0))
+            >> Option('t', nthreads, size_t(1));
     } catch(GetOptEx &ex) {
         std::cout << "Usage: contig_abundance_counter -k <K> -w <work_dir> -c <contigs path> "
                 "-n <sample cnt> -m <kmer multiplicities path> -f <splits_path> "
-                "-o <contigs abundance path> [-l <contig length bound> (default: 0)]"  << std::endl;
+                "-o <contigs abundance path> [-l <contig length bound> (default: 0)] "
+                "[-t <threads> (default: 1)]"  << std::endl;
         exit(1);
     }
 
@@ -93,9 +123,11 @@ int main(int argc, char** argv) {
 
     std::ofstream id_out(contigs_abundance_fn + ".id");
     std::ofstream mpl_out(contigs_abundance_fn + ".mpl");
+    //The same profiles as in .mpl, as a binary matrix of sample_cnt Mpl's per row
+    std::ofstream bin_out(contigs_abundance_fn + ".bpr", std::ios::binary);
 
-    Runner::Run(abundance_counter, min_length_bound,
+    Runner::Run(abundance_counter, min_length_bound, nthreads,
                 contigs_stream, splits_os,
-                id_out, mpl_out);
+                id_out, mpl_out, bin_out);
     return 0;
 }
@@ -6,12 +6,14 @@
 #include <iostream>
 #include <memory>
 #include <algorithm>
+#include <limits>
+#include <numeric>
 #include <libcxx/sort.hpp>
-#include <boost/optional/optional.hpp>
 #include "getopt_pp/getopt_pp.h"
 #include "kmc_api/kmc_file.h"
 //#include "omp.h"
 #include "io/kmers/mmapped_reader.hpp"
+#include "io/kmers/mmapped_writer.hpp"
 #include "utils/path_helper.hpp"
 #include "utils/simple_tools.hpp"
 #include "utils/indices/perfect_hash_map_builder.hpp"
@@ -21,122 +23,336 @@
 using std::string;
 using std::vector;
 
-const string KMER_PARSED_EXTENSION = ".bin";
-const string KMER_SORTED_EXTENSION = ".sorted";
+const string KMER_RUN_EXTENSION = ".run";
+//Key ranges per thread for the partitioned merge, evens out the skew of the ranges
+const size_t RANGES_PER_THREAD = 4;
 
-class KmerMultiplicityCounter {
+/**
+ * CKmerAPI with access to the packed representation: 2-bit symbols are stored
+ * from the most significant bits of the first word (after byte_alignment empty
+ * symbols), so word-wise comparison gives the lexicographic order.
+ */
+class RawKmer : public CKmerAPI {
+public:
+    RawKmer(uint32 length) : CKmerAPI(length) {}
 
-    size_t k_, sample_cnt_;
-    std::string file_prefix_;
+    const uint64 *data() const { return kmer_data; }
+    size_t rows() const { return no_of_rows; }
+    size_t alignment() const { return byte_alignment; }
+};
 
-    //TODO: get rid of intermediate .bin file
-    string ParseKmc(const string& filename) {
-        CKMCFile kmcFile;
-        kmcFile.OpenForListing(filename);
-        CKmerAPI kmer((unsigned int) k_);
+/**
+ * Sorted stream of (kmer, count) records of a single sample. Record is the
+ * packed kmer followed by the count word. Listing of KMC1 databases is already
+ * sorted and is streamed as is. KMC2 lists every signature bin separately, so its
+ * records are dumped into a temporary file and sorted in place first, such a
+ * run could also be read by key ranges (see RunRange).
+ */
+class SampleKmerStream {
+    CKMCFile kmc_;
+    RawKmer kmer_;
+    size_t rows_;
+    std::unique_ptr<MMappedRecordArrayReader<uint64_t>> run_;
+    size_t run_pos_;
+    vector<uint64_t> record_;
+
+    bool ReadFromKmc() {
         uint32 count;
-        std::string parsed_filename = filename + KMER_PARSED_EXTENSION;
-        std::ofstream output(parsed_filename, std::ios::binary);
-        while (kmcFile.ReadNextKmer(kmer, count)) {
-            RtSeq seq(k_, kmer.to_string());
-            seq.BinWrite(output);
-            seq_element_type tmp = count;
-            output.write((char*) &(tmp), sizeof(seq_element_type));
+        if (!kmc_.ReadNextKmer(kmer_, count))
+            return false;
+        std::copy(kmer_.data(), kmer_.data() + rows_, record_.begin());
+        record_[rows_] = count;
+        return true;
+    }
+
+    void SortIntoRun(const string& run_filename) {
+        size_t kmer_cnt = kmc_.KmerCount();
+        {
+            MMappedRecordArrayWriter<uint64_t> run(run_filename, rows_ + 1);
+            run.reserve(kmer_cnt);
+            size_t read = 0;
+            for (; ReadFromKmc(); ++read) {
+                VERIFY(read < kmer_cnt);
+                run.write(record_.data(), 1);
+            }
+            VERIFY(read == kmer_cnt);
+            libcxx::sort(run.begin(), run.end(), array_less<uint64_t>());
         }
-        output.close();
-        return parsed_filename;
+        kmc_.Close();
+        run_.reset(new MMappedRecordArrayReader<uint64_t>(run_filename, rows_ + 1, /*unlink*/ true));
+        run_pos_ = 0;
     }
 
-    string SortKmersCountFile(const string& filename) {
-        MMappedRecordArrayReader<seq_element_type> ins(filename, RtSeq::GetDataSize(k_) + 1, false);
-        libcxx::sort(ins.begin(), ins.end(), array_less<seq_element_type>());
-        std::string sorted_filename = filename + KMER_SORTED_EXTENSION;
-        std::ofstream out(sorted_filename);
-        out.write((char*) ins.data(), ins.data_size());
-        out.close();
-        remove(filename.c_str());
-        return sorted_filename;
+public:
+    SampleKmerStream(const string& filename, size_t k)
+            : kmer_((uint32) k), rows_(kmer_.rows()), run_pos_(0), record_(rows_ + 1) {
+        if (!kmc_.OpenForListing(filename))
+            FATAL_ERROR("Failed to open KMC database " << filename);
+        uint32 kmer_length, mode, counter_size, lut_prefix_length, signature_len, min_count, max_count;
+        uint64 total_kmers;
+        kmc_.Info(kmer_length, mode, counter_size, lut_prefix_length, signature_len, min_count, max_count, total_kmers);
+        VERIFY_MSG(kmer_length == k, "KMC database " << filename << " is built for k=" << kmer_length);
+        //For KMC1 there is no signature
+        if (signature_len != 0)
+            SortIntoRun(filename + KMER_RUN_EXTENSION);
     }
 
-    bool ReadKmerWithCount(std::ifstream& infile, std::pair<RtSeq, uint32>& res) {
-        RtSeq seq(res.first.size());
-        if (!seq.BinRead(infile)) {
+    size_t rows() const {
+        return rows_;
+    }
+
+    size_t alignment() const {
+        return kmer_.alignment();
+    }
+
+    /**
+     * Advances to the next record, should be called once before the first access.
+     * @return false at the end of the stream
+     */
+    bool Next() {
+        if (!run_)
+            return ReadFromKmc();
+        if (run_pos_ == run_->size())
             return false;
-        }
-        seq_element_type tmp;
-        infile.read((char*) &tmp, sizeof(seq_element_type));
-        res = {seq, (uint32) tmp};
+        const uint64_t *record = &(*run_)[run_pos_++];
+        std::copy(record, record + rows_ + 1, record_.begin());
         return true;
     }
 
-    void FilterCombinedKmers(const std::vector<string>& files, size_t all_min) {
-        size_t n = files.size();
-        vector<std::unique_ptr<ifstream>> infiles;
-        infiles.reserve(n);
-        for (auto fn : files) {
-            INFO("Processing " << fn);
-            auto parsed = ParseKmc(fn);
-            auto sorted = SortKmersCountFile(parsed);
-            infiles.emplace_back(new std::ifstream(sorted));
-        }
-        vector<std::pair<RtSeq, uint32>> top_kmer(n, {RtSeq(k_), 0});
-        vector<bool> alive(n, false);
+    const uint64_t *kmer() const {
+        return record_.data();
+    }
+
+    uint32 count() const {
+        return (uint32) record_[rows_];
+    }
 
-        for (size_t i = 0; i < n; i++) {
-            alive[i] = ReadKmerWithCount(*infiles[i], top_kmer[i]);
+    bool seekable() const {
+        return (bool) run_;
+    }
+
+    size_t size() const {
+        return run_->size();
+    }
+
+    const uint64_t *record(size_t pos) const {
+        return &(*run_)[pos];
+    }
+
+    //Position of the first record which kmer starts with the word not less than first_word
+    size_t LowerBound(uint64_t first_word) const {
+        size_t lo = 0, hi = size();
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (*record(mid) < first_word)
+                lo = mid + 1;
+            else
+                hi = mid;
         }
+        return lo;
+    }
+};
 
-        std::ofstream output_kmer(file_prefix_ + ".kmer", std::ios::binary);
-        std::ofstream output_cnt(file_prefix_ + ".mpl");
+/**
+ * Records [begin, end) of the sorted run of the sample, the ranges of the same
+ * run could be read concurrently.
+ */
+class RunRange {
+    const SampleKmerStream *stream_;
+    size_t pos_, end_;
+    const uint64_t *record_;
 
-        RtSeq::less3 kmer_less;
-        while (true) {
-            boost::optional<RtSeq> min_kmer;
+public:
+    RunRange(const SampleKmerStream &stream, size_t begin, size_t end)
+            : stream_(&stream), pos_(begin), end_(end), record_(nullptr) {}
+
+    bool Next() {
+        if (pos_ == end_)
+            return false;
+        record_ = stream_->record(pos_++);
+        return true;
+    }
+
+    const uint64_t *kmer() const {
+        return record_;
+    }
+
+    uint32 count() const {
+        return (uint32) record_[stream_->rows()];
+    }
+};
+
+class KmerMultiplicityCounter {
+    //TODO: extract into a common header
+    typedef size_t Offset;
+    typedef uint16_t Mpl;
+
+    size_t k_, sample_cnt_;
+    std::string file_prefix_;
+
+    static bool KmerLess(const uint64_t *a, const uint64_t *b, size_t rows) {
+        for (size_t i = 0; i < rows; ++i)
+            if (a[i] != b[i])
+                return a[i] < b[i];
+        return false;
+    }
+
+    RtSeq ToSeq(const uint64_t *kmer, size_t alignment) const {
+        std::vector<seq_element_type> data(RtSeq::GetDataSize(k_), 0);
+        const size_t SymbolsPerWord = 32;
+        for (size_t i = 0; i < k_; ++i) {
+            size_t pos = i + alignment;
+            seq_element_type symbol = (kmer[pos / SymbolsPerWord] >> (62 - 2 * (pos % SymbolsPerWord))) & 3;
+            data[i / SymbolsPerWord] |= symbol << (2 * (i % SymbolsPerWord));
+        }
+        return RtSeq(k_, data.data());
+    }
+
+    /**
+     * N-way merge of the sorted samples (SampleKmerStream or RunRange). Kmers present
+     * in at least all_min samples are written into output_kmer, their profiles
+     * (a row of sample_cnt Mpl's for every kmer in the same order) into output_mpl.
+     * @return the number of kmers written
+     */
+    template<class Stream>
+    size_t MergeSamples(const vector<Stream*>& streams, size_t rows, size_t alignment, size_t all_min,
+                        std::ostream& output_kmer, std::ostream& output_mpl) const {
+        size_t n = streams.size();
+        auto greater = [&](size_t a, size_t b) {
+            return KmerLess(streams[b]->kmer(), streams[a]->kmer(), rows);
+        };
+
+        //Min-heap of the samples by their current kmers
+        vector<size_t> heap;
+        for (size_t i = 0; i < n; ++i) {
+            if (streams[i]->Next())
+                heap.push_back(i);
+        }
+        std::make_heap(heap.begin(), heap.end(), greater);
+
+        vector<uint64_t> min_kmer(rows);
+        vector<Mpl> profile(n);
+        size_t kmer_cnt = 0;
+        while (!heap.empty()) {
+            const uint64_t *top = streams[heap.front()]->kmer();
+            std::copy(top, top + rows, min_kmer.begin());
+            std::fill(profile.begin(), profile.end(), 0);
             size_t cnt_min = 0;
-            for (size_t i = 0; i < n; ++i) {
-                if (alive[i]) {
-                    RtSeq& cur_kmer = top_kmer[i].first;
-                    if (!min_kmer || kmer_less(cur_kmer, *min_kmer)) {
-                        min_kmer = cur_kmer;
-                        cnt_min = 0;
-                    }
-                    if (cur_kmer == *min_kmer) {
-                        cnt_min++;
-                    }
+            while (!heap.empty() &&
+                   std::equal(min_kmer.begin(), min_kmer.end(), streams[heap.front()]->kmer())) {
+                std::pop_heap(heap.begin(), heap.end(), greater);
+                size_t i = heap.back();
+                profile[i] = (Mpl) std::min<uint32>(streams[i]->count(), std::numeric_limits<Mpl>::max());
+                cnt_min++;
+                if (streams[i]->Next()) {
+                    std::push_heap(heap.begin(), heap.end(), greater);
+                } else {
+                    heap.pop_back();
                 }
             }
-            if (!min_kmer) {
-                break;
-            }
             if (cnt_min >= all_min) {
-                std::vector<uint32> cnt_vector(n, 0);
-                min_kmer.get().BinWrite(output_kmer);
-                for (size_t i = 0; i < n; ++i) {
-                    if (alive[i] && top_kmer[i].first == *min_kmer) {
-                        cnt_vector[i] += top_kmer[i].second;
-                    }
-                }
-                string delim = "";
-                for (auto cnt : cnt_vector) {
-                    output_cnt << delim << cnt;
-                    delim = " ";
-                }
-                output_cnt << std::endl;
+                ToSeq(min_kmer.data(), alignment).BinWrite(output_kmer);
+                output_mpl.write((const char *) profile.data(), profile.size() * sizeof(Mpl));
+                ++kmer_cnt;
             }
-            for (size_t i = 0; i < n; ++i) {
-                if (alive[i] && top_kmer[i].first == *min_kmer) {
-                    alive[i] = ReadKmerWithCount(*infiles[i], top_kmer[i]);
-                }
+        }
+        return kmer_cnt;
+    }
+
+    /**
+     * Splits the key space by the first kmer word at the quantiles of the largest
+     * sample, so that all the occurrences of a kmer fall into the same range.
+     * @return the first words of the ranges except the first one
+     */
+    vector<uint64_t> RangeBounds(const vector<std::unique_ptr<SampleKmerStream>>& streams, size_t range_cnt) const {
+        const SampleKmerStream *largest = streams.front().get();
+        for (const auto& stream : streams) {
+            if (stream->size() > largest->size())
+                largest = stream.get();
+        }
+        vector<uint64_t> bounds;
+        for (size_t i = 1; i < range_cnt; ++i) {
+            size_t pos = i * largest->size() / range_cnt;
+            if (pos == 0 || pos == largest->size())
+                continue;
+            uint64_t word = *largest->record(pos);
+            if (bounds.empty() || bounds.back() < word)
+                bounds.push_back(word);
+        }
+        return bounds;
+    }
+
+    void AppendChunk(const string& chunk_filename, std::ofstream& output) const {
+        {
+            std::ifstream chunk(chunk_filename, std::ios::binary);
+            if (chunk.peek() != std::ifstream::traits_type::eof())
+                output << chunk.rdbuf();
+        }
+        path::remove_if_exists(chunk_filename);
+    }
+
+    /**
+     * Merges the samples into <prefix>.kmer and <prefix>.bpr. KMC2 runs are split
+     * into key ranges merged in parallel, each into its own chunk of the output;
+     * the chunks are concatenated in the order of the ranges. KMC1 listing cannot
+     * seek, so its samples are merged sequentially.
+     * @return the number of kmers written
+     */
+    size_t FilterCombinedKmers(const std::vector<string>& files, size_t all_min, size_t nthreads) {
+        size_t n = files.size();
+        vector<std::unique_ptr<SampleKmerStream>> streams(n);
+#       pragma omp parallel for schedule(dynamic) num_threads((int) nthreads)
+        for (size_t i = 0; i < n; ++i) {
+            INFO("Processing " << files[i]);
+            streams[i].reset(new SampleKmerStream(files[i], k_));
+        }
+
+        size_t rows = streams.front()->rows();
+        size_t alignment = streams.front()->alignment();
+
+        std::ofstream output_kmer(file_prefix_ + ".kmer", std::ios::binary);
+        std::ofstream output_mpl(file_prefix_ + ".bpr", std::ios::binary);
+
+        bool seekable = std::all_of(streams.begin(), streams.end(),
+                                    [](const std::unique_ptr<SampleKmerStream>& stream) { return stream->seekable(); });
+        if (nthreads == 1 || !seekable) {
+            vector<SampleKmerStream*> samples;
+            for (const auto& stream : streams)
+                samples.push_back(stream.get());
+            return MergeSamples(samples, rows, alignment, all_min, output_kmer, output_mpl);
+        }
+
+        vector<uint64_t> bounds = RangeBounds(streams, nthreads * RANGES_PER_THREAD);
+        size_t range_cnt = bounds.size() + 1;
+        INFO("Merging samples in " << range_cnt << " key ranges");
+        vector<size_t> kmer_cnts(range_cnt, 0);
+#       pragma omp parallel for schedule(dynamic) num_threads((int) nthreads)
+        for (size_t r = 0; r < range_cnt; ++r) {
+            vector<RunRange> ranges;
+            for (const auto& stream : streams) {
+                size_t begin = (r == 0 ? 0 : stream->LowerBound(bounds[r - 1]));
+                size_t end = (r + 1 == range_cnt ? stream->size() : stream->LowerBound(bounds[r]));
+                ranges.emplace_back(*stream, begin, end);
             }
+            vector<RunRange*> samples;
+            for (auto& range : ranges)
+                samples.push_back(&range);
+
+            std::ofstream chunk_kmer(file_prefix_ + ".kmer." + ToString(r), std::ios::binary);
+            std::ofstream chunk_mpl(file_prefix_ + ".bpr." + ToString(r), std::ios::binary);
+            kmer_cnts[r] = MergeSamples(samples, rows, alignment, all_min, chunk_kmer, chunk_mpl);
+        }
+
+        for (size_t r = 0; r < range_cnt; ++r) {
+            AppendChunk(file_prefix_ + ".kmer." + ToString(r), output_kmer);
+            AppendChunk(file_prefix_ + ".bpr." + ToString(r), output_mpl);
         }
+        return std::accumulate(kmer_cnts.begin(), kmer_cnts.end(), size_t(0));
     }
 
     void BuildKmerIndex(size_t sample_cnt, const std::string& workdir, size_t nthreads) {
         INFO("Initializing kmer profile index");
 
-        //TODO: extract into a common header
-        typedef size_t Offset;
-        typedef uint16_t Mpl;
         using namespace debruijn_graph;
 
         KeyStoringMap<RtSeq, Offset, kmer_index_traits<RtSeq>, InvertableStoring>
@@ -147,7 +363,7 @@ class KmerMultiplicityCounter {
         DeBruijnKMerKMerSplitter<StoringTypeFilter<InvertableStoring>>
             splitter(kmer_mpl.workdir(), k_, k_, true, read_buffer_size);
 
-        //TODO: get rid of temporary .mker & .mpl files
+        //TODO: get rid of temporary .kmer file
         splitter.AddKMers(file_prefix_ + ".kmer");
 
         KMerDiskCounter<RtSeq> counter(kmer_mpl.workdir(), splitter);
@@ -155,15 +371,10 @@ class KmerMultiplicityCounter {
         BuildIndex(kmer_mpl, counter, 16, nthreads);
 
         INFO("Kmer profile fill start");
-        //We must allocate the whole buffer for all profiles at once
-        //to avoid pointer invalidation after possible vector resize
-        const size_t data_size = sample_cnt * kmer_mpl.size();
-
-        std::vector<Mpl> mpl_data;
-        mpl_data.reserve(data_size);
-        INFO("Allocated buffer of " << data_size << " elements");
+        //Profiles were already written into .bpr in the order of .kmer,
+        //so only their offsets should be stored
         std::ifstream kmers_in(file_prefix_ + ".kmer", std::ios::binary);
-        std::ifstream kmers_mpl_in(file_prefix_ + ".mpl");
+        Offset offset = 0;
         while (true) {
             RtSeq kmer(k_);
             kmer.BinRead(kmers_in);
@@ -171,31 +382,15 @@ class KmerMultiplicityCounter {
                 break;
             }
 
-//            VERIFY(kmer_str.length() == k_);
-//            conj_graph_pack::seq_t kmer(k_, kmer_str.c_str());
-//            kmer = gp_.kmer_mapper.Substitute(kmer);
-
-            Offset offset = mpl_data.size();
-            for (size_t i = 0; i < sample_cnt; ++i) {
-                Mpl mpl;
-                kmers_mpl_in >> mpl;
-                VERIFY(!kmers_mpl_in.fail());
-                mpl_data.push_back(mpl);
-            }
-            //Double-check we haven't invalidated vector views
-            VERIFY(mpl_data.size() <= data_size);
-
             auto kwh = kmer_mpl.ConstructKWH(kmer);
             VERIFY(kmer_mpl.valid(kwh));
             kmer_mpl.put_value(kwh, offset, inverter);
+            offset += sample_cnt;
         }
 
         std::ofstream map_file(file_prefix_ + ".kmm", std::ios_base::binary | std::ios_base::out);
         kmer_mpl.BinWrite(map_file);
 
-        std::ofstream mpl_file(file_prefix_ + ".bpr", std::ios_base::binary | std::ios_base::out);
-        mpl_file.write((const char *)&mpl_data[0], mpl_data.size() * sizeof(Mpl));
-
         INFO("Kmer profile fill finish");
     }
 
@@ -205,7 +400,8 @@ public:
     }
 
     void CombineMultiplicities(const vector<string>& input_files, size_t min_samples, const string& work_dir, size_t nthreads = 1) {
-        FilterCombinedKmers(input_files, min_samples);
+        size_t kmer_cnt = FilterCombinedKmers(input_files, min_samples, nthreads);
+        INFO(kmer_cnt << " kmers are present in at least " << min_samples << " samples");
         BuildKmerIndex(input_files.size(), work_dir, nthreads);
     }
 private:
@@ -53,6 +53,7 @@ int main(int argc, char** argv) {
     string out_root, propagation_dump;
     vector<bin_id> bins_of_interest;
     bool no_binning;
+    size_t nthreads;
     try {
         GetOpt_pp ops(argc, argv);
         ops.exceptions_all();
@@ -67,11 +68,13 @@ int main(int argc, char** argv) {
             >> Option('o', out_root)
             >> Option('d', propagation_dump, "")
             >> Option('b', bins_of_interest, {})
-            >> OptionPresent('p', no_binning);
+            >> OptionPresent('p', no_binning)
+            >> Option('t', nthreads, size_t(1));
     } catch(GetOptEx &ex) {
         cout << "Usage: prop_binning -k <K> -s <saves path> -c <contigs path> -f <splits path> "
                 "-a <binning annotation> -n <sample names> -l <left reads> -r <right reads> -o <output root> "
-                "[-d <propagation info dump>] [-p to disable binning] [-b <bins of interest>*]"  << endl;
+                "[-d <propagation info dump>] [-p to disable binning] [-b <bins of interest>*] "
+                "[-t <threads> (default: 1)]"  << endl;
         exit(1);
     }
 
@@ -96,7 +99,7 @@ int main(int argc, char** argv) {
     EdgeAnnotation edge_annotation = filler(contigs_stream, split_stream, annotation_in);
 
     INFO("Propagation launched");
-    AnnotationPropagator propagator(gp);
+    AnnotationPropagator propagator(gp, nthreads);
     propagator.Run(contigs_stream, edge_annotation);
     INFO("Propagation finished");
 
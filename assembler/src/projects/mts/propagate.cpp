@@ -17,11 +17,74 @@
 namespace debruijn_graph {
 static const size_t EDGE_LENGTH_THRESHOLD = 2000;
 
+/**
+ * Edge set over the flags indexed by edge int ids: constant time lookup
+ * and no tree node allocations. Edges are iterated in the order of insertion.
+ */
+class DenseEdgeSet {
+    std::vector<bool> flags_;
+    std::vector<EdgeId> edges_;
+
+public:
+    typedef std::vector<EdgeId>::const_iterator const_iterator;
+
+    explicit DenseEdgeSet(size_t id_bound) : flags_(id_bound, false) {}
+
+    bool count(EdgeId e) const {
+        return e.int_id() < flags_.size() && flags_[e.int_id()];
+    }
+
+    bool insert(EdgeId e) {
+        VERIFY(e.int_id() < flags_.size());
+        if (flags_[e.int_id()])
+            return false;
+        flags_[e.int_id()] = true;
+        edges_.push_back(e);
+        return true;
+    }
+
+    template<class It>
+    void insert(It begin, It end) {
+        for (; begin != end; ++begin)
+            insert(*begin);
+    }
+
+    //Resets the flags of the members only, so the set could be reused cheaply
+    void clear() {
+        for (EdgeId e : edges_)
+            flags_[e.int_id()] = false;
+        edges_.clear();
+    }
+
+    size_t size() const {
+        return edges_.size();
+    }
+
+    const_iterator begin() const {
+        return edges_.begin();
+    }
+
+    const_iterator end() const {
+        return edges_.end();
+    }
+};
+
+typedef std::vector<std::pair<bin_id, vector<EdgeId>>> BinPropagation;
+
 //FIXME 2kb edge length threshold might affect tip propagator in undesired way
 class EdgeAnnotationPropagator {
     const conj_graph_pack& gp_;
     const string name_;
     size_t edge_length_threshold_;
+    size_t edge_id_bound_;
+
+    static size_t EdgeIdBound(const Graph& g) {
+        size_t answer = 0;
+        for (auto it = g.ConstEdgeBegin(); !it.IsEnd(); ++it) {
+            answer = std::max(answer, g.int_id(*it) + 1);
+        }
+        return answer;
+    }
 
 protected:
     const conj_graph_pack& gp() const {
@@ -32,7 +95,12 @@ protected:
         return gp_.g;
     }
 
-    virtual set<EdgeId> PropagateEdges(const set<EdgeId>& edges) const = 0;
+    DenseEdgeSet EmptyEdgeSet() const {
+        return DenseEdgeSet(edge_id_bound_);
+    }
+
+    //Called for different bins in parallel, answer is empty on entry
+    virtual void PropagateEdges(const DenseEdgeSet& edges, DenseEdgeSet& answer) const = 0;
 
 public:
     EdgeAnnotationPropagator(const conj_graph_pack& gp,
@@ -40,25 +108,42 @@ public:
                              size_t edge_length_threshold = EDGE_LENGTH_THRESHOLD) :
                     gp_(gp),
                     name_(name),
-                    edge_length_threshold_(edge_length_threshold) {}
+                    edge_length_threshold_(edge_length_threshold),
+                    edge_id_bound_(EdgeIdBound(gp.g)) {}
 
     const std::string& name() const {
         return name_;
     }
 
-    std::map<bin_id, set<EdgeId>> Propagate(EdgeAnnotation& edge_annotation) const {
-        std::map<bin_id, set<EdgeId>> answer;
+    BinPropagation Propagate(const EdgeAnnotation& edge_annotation, size_t nthreads) const {
+        auto edges_of_bins = edge_annotation.EdgesOfBins(edge_length_threshold_);
+        BinPropagation answer;
+        vector<const vector<EdgeId>*> init_lists;
+        for (const auto& bin_edges : edges_of_bins) {
+            answer.push_back(std::make_pair(bin_edges.first, vector<EdgeId>()));
+            init_lists.push_back(&bin_edges.second);
+        }
+        //Edge sets are reused by the bins processed in the same thread
+        vector<DenseEdgeSet> init_sets(nthreads, EmptyEdgeSet());
+        vector<DenseEdgeSet> propagated_sets(nthreads, EmptyEdgeSet());
         DEBUG("Propagating with propagator: " << name_);
-        for (bin_id bin : edge_annotation.interesting_bins()) {
+#       pragma omp parallel for schedule(dynamic) num_threads((int) nthreads)
+        for (size_t i = 0; i < answer.size(); ++i) {
+            const bin_id& bin = answer[i].first;
             DEBUG("Processing bin " << bin << " with propagator: " << name_);
-            auto init_edges = edge_annotation.EdgesOfBin(bin, edge_length_threshold_);
+            DenseEdgeSet& init_edges = init_sets[omp_get_thread_num()];
+            init_edges.clear();
+            insert_all(init_edges, *init_lists[i]);
             DEBUG("Initial edge cnt " << init_edges.size() << " (edge length threshold " << edge_length_threshold_ << ")");
-            auto raw_propagated = PropagateEdges(init_edges);
-            set<EdgeId> propagated;
-            std::set_difference(raw_propagated.begin(), raw_propagated.end(),
-                                init_edges.begin(), init_edges.end(),
-                                std::inserter(propagated, propagated.end()));
-            answer[bin] = std::move(propagated);
+            DenseEdgeSet& raw_propagated = propagated_sets[omp_get_thread_num()];
+            raw_propagated.clear();
+            PropagateEdges(init_edges, raw_propagated);
+            vector<EdgeId>& propagated = answer[i].second;
+            for (EdgeId e : raw_propagated) {
+                if (!init_edges.count(e))
+                    propagated.push_back(e);
+            }
+            std::sort(propagated.begin(), propagated.end());
         }
         DEBUG("Finished propagating with propagator: " << name_);
         return answer;
@@ -74,7 +159,7 @@ class ConnectingPathPropagator : public EdgeAnnotationPropagator {
     size_t path_edge_cnt_;
     const EdgeAnnotation& debug_annotation_;
 
-    bin_id DetermineBin(const set<EdgeId>& edges) const {
+    bin_id DetermineBin(const DenseEdgeSet& edges) const {
         map<bin_id, size_t> cnt_map;
         for (EdgeId e : edges) {
             for (auto b : debug_annotation_.Annotation(e)) {
@@ -107,15 +192,17 @@ class ConnectingPathPropagator : public EdgeAnnotationPropagator {
         return cnt > 0;
     }
 
-    set<VertexId> CollectEdgeStarts(const set<EdgeId>& edges) const {
-        set<VertexId> answer;
+    vector<VertexId> CollectEdgeStarts(const DenseEdgeSet& edges) const {
+        vector<VertexId> answer;
         for (EdgeId e : edges) {
-            answer.insert(g().EdgeStart(e));
+            answer.push_back(g().EdgeStart(e));
         }
+        std::sort(answer.begin(), answer.end());
+        answer.erase(std::unique(answer.begin(), answer.end()), answer.end());
         return answer;
     }
 
-    set<EdgeId> PropagateEdges(const set<EdgeId>& edges) const override {
+    void PropagateEdges(const DenseEdgeSet& edges, DenseEdgeSet& answer) const override {
         //static size_t pic_cnt = 0;
         bin_id bin = DetermineBin(edges);
         if (!bin.empty()) {
@@ -123,8 +210,7 @@ class ConnectingPathPropagator : public EdgeAnnotationPropagator {
         } else {
             DEBUG("Failed to determine bin");
         }
-        set<EdgeId> answer;
-        set<VertexId> starts = CollectEdgeStarts(edges);
+        vector<VertexId> starts = CollectEdgeStarts(edges);
         for (EdgeId e : edges) {
             PathProcessor<Graph> path_searcher(g(), g().EdgeEnd(e), path_length_threshold_);
             for (VertexId v : starts) {
@@ -143,7 +229,6 @@ class ConnectingPathPropagator : public EdgeAnnotationPropagator {
                 path_searcher.Process(v, 0, path_length_threshold_, callback, path_edge_cnt_);
             }
         }
-        return answer;
     }
 
 public:
@@ -163,8 +248,7 @@ private:
 //FIXME make threshold coverage-aware
 class PairedInfoPropagator : public EdgeAnnotationPropagator {
     omnigraph::de::DEWeight weight_threshold_;
-    set<EdgeId> PropagateEdges(const set<EdgeId>& edges) const override {
-        set<EdgeId> answer;
+    void PropagateEdges(const DenseEdgeSet& edges, DenseEdgeSet& answer) const override {
         for (EdgeId e1 : edges) {
             DEBUG("Searching for paired neighbours of " << g().str(e1));
             for (const auto& index : gp().clustered_indices)
@@ -175,7 +259,6 @@ class PairedInfoPropagator : public EdgeAnnotationPropagator {
                             answer.insert(i.first);
                         }	    
         }
-        return answer;
     }
 public:
     PairedInfoPropagator(const conj_graph_pack& gp, omnigraph::de::DEWeight threshold):
@@ -184,41 +267,6 @@ private:
     DECL_LOGGER("PairedInfoPropagator");
 };
 
-class ContigPropagator : public EdgeAnnotationPropagator {
-public:
-    ContigPropagator(const conj_graph_pack& gp,
-                     io::SingleStream& contigs) :
-        EdgeAnnotationPropagator(gp, "ContigPropagator"),
-        contigs_(contigs),
-        mapper_(MapperInstance(gp))
-    {}
-protected:
-    set<EdgeId> PropagateEdges(const set<EdgeId>& edges) const override {
-        contigs_.reset();
-        set<EdgeId> answer;
-        io::SingleRead contig;
-        while (!contigs_.eof()) {
-            contigs_ >> contig;
-            auto edges_of_contig = mapper_->MapRead(contig).simple_path();
-            for (EdgeId e : edges_of_contig) {
-                if (edges.count(e)) {
-                    DEBUG("Edge " << gp().g.str(e) << " belongs to the contig #" << 
-                            contig.name() << " of " << edges_of_contig.size() << " edges");
-                    insert_all(answer, edges_of_contig);
-                    break;
-                }
-            }
-        }
-        return answer;
-    }
-
-private:
-    io::SingleStream& contigs_;
-    shared_ptr<SequenceMapper<Graph>> mapper_;
-
-    DECL_LOGGER("ContigPropagator");
-};
-
 class TipPropagator : public EdgeAnnotationPropagator {
 
 public:
@@ -226,8 +274,7 @@ public:
         EdgeAnnotationPropagator(gp, "TipPropagator"), tipper_(gp.g) {}
 
 protected:
-    set<EdgeId> PropagateEdges(const set<EdgeId>& edges) const override {
-        set<EdgeId> answer;
+    void PropagateEdges(const DenseEdgeSet& edges, DenseEdgeSet& answer) const override {
         for (EdgeId e1 : edges) {
             auto v = g().EdgeEnd(e1);
             auto neighbours = g().OutgoingEdges(v);
@@ -247,7 +294,6 @@ protected:
                 }
             }
         }
-        return answer;
     }
 
 private:
@@ -268,7 +314,8 @@ public:
         edge_length_threshold_(edge_length_threshold) {
     }
 
-    size_t Check(bin_id bin, const set<EdgeId>& propagated_edges) {
+    template<class EdgeCollection>
+    size_t Check(bin_id bin, const EdgeCollection& propagated_edges) {
         DEBUG("Checking edges to be annotated with " << bin);
         size_t answer = 0;
         for (EdgeId e : propagated_edges) {
@@ -296,22 +343,18 @@ void AnnotationPropagator::Run(io::SingleStream& /*contigs*/,
     std::vector<std::shared_ptr<EdgeAnnotationPropagator>> propagator_pipeline {
         std::make_shared<ConnectingPathPropagator>(gp_, 8000, 10, edge_annotation),
         std::make_shared<TipPropagator>(gp_), 
-        std::make_shared<PairedInfoPropagator>(gp_, 10.)};//,
-//        std::make_shared<ContigPropagator>(gp_, contigs)};//,
-//        std::make_shared<ConnectingPathPropagator>(gp_, 8000, 10, edge_annotation),
-//        std::make_shared<ContigPropagator>(gp_, contigs),
-//        std::make_shared<TipPropagator>(gp_)};
+        std::make_shared<PairedInfoPropagator>(gp_, 10.)};
 
     AnnotationChecker checker(gp_.g, edge_annotation);
 
-    for (const auto& bin_id : edge_annotation.interesting_bins()) {
-        size_t problem_cnt = checker.Check(bin_id, edge_annotation.EdgesOfBin(bin_id, EDGE_LENGTH_THRESHOLD));
-        DEBUG("Bin " << bin_id << " had " << problem_cnt << " problems");
+    for (const auto& bin_edges : edge_annotation.EdgesOfBins(EDGE_LENGTH_THRESHOLD)) {
+        size_t problem_cnt = checker.Check(bin_edges.first, bin_edges.second);
+        DEBUG("Bin " << bin_edges.first << " had " << problem_cnt << " problems");
     }
 
     for (auto prop_ptr : propagator_pipeline) {
         DEBUG("Propagating with: " << prop_ptr->name());
-        auto propagation_map = prop_ptr->Propagate(edge_annotation);
+        auto propagation_map = prop_ptr->Propagate(edge_annotation, nthreads_);
 
         DEBUG("Extending " << propagation_map.size() << " bins after propagation with: " << prop_ptr->name());
         for (const auto& bin_prop : propagation_map) {
@@ -14,10 +14,11 @@ namespace debruijn_graph {
 
 class AnnotationPropagator {
     const conj_graph_pack& gp_;
+    size_t nthreads_;
 
 public:
-    AnnotationPropagator(const conj_graph_pack& gp) :
-                     gp_(gp) {
+    AnnotationPropagator(const conj_graph_pack& gp, size_t nthreads = 1) :
+                     gp_(gp), nthreads_(nthreads) {
     }
 
     void Run(io::SingleStream& contigs, EdgeAnnotation& edge_annotation);
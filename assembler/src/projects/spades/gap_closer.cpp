@@ -10,13 +10,89 @@
 #include "modules/simplification/compressor.hpp"
 #include "io/dataset_support/read_converter.hpp"
 #include <stack>
+#include <unordered_set>
 
 namespace debruijn_graph {
 
+/*
+ * Sketch of a set of k-mers: a bit set indexed by the hash of the last (at most 32)
+ * nucleotides of a k-mer. Membership test has no false negatives, so a sequence
+ * without any k-mer in the sketch surely has none in the set.
+ */
+class KmerSketch {
+    static const size_t BITS_PER_KMER = 16;
+
+    size_t k_;
+    uint64_t key_mask_;
+    unsigned shift_;
+    std::vector<uint64_t> bits_;
+
+    size_t Slot(uint64_t key) const {
+        return (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> shift_);
+    }
+
+    bool Test(uint64_t key) const {
+        size_t slot = Slot(key);
+        return bits_[slot >> 6] & (uint64_t(1) << (slot & 63));
+    }
+
+    void Set(uint64_t key) {
+        size_t slot = Slot(key);
+        bits_[slot >> 6] |= uint64_t(1) << (slot & 63);
+    }
+
+    template<class F>
+    void ForEachKey(const Sequence &s, F f) const {
+        uint64_t key = 0;
+        for (size_t i = 0; i < s.size(); ++i) {
+            key = ((key << 2) | (uint64_t) s[i]) & key_mask_;
+            if (i + 1 >= k_ && f(key))
+                return;
+        }
+    }
+
+    uint64_t Key(const RtSeq &kmer) const {
+        uint64_t key = 0;
+        for (size_t i = 0; i < kmer.size(); ++i)
+            key = ((key << 2) | (uint64_t) kmer[i]) & key_mask_;
+        return key;
+    }
+
+public:
+    KmerSketch(size_t k, size_t kmer_cnt)
+            : k_(k), key_mask_(k >= 32 ? ~uint64_t(0) : (uint64_t(1) << 2 * k) - 1), shift_(64 - 6) {
+        while ((uint64_t(1) << (64 - shift_)) < kmer_cnt * BITS_PER_KMER)
+            --shift_;
+        bits_.resize((size_t(1) << (64 - shift_)) / 64, 0);
+    }
+
+    void Add(const RtSeq &kmer) {
+        Set(Key(kmer));
+    }
+
+    void AddAll(const Sequence &s) {
+        ForEachKey(s, [&](uint64_t key) { Set(key); return false; });
+    }
+
+    bool Contains(const RtSeq &kmer) const {
+        return Test(Key(kmer));
+    }
+
+    bool Intersects(const Sequence &s) const {
+        bool answer = false;
+        ForEachKey(s, [&](uint64_t key) {
+            answer = Test(key);
+            return answer;
+        });
+        return answer;
+    }
+};
+
 class GapCloserPairedIndexFiller {
 private:
     const Graph &graph_;
     const SequenceMapper<Graph> &mapper_;
+    const KmerMapper<Graph> &kmer_mapper_;
 
     size_t CorrectLength(Path<EdgeId> path, size_t idx) const {
         size_t answer = graph_.length(path[idx]);
@@ -28,13 +104,19 @@ private:
     }
 
     template<typename PairedRead>
-    void ProcessPairedRead(omnigraph::de::PairedInfoBuffer<Graph> &paired_index,
+    bool ProcessPairedRead(omnigraph::de::PairedInfoBuffer<Graph> &paired_index,
                            const PairedRead &p_r,
                            const std::unordered_map<EdgeId, pair<EdgeId, int> > &OutTipMap,
-                           const std::unordered_map<EdgeId, pair<EdgeId, int> > &InTipMap) const {
+                           const std::unordered_map<EdgeId, pair<EdgeId, int> > &InTipMap,
+                           const KmerSketch &out_tip_sketch,
+                           const KmerSketch &in_tip_sketch) const {
         Sequence read1 = p_r.first().sequence();
         Sequence read2 = p_r.second().sequence();
 
+        //the mates could not be mapped to the tips, no need to map them at all
+        if (!out_tip_sketch.Intersects(read1) || !in_tip_sketch.Intersects(read2))
+            return false;
+
         Path<EdgeId> path1 = mapper_.MapSequence(read1).path();
         Path<EdgeId> path2 = mapper_.MapSequence(read2).path();
         for (size_t i = 0; i < path1.size(); ++i) {
@@ -54,6 +136,34 @@ private:
                 }
             }
         }
+        return true;
+    }
+
+    /*
+     * The mapper finds an edge only by a k-mer of the read lying on it, either
+     * as is or after the substitution by the k-mer mapper. So all the k-mers of
+     * the tip edges and the k-mers substituted by them are put into the sketch.
+     */
+    KmerSketch BuildTipSketch(const std::unordered_map<EdgeId, pair<EdgeId, int> > &tip_map) const {
+        size_t k = graph_.k() + 1;
+        size_t kmer_cnt = 0;
+        for (const auto &entry : tip_map)
+            kmer_cnt += graph_.length(entry.first);
+
+        KmerSketch sketch(k, kmer_cnt);
+        for (const auto &entry : tip_map)
+            sketch.AddAll(graph_.EdgeNucls(entry.first));
+
+        std::vector<RtSeq> substituted;
+        for (auto it = kmer_mapper_.begin(); it != kmer_mapper_.end(); ++it) {
+            RtSeq kmer = it->first;
+            if (sketch.Contains(kmer_mapper_.Substitute(kmer)))
+                substituted.push_back(kmer);
+        }
+        for (const RtSeq &kmer : substituted)
+            sketch.Add(kmer);
+
+        return sketch;
     }
 
     void PrepareShiftMaps(std::unordered_map<EdgeId, pair<EdgeId, int> > &OutTipMap,
@@ -116,13 +226,16 @@ private:
     void MapReads(omnigraph::de::PairedInfoIndexT<Graph> &paired_index, Streams &streams,
                   const std::unordered_map<EdgeId, pair<EdgeId, int> > &OutTipMap,
                   const std::unordered_map<EdgeId, pair<EdgeId, int> > &InTipMap) const {
+        KmerSketch out_tip_sketch = BuildTipSketch(OutTipMap);
+        KmerSketch in_tip_sketch = BuildTipSketch(InTipMap);
+
         INFO("Processing paired reads (takes a while)");
 
         size_t nthreads = streams.size();
         omnigraph::de::PairedInfoBuffersT<Graph> buffer_pi(graph_, nthreads);
 
-        size_t counter = 0;
-#       pragma omp parallel for num_threads(nthreads) reduction(+ : counter)
+        size_t counter = 0, mapped = 0;
+#       pragma omp parallel for num_threads(nthreads) reduction(+ : counter, mapped)
         for (size_t i = 0; i < nthreads; ++i) {
             typename Streams::ReadT r;
             auto &stream = streams[i];
@@ -131,11 +244,12 @@ private:
             while (!stream.eof()) {
                 stream >> r;
                 ++counter;
-                ProcessPairedRead(buffer_pi[i], r, OutTipMap, InTipMap);
+                if (ProcessPairedRead(buffer_pi[i], r, OutTipMap, InTipMap, out_tip_sketch, in_tip_sketch))
+                    ++mapped;
             }
         }
 
-        INFO("Used " << counter << " paired reads");
+        INFO("Used " << counter << " paired reads, " << mapped << " of them could touch the tips");
 
         INFO("Merging paired indices");
         for (auto &index: buffer_pi) {
@@ -146,8 +260,9 @@ private:
 
 public:
 
-    GapCloserPairedIndexFiller(const Graph &graph, const SequenceMapper<Graph> &mapper)
-            : graph_(graph), mapper_(mapper) { }
+    GapCloserPairedIndexFiller(const Graph &graph, const SequenceMapper<Graph> &mapper,
+                               const KmerMapper<Graph> &kmer_mapper)
+            : graph_(graph), mapper_(mapper), kmer_mapper_(kmer_mapper) { }
 
     /**
      * Method reads paired data from stream, maps it to genome and stores it in this PairInfoIndex.
@@ -236,6 +351,34 @@ class GapCloser {
                           : long_seq.Subseq(long_seq.size() - short_seq.size()) == short_seq;
     }
 
+    enum class ClosureType {
+        Simple,
+        CorrectLeft,
+        CorrectRight
+    };
+
+    //edit of the graph closing the gap between the end of first and the start of second
+    struct GapClosure {
+        EdgeId first;
+        EdgeId second;
+        int overlap;
+        ClosureType type;
+        vector<size_t> diff_pos;
+    };
+
+    //outcome of the pass over the tip pairs of a single first edge
+    struct TipDecision {
+        bool closed;
+        size_t checked;
+        GapClosure closure;
+        //candidate second edges the decision depends on
+        vector<EdgeId> seconds;
+
+        TipDecision() : closed(false), checked(0) {}
+    };
+
+    static const size_t TIP_BATCH_SIZE = 4096;
+
     void CorrectLeft(EdgeId first, EdgeId second, int overlap, const vector<size_t> &diff_pos) {
         DEBUG("Can correct first with sequence from second.");
         Sequence new_sequence = g_.EdgeNucls(first).Subseq(g_.length(first) - overlap + diff_pos.front(),
@@ -272,15 +415,24 @@ class GapCloser {
                 new_sequence);
     }
 
-    bool HandlePositiveHammingDistanceCase(EdgeId first, EdgeId second, int overlap) {
+    void FillGap(EdgeId first, EdgeId second, int overlap) {
+        //old code
+        Sequence edge_sequence = g_.EdgeNucls(first).Last(k_)
+                                 + g_.EdgeNucls(second).Subseq(overlap, k_);
+        DEBUG("Gap filled: Gap size = " << k_ - overlap << "  Result seq "
+              << edge_sequence.str());
+        g_.AddEdge(g_.EdgeEnd(first), g_.EdgeStart(second), edge_sequence);
+    }
+
+    bool HandlePositiveHammingDistanceCase(EdgeId first, EdgeId second, int overlap, GapClosure &closure) const {
         DEBUG("Match was imperfect. Trying to correct one of the tips");
-        vector<size_t> diff_pos = DiffPos(g_.EdgeNucls(first).Last(overlap),
-                                          g_.EdgeNucls(second).First(overlap));
-        if (CanCorrectLeft(first, overlap, diff_pos)) {
-            CorrectLeft(first, second, overlap, diff_pos);
+        closure.diff_pos = DiffPos(g_.EdgeNucls(first).Last(overlap),
+                                   g_.EdgeNucls(second).First(overlap));
+        if (CanCorrectLeft(first, overlap, closure.diff_pos)) {
+            closure.type = ClosureType::CorrectLeft;
             return true;
-        } else if (CanCorrectRight(second, overlap, diff_pos)) {
-            CorrectRight(first, second, overlap, diff_pos);
+        } else if (CanCorrectRight(second, overlap, closure.diff_pos)) {
+            closure.type = ClosureType::CorrectRight;
             return true;
         } else {
             DEBUG("Can't correct tips due to the graph structure");
@@ -288,7 +440,7 @@ class GapCloser {
         }
     }
 
-    bool HandleSimpleCase(EdgeId first, EdgeId second, int overlap) {
+    bool HandleSimpleCase(int overlap, GapClosure &closure) const {
         DEBUG("Match was perfect. No correction needed");
         DEBUG("Overlap " << overlap);
         //strange info guard
@@ -297,16 +449,12 @@ class GapCloser {
             DEBUG("Tried to close zero gap");
             return false;
         }
-        //old code
-        Sequence edge_sequence = g_.EdgeNucls(first).Last(k_)
-                                 + g_.EdgeNucls(second).Subseq(overlap, k_);
-        DEBUG("Gap filled: Gap size = " << k_ - overlap << "  Result seq "
-              << edge_sequence.str());
-        g_.AddEdge(g_.EdgeEnd(first), g_.EdgeStart(second), edge_sequence);
+        closure.type = ClosureType::Simple;
         return true;
     }
 
-    bool ProcessPair(EdgeId first, EdgeId second) {
+    //decides how to close the gap between the tips, the graph is not modified
+    bool FindClosure(EdgeId first, EdgeId second, GapClosure &closure) const {
         TRACE("Processing edges " << g_.str(first) << " and " << g_.str(second));
         TRACE("first " << g_.EdgeNucls(first) << " second " << g_.EdgeNucls(second));
 
@@ -316,8 +464,6 @@ class GapCloser {
             return false;
         }
 
-        Sequence seq1 = g_.EdgeNucls(first);
-        Sequence seq2 = g_.EdgeNucls(second);
         TRACE("Checking possible gaps from 1 to " << k_ - min_intersection_);
         for (int gap = 1; gap <= k_ - (int) min_intersection_; ++gap) {
             int overlap = k_ - gap;
@@ -331,50 +477,134 @@ class GapCloser {
                 //                << seq1.Subseq(seq1.size() - k).str() << "  "
                 //                << seq2.Subseq(0, k).str());
 
+                closure.first = first;
+                closure.second = second;
+                closure.overlap = overlap;
                 if (hamming_distance > 0) {
-                    return HandlePositiveHammingDistanceCase(first, second, overlap);
+                    return HandlePositiveHammingDistanceCase(first, second, overlap, closure);
                 } else {
-                    return HandleSimpleCase(first, second, overlap);
+                    return HandleSimpleCase(overlap, closure);
                 }
             }
         }
         return false;
     }
 
+    void CloseGap(const GapClosure &closure, std::unordered_set<EdgeId> &removed) {
+        switch (closure.type) {
+            case ClosureType::Simple:
+                FillGap(closure.first, closure.second, closure.overlap);
+                break;
+            case ClosureType::CorrectLeft:
+                removed.insert(closure.first);
+                removed.insert(g_.conjugate(closure.first));
+                CorrectLeft(closure.first, closure.second, closure.overlap, closure.diff_pos);
+                break;
+            case ClosureType::CorrectRight:
+                removed.insert(closure.second);
+                removed.insert(g_.conjugate(closure.second));
+                CorrectRight(closure.first, closure.second, closure.overlap, closure.diff_pos);
+                break;
+        }
+    }
+
+    //the first gap which could be closed from the end of first_edge, the graph is not modified
+    void FindTipClosure(EdgeId first_edge, const std::unordered_set<EdgeId> &removed, TipDecision &decision) const {
+        for (auto i : tips_paired_idx_.Get(first_edge)) {
+            EdgeId second_edge = i.first;
+            if (first_edge == second_edge || removed.count(second_edge))
+                continue;
+
+            decision.seconds.push_back(second_edge);
+            if (!g_.IsDeadEnd(g_.EdgeEnd(first_edge)) || !g_.IsDeadStart(g_.EdgeStart(second_edge))) {
+                // WARN("Topologically wrong tips");
+                continue;
+            }
+
+            //the outcome does not depend on the point, so every supported point counts as a checked candidate
+            size_t candidates = 0;
+            for (auto point : i.second) {
+                if (!math::ls(point.weight, weight_threshold_))
+                    ++candidates;
+            }
+            if (!candidates)
+                continue;
+
+            if (FindClosure(first_edge, second_edge, decision.closure)) {
+                decision.checked += 1;
+                decision.closed = true;
+                return;
+            }
+            decision.checked += candidates;
+        }
+    }
+
+    bool Touched(EdgeId first_edge, const TipDecision &decision,
+                 const std::unordered_set<EdgeId> &touched_edges,
+                 const std::unordered_set<VertexId> &touched_vertices) const {
+        if (touched_edges.count(first_edge) || touched_vertices.count(g_.EdgeEnd(first_edge)))
+            return true;
+        for (EdgeId e : decision.seconds) {
+            if (touched_edges.count(e) || touched_vertices.count(g_.EdgeStart(e)))
+                return true;
+        }
+        return false;
+    }
+
 public:
-    //TODO extract methods
+    //Decisions for the batches of first edges are found in parallel and applied in the order of the
+    //serial pass. A decision reading the elements modified by a preceding closure of its batch is redone.
     void CloseShortGaps() {
         INFO("Closing short gaps");
+        //the edges with tip pairs in the order of SmartEdgeIterator
+        vector<EdgeId> first_edges;
+        for (auto it = g_.ConstEdgeBegin(); !it.IsEnd(); ++it) {
+            if (!tips_paired_idx_.Get(*it).empty())
+                first_edges.push_back(*it);
+        }
+        std::sort(first_edges.begin(), first_edges.end());
+
         size_t gaps_filled = 0;
         size_t gaps_checked = 0;
-        for (auto edge = g_.SmartEdgeBegin(); !edge.IsEnd(); ++edge) {
-            EdgeId first_edge = *edge;
-            for (auto i : tips_paired_idx_.Get(first_edge)) {
-                EdgeId second_edge = i.first;
-                if (first_edge == second_edge)
-                    continue;
+        std::unordered_set<EdgeId> removed;
+        for (size_t batch_start = 0; batch_start < first_edges.size(); batch_start += TIP_BATCH_SIZE) {
+            size_t batch_end = std::min(first_edges.size(), batch_start + TIP_BATCH_SIZE);
+            vector<TipDecision> decisions(batch_end - batch_start);
+#           pragma omp parallel for schedule(guided)
+            for (size_t i = batch_start; i < batch_end; ++i) {
+                if (!removed.count(first_edges[i]))
+                    FindTipClosure(first_edges[i], removed, decisions[i - batch_start]);
+            }
 
-                if (!g_.IsDeadEnd(g_.EdgeEnd(first_edge)) || !g_.IsDeadStart(g_.EdgeStart(second_edge))) {
-                    // WARN("Topologically wrong tips");
+            std::unordered_set<EdgeId> touched_edges;
+            std::unordered_set<VertexId> touched_vertices;
+            for (size_t i = batch_start; i < batch_end; ++i) {
+                EdgeId first_edge = first_edges[i];
+                if (removed.count(first_edge))
                     continue;
-                }
 
-                bool closed = false;
-                for (auto point : i.second) {
-                    if (math::ls(point.weight, weight_threshold_))
-                        continue;
+                TipDecision &decision = decisions[i - batch_start];
+                if (Touched(first_edge, decision, touched_edges, touched_vertices)) {
+                    decision = TipDecision();
+                    FindTipClosure(first_edge, removed, decision);
+                }
+                gaps_checked += decision.checked;
+                if (!decision.closed)
+                    continue;
 
-                    ++gaps_checked;
-                    closed = ProcessPair(first_edge, second_edge);
-                    if (closed) {
-                        ++gaps_filled;
-                        break;
-                    }
+                const GapClosure &closure = decision.closure;
+                for (EdgeId e : {closure.first, closure.second}) {
+                    touched_edges.insert(e);
+                    touched_edges.insert(g_.conjugate(e));
+                }
+                for (VertexId v : {g_.EdgeEnd(closure.first), g_.EdgeStart(closure.second)}) {
+                    touched_vertices.insert(v);
+                    touched_vertices.insert(g_.conjugate(v));
                 }
-                if (closed)
-                    break;
-            } // second edge
-        } // first edge
+                CloseGap(closure, removed);
+                ++gaps_filled;
+            }
+        }
 
         INFO("Closing short gaps complete: filled " << gaps_filled
              << " gaps after checking " << gaps_checked
@@ -405,7 +635,7 @@ private:
 template<class Streams>
 void CloseGaps(conj_graph_pack &gp, Streams &streams) {
     auto mapper = MapperInstance(gp);
-    GapCloserPairedIndexFiller gcpif(gp.g, *mapper);
+    GapCloserPairedIndexFiller gcpif(gp.g, *mapper, gp.kmer_mapper);
     PairedIndexT tips_paired_idx(gp.g);
     gcpif.FillIndex(tips_paired_idx, streams);
     GapCloser gap_closer(gp.g, tips_paired_idx,
@@ -228,13 +228,10 @@ class PacbioAligner {
     PathStorage<Graph>& path_storage_;
     GapStorage& gap_storage_;
     pacbio::StatsCounter stats_;
-    const PathStorage<Graph> empty_path_storage_;
     const GapStorage empty_gap_storage_;
     const size_t read_buffer_size_;
 
     void ProcessReadsBatch(const std::vector<io::SingleRead>& reads, size_t thread_cnt) {
-        vector<PathStorage<Graph>> long_reads_by_thread(thread_cnt,
-                                                        empty_path_storage_);
         vector<GapStorage> gaps_by_thread(thread_cnt,
                                           empty_gap_storage_);
         vector<pacbio::StatsCounter> stats_by_thread(thread_cnt);
@@ -253,7 +250,7 @@ class PacbioAligner {
 
             const auto& aligned_edges = current_read_mapping.main_storage;
             for (const auto& path : aligned_edges)
-                long_reads_by_thread[thread_num].AddPath(path, 1, true);
+                path_storage_.AddPath(path, 1, true);
 
             //counting stats:
             for (const auto& path : aligned_edges)
@@ -280,7 +277,6 @@ class PacbioAligner {
                                     << nontrivial_aligned);
 
         for (size_t i = 0; i < thread_cnt; i++) {
-            path_storage_.AddStorage(long_reads_by_thread[i]);
             gap_storage_.AddStorage(gaps_by_thread[i]);
             stats_.AddStorage(stats_by_thread[i]);
         }
@@ -294,10 +290,9 @@ public:
             pac_index_(pac_index),
             path_storage_(path_storage),
             gap_storage_(gap_storage),
-            empty_path_storage_(path_storage),
             empty_gap_storage_(gap_storage),
             read_buffer_size_(read_buffer_size) {
-        VERIFY(empty_path_storage_.size() == 0);
+        VERIFY(path_storage_.size() == 0);
         VERIFY(empty_gap_storage_.size() == 0);
     }
 
@@ -62,7 +62,9 @@ void assemble_genome() {
 
     StageManager SPAdes({cfg::get().developer_mode,
                          cfg::get().load_from,
-                         cfg::get().output_saves});
+                         cfg::get().output_saves},
+                        path::append_path(cfg::get().output_base, "timeline.json"),
+                        "K" + std::to_string(cfg::get().K));
 
     size_t read_index_cnt = cfg::get().ds.reads.lib_count();
     if (two_step_rr)
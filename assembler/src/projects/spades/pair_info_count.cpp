@@ -16,13 +16,11 @@
 #include "modules/path_extend/split_graph_pair_info.hpp"
 
 #include "adt/bf.hpp"
-#include "adt/hll.hpp"
 
 namespace debruijn_graph {
 
 typedef io::SequencingLibrary<config::DataSetData> SequencingLib;
-using PairedInfoFilter = bf::counting_bloom_filter<std::pair<EdgeId, EdgeId>, 2>;
-using EdgePairCounter = hll::hll<std::pair<EdgeId, EdgeId>>;
+using PairedInfoFilter = bf::scalable_counting_bloom_filter<std::pair<EdgeId, EdgeId>, 2>;
 
 class DEFilter : public SequenceMapperListener {
   public:
@@ -58,68 +56,21 @@ class DEFilter : public SequenceMapperListener {
     const Graph &g_;
 };
 
-class EdgePairCounterFiller : public SequenceMapperListener {
-    static uint64_t EdgePairHash(const std::pair<EdgeId, EdgeId> &e) {
-        uint64_t h1 = e.first.hash();
-        return CityHash64WithSeeds((const char*)&h1, sizeof(h1), e.second.hash(), 0x0BADF00D);
-    }
-
-  public:
-    EdgePairCounterFiller(size_t thread_num)
-            : counter_(EdgePairHash) {
-        buf_.reserve(thread_num);
-        for (unsigned i = 0; i < thread_num; ++i)
-          buf_.emplace_back(EdgePairHash);
-    }
-
-    void MergeBuffer(size_t i) override {
-        counter_.merge(buf_[i]);
-        buf_[i].clear();
-    }
-
-    void ProcessPairedRead(size_t idx,
-                           const io::PairedRead&,
-                           const MappingPath<EdgeId>& read1,
-                           const MappingPath<EdgeId>& read2) override {
-        ProcessPairedRead(buf_[idx], read1, read2);
-    }
-    void ProcessPairedRead(size_t idx,
-                           const io::PairedReadSeq&,
-                           const MappingPath<EdgeId>& read1,
-                           const MappingPath<EdgeId>& read2) override {
-        ProcessPairedRead(buf_[idx], read1, read2);
-    }
-
-    std::pair<double, bool> cardinality() const {
-        return counter_.cardinality();
-    }
-  private:
-    void ProcessPairedRead(EdgePairCounter &buf,
-                           const MappingPath<EdgeId>& path1,
-                           const MappingPath<EdgeId>& path2) {
-        for (size_t i = 0; i < path1.size(); ++i) {
-            std::pair<EdgeId, MappingRange> mapping_edge_1 = path1[i];
-            for (size_t j = 0; j < path2.size(); ++j) {
-                std::pair<EdgeId, MappingRange> mapping_edge_2 = path2[j];
-                buf.add({mapping_edge_1.first, mapping_edge_2.first});
-            }
-        }
-    }
-
-    std::vector<EdgePairCounter> buf_;
-    EdgePairCounter counter_;
-};
-
+// Paired info filter (if any) is filled within the same pass
 static bool CollectLibInformation(const conj_graph_pack &gp,
-                                  size_t &edgepairs,
+                                  PairedInfoFilter *filter,
                                   size_t ilib, size_t edge_length_threshold) {
     INFO("Estimating insert size (takes a while)");
     InsertSizeCounter hist_counter(gp, edge_length_threshold);
-    EdgePairCounterFiller pcounter(cfg::get().max_threads);
 
     SequenceMapperNotifier notifier(gp);
     notifier.Subscribe(ilib, &hist_counter);
-    notifier.Subscribe(ilib, &pcounter);
+    std::unique_ptr<DEFilter> filter_counter;
+    if (filter) {
+        INFO("Filtering data for library #" << ilib);
+        filter_counter.reset(new DEFilter(*filter, gp.g));
+        notifier.Subscribe(ilib, filter_counter.get());
+    }
 
     SequencingLib &reads = cfg::get_writable().ds.reads[ilib];
     auto &data = reads.data();
@@ -129,9 +80,8 @@ static bool CollectLibInformation(const conj_graph_pack &gp,
     //Check read length after lib processing since mate pairs a not used until this step
     VERIFY(reads.data().read_length != 0);
 
-    auto pres = pcounter.cardinality();
-    edgepairs = (!pres.second ? 64ull * 1024 * 1024 : size_t(pres.first));
-    INFO("Edge pairs: " << edgepairs << (!pres.second ? " (rough upper limit)" : ""));
+    if (filter)
+        INFO("Edge pairs: " << filter->size());
 
     INFO(hist_counter.mapped() << " paired reads (" <<
          ((double) hist_counter.mapped() * 100.0 / (double) hist_counter.total()) <<
@@ -313,8 +263,20 @@ void PairInfoCount::run(conj_graph_pack &gp, const char *) {
                 size_t rl = lib_data.read_length;
                 size_t k = cfg::get().K;
 
-                size_t edgepairs = 0;
-                if (!CollectLibInformation(gp, edgepairs, i, edge_length_threshold)) {
+                std::unique_ptr<PairedInfoFilter> filter;
+                unsigned filter_threshold = cfg::get().de.raw_filter_threshold;
+
+                // Only filter paired-end libraries
+                if (filter_threshold && lib.type() == io::LibraryType::PairedEnd) {
+                    // The filter grows itself, so start with a rough estimate
+                    filter.reset(new PairedInfoFilter([](const std::pair<EdgeId, EdgeId> &e, uint64_t seed) {
+                                uint64_t h1 = e.first.hash();
+                                return CityHash64WithSeeds((const char*)&h1, sizeof(h1), e.second.hash(), seed);
+                            },
+                            std::max<size_t>(gp.g.size(), 1 << 20)));
+                }
+
+                if (!CollectLibInformation(gp, filter.get(), i, edge_length_threshold)) {
                     cfg::get_writable().ds.reads[i].data().mean_insert_size = 0.0;
                     WARN("Unable to estimate insert size for paired library #" << i);
                     if (rl > 0 && rl <= k) {
@@ -337,29 +299,6 @@ void PairInfoCount::run(conj_graph_pack &gp, const char *) {
                     WARN("Estimated mean insert size " << lib_data.mean_insert_size
                          << " is very small compared to read length " << rl);
 
-                std::unique_ptr<PairedInfoFilter> filter;
-                unsigned filter_threshold = cfg::get().de.raw_filter_threshold;
-
-                // Only filter paired-end libraries
-                if (filter_threshold && lib.type() == io::LibraryType::PairedEnd) {
-                    filter.reset(new PairedInfoFilter([](const std::pair<EdgeId, EdgeId> &e, uint64_t seed) {
-                                uint64_t h1 = e.first.hash();
-                                return CityHash64WithSeeds((const char*)&h1, sizeof(h1), e.second.hash(), seed);
-                            },
-                            12 * edgepairs));
-
-                    INFO("Filtering data for library #" << i);
-                    {
-                        SequenceMapperNotifier notifier(gp);
-                        DEFilter filter_counter(*filter, gp.g);
-                        notifier.Subscribe(i, &filter_counter);
-
-                        auto reads = paired_binary_readers(lib, false);
-                        VERIFY(lib.data().read_length != 0);
-                        notifier.ProcessLibrary(reads, i, *ChooseProperMapper(gp, lib, cfg::get().bwa.bwa_enable));
-                    }
-                }
-
                 INFO("Mapping library #" << i);
                 if (lib.data().mean_insert_size != 0.0) {
                     INFO("Mapping paired reads (takes a while) ");
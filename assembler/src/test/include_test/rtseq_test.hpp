@@ -704,3 +704,87 @@ BOOST_AUTO_TEST_CASE( TestRtSeqFirstLast ) {
     BOOST_CHECK_EQUAL(3, s2.first());
     BOOST_CHECK_EQUAL(3, s2.last());
 }
+
+//The shift, compare and reverse-complement kernels are specialised for k-mers taking one and two
+//words. Stored in bytes, k-mers longer than 8 take more words and hence the general path, which is
+//checked against the specialised 64-bit kernels this way. Shorter byte k-mers cover the specialised
+//kernels on 8-bit words.
+typedef RuntimeSeq<UPPER_BOUND, uint8_t> ByteRtSeq;
+
+static const size_t RtSeqKernelKs[] = {1, 4, 5, 8, 9, 16, 31, 32, 33, 63, 64, RtSeq::max_size};
+
+BOOST_AUTO_TEST_CASE( TestRtSeqKernelsWordsInUse ) {
+    BOOST_CHECK_EQUAL(1u, RtSeq::GetDataSize(32));
+    BOOST_CHECK_EQUAL(2u, RtSeq::GetDataSize(64));
+    BOOST_CHECK_EQUAL(3u, RtSeq::GetDataSize(65));
+    BOOST_CHECK_EQUAL(2u, ByteRtSeq::GetDataSize(8));
+    BOOST_CHECK_EQUAL(3u, ByteRtSeq::GetDataSize(9));
+}
+
+static std::string RandomNucls(size_t size, unsigned seed) {
+    std::string res;
+    for (size_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        res += nucl(char((seed >> 16) & 3));
+    }
+    return res;
+}
+
+BOOST_AUTO_TEST_CASE( TestRtSeqKernelsReverseComplement ) {
+    for (size_t k : RtSeqKernelKs) {
+        for (unsigned seed = 0; seed < 10; ++seed) {
+            std::string s = RandomNucls(k, seed);
+            std::string rc = (!Sequence(s)).str();
+            RtSeq kmer(k, s.c_str());
+            BOOST_CHECK_EQUAL(rc, (!kmer).str());
+            BOOST_CHECK_EQUAL((!ByteRtSeq(k, s.c_str())).str(), (!kmer).str());
+            BOOST_CHECK_EQUAL(RtSeq(k, rc.c_str()), !kmer);
+            BOOST_CHECK_EQUAL(kmer, !!kmer);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( TestRtSeqKernelsShiftLeft ) {
+    for (size_t k : RtSeqKernelKs) {
+        std::string s = RandomNucls(k + 200, unsigned(k));
+        RtSeq kmer(k, s.substr(0, k).c_str());
+        ByteRtSeq byte_kmer(k, s.substr(0, k).c_str());
+        for (size_t i = k; i < s.size(); ++i) {
+            RtSeq expected(k, s.substr(i - k + 1, k).c_str());
+            BOOST_CHECK_EQUAL(expected, kmer << s[i]);
+            kmer <<= dignucl(s[i]);
+            byte_kmer <<= dignucl(s[i]);
+            BOOST_CHECK_EQUAL(expected, kmer);
+            BOOST_CHECK_EQUAL(byte_kmer.str(), kmer.str());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( TestRtSeqKernelsShiftRight ) {
+    for (size_t k : RtSeqKernelKs) {
+        std::string s = RandomNucls(k + 200, unsigned(k) + 1);
+        RtSeq kmer(k, s.substr(s.size() - k).c_str());
+        ByteRtSeq byte_kmer(k, s.substr(s.size() - k).c_str());
+        for (size_t i = s.size() - k; i > 0; --i) {
+            RtSeq expected(k, s.substr(i - 1, k).c_str());
+            BOOST_CHECK_EQUAL(expected, kmer >> s[i - 1]);
+            kmer >>= dignucl(s[i - 1]);
+            byte_kmer >>= dignucl(s[i - 1]);
+            BOOST_CHECK_EQUAL(expected, kmer);
+            BOOST_CHECK_EQUAL(byte_kmer.str(), kmer.str());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( TestRtSeqKernelsCompare ) {
+    for (size_t k : RtSeqKernelKs) {
+        std::string s = RandomNucls(k, unsigned(k) + 2);
+        for (size_t i = 0; i < k; ++i) {
+            std::string t = s;
+            t[i] = nucl(char(complement(dignucl(t[i]))));
+            BOOST_CHECK(RtSeq(k, s.c_str()) != RtSeq(k, t.c_str()));
+            BOOST_CHECK(ByteRtSeq(k, s.c_str()) != ByteRtSeq(k, t.c_str()));
+        }
+        BOOST_CHECK(RtSeq(k, s.c_str()) == RtSeq(k, s.c_str()));
+    }
+}
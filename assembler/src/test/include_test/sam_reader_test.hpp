@@ -0,0 +1,137 @@
+//***************************************************************************
+//* Copyright (c) 2015 Saint Petersburg State University
+//* Copyright (c) 2011-2014 Saint Petersburg Academic University
+//* All Rights Reserved
+//* See file LICENSE for details.
+//***************************************************************************
+
+#pragma once
+#include <boost/test/unit_test.hpp>
+#include "io/sam/sam_reader.hpp"
+#include "io/sam/bam_parser.hpp"
+#include "utils/path_helper.hpp"
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::string kSamReaderTestSam = "./src/test/include_test/data/ex1.sam";
+
+std::string DumpSamRead(const sam_reader::SingleSamRead &r) {
+    return r.name() + " " + std::to_string(r.contig_id()) + " " + std::to_string(r.pos()) + " " +
+           std::to_string(r.strand()) + " " + std::to_string(r.map_qual()) + " " +
+           r.cigar() + " " + r.seq();
+}
+
+std::vector<std::string> ReadAllSam(sam_reader::MappedSamStream &stream) {
+    std::vector<std::string> answer;
+    while (!stream.eof()) {
+        sam_reader::SingleSamRead r;
+        stream >> r;
+        answer.push_back(DumpSamRead(r));
+    }
+    return answer;
+}
+
+/**
+ * ex1.sam with the header and its BAM conversion made by samtools,
+ * so MappedSamStream could be checked against samtools decoding.
+ */
+class SamBamFiles {
+public:
+    SamBamFiles() : dir_(path::make_temp_dir("/tmp", "sam_reader_test")) {
+        sam_ = path::append_path(dir_, "ex1.sam");
+        bam_ = path::append_path(dir_, "ex1.bam");
+        {
+            std::ifstream in(kSamReaderTestSam);
+            std::ofstream out(sam_);
+            out << "@SQ\tSN:seq1\tLN:1575\n@SQ\tSN:seq2\tLN:1584\n" << in.rdbuf();
+        }
+        samfile_t *in = samopen(sam_.c_str(), "r", NULL);
+        VERIFY(in);
+        samfile_t *out = samopen(bam_.c_str(), "wb", in->header);
+        VERIFY(out);
+        bam1_t *b = bam_init1();
+        while (samread(in, b) > 0)
+            samwrite(out, b);
+        bam_destroy1(b);
+        samclose(out);
+        samclose(in);
+    }
+
+    ~SamBamFiles() {
+        path::remove_dir(dir_);
+    }
+
+    const std::string &sam() const { return sam_; }
+    const std::string &bam() const { return bam_; }
+
+private:
+    std::string dir_, sam_, bam_;
+};
+
+}
+
+BOOST_AUTO_TEST_CASE( TestSamReaderBamMatchesSam ) {
+    SamBamFiles files;
+    sam_reader::MappedSamStream sam(files.sam(), 1);
+    BOOST_REQUIRE(sam.is_open());
+    std::vector<std::string> expected = ReadAllSam(sam);
+    BOOST_CHECK_EQUAL(3307u, expected.size());
+    for (unsigned nthreads : {1u, 3u}) {
+        sam_reader::MappedSamStream bam(files.bam(), nthreads);
+        BOOST_REQUIRE(bam.is_open());
+        BOOST_CHECK_EQUAL(std::string("seq1"), bam.get_contig_name(0));
+        BOOST_CHECK_EQUAL(std::string("seq2"), bam.get_contig_name(1));
+        std::vector<std::string> actual = ReadAllSam(bam);
+        BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( TestSamReaderBamBatchAndReset ) {
+    SamBamFiles files;
+    sam_reader::MappedSamStream sam(files.sam(), 1);
+    std::vector<std::string> expected = ReadAllSam(sam);
+
+    sam_reader::MappedSamStream bam(files.bam(), 2);
+    std::vector<sam_reader::SingleSamRead> batch(7);
+    std::vector<std::string> actual;
+    while (size_t cnt = bam.ReadBatch(batch)) {
+        for (size_t i = 0; i < cnt; ++i)
+            actual.push_back(DumpSamRead(batch[i]));
+    }
+    BOOST_CHECK(bam.eof());
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+
+    bam.reset();
+    BOOST_REQUIRE(bam.is_open());
+    actual = ReadAllSam(bam);
+    BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+}
+
+BOOST_AUTO_TEST_CASE( TestBAMParserMatchesSam ) {
+    SamBamFiles files;
+    std::vector<std::string> expected;
+    sam_reader::MappedSamStream sam(files.sam(), 1);
+    while (!sam.eof()) {
+        sam_reader::SingleSamRead r;
+        sam >> r;
+        BOOST_REQUIRE_EQUAL(r.seq().size(), r.qual().size());
+        expected.push_back(r.name() + " " + r.seq() + " " + r.qual());
+    }
+    BOOST_CHECK_EQUAL(3307u, expected.size());
+
+    io::BAMParser parser(files.bam(), io::PhredOffset, 2);
+    BOOST_REQUIRE(parser.is_open());
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<std::string> actual;
+        io::SingleRead r;
+        while (!parser.eof()) {
+            parser >> r;
+            actual.push_back(r.name() + " " + r.GetSequenceString() + " " + r.GetPhredQualityString());
+        }
+        BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), actual.begin(), actual.end());
+        parser.reset();
+    }
+}
@@ -15,6 +15,7 @@
 #include "sequence_test.hpp"
 #include "quality_test.hpp"
 #include "nucl_test.hpp"
+#include "sam_reader_test.hpp"
 
 ::boost::unit_test::test_suite*    init_unit_test_suite( int, char* [] )
 {